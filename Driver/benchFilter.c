@@ -0,0 +1,204 @@
+/* Benchmark of the biquad filters (biquad.h), built and run by bench_filter.py.
+
+ Filters white noise of the given length and prints the time per sample of: a cascade of 1, 2 and 4 stages on one
+ signal, the same in fixed point, 4, 8 and 16 lanes side by side (once one lane at a time, once with the SIMD
+ set), and the 4-lane bank the crash uses. The lanes must come out exactly the same both ways: exits with 1 if they
+ do not. Last prints a checksum of the filtered signals, which must be the same with every instruction set.
+
+ Usage: benchFilter [seconds] [isa]   (default 10 s, auto)*/
+#define _POSIX_C_SOURCE 199309L /* For clock_gettime with -ansi*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "biquad.h"
+#include "soundwaves.h" /* For SAMPLE_RATE*/
+#include "oscillators.h"
+
+/* Passes of each measurement; the fastest is reported*/
+#define PASSES 5
+
+/* FNV-1a of size bytes*/
+static unsigned long checksum(unsigned long hash, const void *data, size_t size) {
+    const unsigned char *bytes;
+    size_t i;
+
+    bytes = (const unsigned char *)data;
+    for (i = 0; i < size; i++) {
+        hash = ((hash ^ bytes[i]) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Band-passes spread over the spectrum, one per lane*/
+static void design_lanes(BiquadCoeffs *coeffs, int num_lanes) {
+    int k;
+
+    for (k = 0; k < num_lanes; k++) {
+        biquad_design(&coeffs[k], BIQUAD_BANDPASS, 200.0f * (k + 1), 2.0f, 1.0f, SAMPLE_RATE);
+    }
+}
+
+/* Filters a copy of noise through num_stages stages (in fixed point if fixed) into out. Returns the seconds taken.*/
+static double run_cascade(const float *noise, const int16_t *noise_q15, float *out, int16_t *out_q15, int count,
+                          int num_stages, int fixed) {
+    BiquadCoeffs stages[BIQUAD_MAX_STAGES];
+    BiquadCascade cascade;
+    BiquadFixed fixed_stages[BIQUAD_MAX_STAGES];
+    double best;
+    double start;
+    int pass;
+
+    biquad_butterworth(stages, BIQUAD_LOWPASS, 2000.0f, 2 * num_stages, SAMPLE_RATE);
+    best = 1e30;
+    for (pass = 0; pass < PASSES; pass++) {
+        if (fixed) {
+            biquad_fixed_init(fixed_stages, stages, num_stages);
+            start = now_seconds();
+            biquad_fixed_cascade(fixed_stages, num_stages, noise_q15, out_q15, count);
+        } else {
+            memcpy(out, noise, (size_t)count * sizeof(float));
+            biquad_cascade_init(&cascade, stages, num_stages);
+            start = now_seconds();
+            biquad_cascade_process(&cascade, out, count);
+        }
+        start = now_seconds() - start;
+        if (start < best) best = start;
+    }
+    return best;
+}
+
+/* Filters num_lanes interleaved copies of noise with the active set. Returns the seconds taken.*/
+static double run_lanes(const float *noise, float *frames, int count, int num_lanes) {
+    BiquadCoeffs coeffs[BIQUAD_MAX_LANES];
+    BiquadLanes lanes;
+    double best;
+    double start;
+    int pass;
+    int i, k;
+
+    design_lanes(coeffs, num_lanes);
+    best = 1e30;
+    for (pass = 0; pass < PASSES; pass++) {
+        for (i = 0; i < count; i++) {
+            for (k = 0; k < num_lanes; k++) {
+                frames[(size_t)i * num_lanes + k] = noise[i];
+            }
+        }
+        biquad_lanes_init(&lanes, coeffs, num_lanes);
+        start = now_seconds();
+        biquad_lanes_process(&lanes, frames, count);
+        start = now_seconds() - start;
+        if (start < best) best = start;
+    }
+    return best;
+}
+
+static double run_bank(const float *noise, float *out, int count) {
+    BiquadCoeffs coeffs[4];
+    BiquadLanes lanes;
+    double best;
+    double start;
+    int pass;
+
+    design_lanes(coeffs, 4);
+    best = 1e30;
+    for (pass = 0; pass < PASSES; pass++) {
+        biquad_lanes_init(&lanes, coeffs, 4);
+        start = now_seconds();
+        biquad_lanes_sum(&lanes, noise, out, count);
+        start = now_seconds() - start;
+        if (start < best) best = start;
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    static const int stage_counts[] = { 1, 2, 4 };
+    static const int lane_counts[] = { 4, 8, 16 };
+    static const char *const isa_names[] = { "auto", "scalar", "sse2", "avx2", "avx512" };
+    float *noise;
+    int16_t *noise_q15;
+    float *out;
+    int16_t *out_q15;
+    float *reference;
+    float *frames;
+    unsigned long hash;
+    OscIsa isa;
+    double seconds;
+    double t_one, t_all;
+    int count;
+    int failed;
+    int i, c, k;
+
+    seconds = argc > 1 ? atof(argv[1]) : 10.0;
+    isa = OSC_ISA_AUTO;
+    for (k = 0; argc > 2 && k < 5; k++) {
+        if (strcmp(argv[2], isa_names[k]) == 0) isa = (OscIsa)k;
+    }
+    osc_set_isa(isa);
+    count = (int)(seconds * SAMPLE_RATE);
+
+    noise = (float *)malloc((size_t)count * sizeof(float));
+    noise_q15 = (int16_t *)malloc((size_t)count * sizeof(int16_t));
+    out = (float *)malloc((size_t)count * sizeof(float));
+    out_q15 = (int16_t *)malloc((size_t)count * sizeof(int16_t));
+    reference = (float *)malloc((size_t)count * BIQUAD_MAX_LANES * sizeof(float));
+    frames = (float *)malloc((size_t)count * BIQUAD_MAX_LANES * sizeof(float));
+    if (!noise || !noise_q15 || !out || !out_q15 || !reference || !frames) {
+        fprintf(stderr, "Out of memory.\n");
+        return 2;
+    }
+    srand(1);
+    for (i = 0; i < count; i++) {
+        noise_q15[i] = (int16_t)(rand() % 65536 - 32768);
+        noise[i] = noise_q15[i] / 32768.0f;
+    }
+
+    printf("signal: %.0f s, %d samples, kernels: %s\n", count / (double)SAMPLE_RATE, count,
+           osc_isa_name(osc_active_isa()));
+    hash = 2166136261UL;
+    for (c = 0; c < (int)(sizeof(stage_counts) / sizeof(stage_counts[0])); c++) {
+        t_one = run_cascade(noise, noise_q15, out, out_q15, count, stage_counts[c], 0);
+        t_all = run_cascade(noise, noise_q15, out, out_q15, count, stage_counts[c], 1);
+        hash = checksum(checksum(hash, out, (size_t)count * sizeof(float)), out_q15, (size_t)count * sizeof(int16_t));
+        printf("cascade %d stage%s  float %6.2f ns/sample  fixed %6.2f ns/sample\n", stage_counts[c],
+               stage_counts[c] > 1 ? "s" : " ", t_one * 1e9 / count, t_all * 1e9 / count);
+    }
+
+    failed = 0;
+    for (c = 0; c < (int)(sizeof(lane_counts) / sizeof(lane_counts[0])); c++) {
+        osc_set_isa(OSC_ISA_SCALAR);
+        t_one = run_lanes(noise, reference, count, lane_counts[c]);
+        osc_set_isa(isa);
+        t_all = run_lanes(noise, frames, count, lane_counts[c]);
+        if (memcmp(reference, frames, (size_t)count * lane_counts[c] * sizeof(float)) != 0) failed = 1;
+        hash = checksum(hash, frames, (size_t)count * lane_counts[c] * sizeof(float));
+        printf("lanes %2d  one at a time %6.2f ns/lane-sample  %-6s %6.2f ns/lane-sample  %5.2fx\n",
+               lane_counts[c], t_one * 1e9 / ((double)count * lane_counts[c]), osc_isa_name(osc_active_isa()),
+               t_all * 1e9 / ((double)count * lane_counts[c]), t_one / t_all);
+    }
+
+    t_all = run_bank(noise, out, count);
+    hash = checksum(hash, out, (size_t)count * sizeof(float));
+    printf("bank of 4 lanes, summed (crash)  %6.2f ns/sample\n", t_all * 1e9 / count);
+
+    printf("checksum: %08lx\n", hash);
+    if (failed) {
+        printf("FAIL: the SIMD lanes differ from filtering one lane at a time\n");
+    }
+    free(noise);
+    free(noise_q15);
+    free(out);
+    free(out_q15);
+    free(reference);
+    free(frames);
+    return failed;
+}
@@ -0,0 +1,165 @@
+/* Benchmark of the N-way mixer (mixBus.h) against mixing one source at a time, built and run by bench_mix.py.
+
+ Mixes 1, 4 and 16 lanes of beat-long clips into every beat of a timeline of the given length, once with one
+ mix_in (float bus) or single-source mix_pcm_sum (16-bit) call per lane, once with one mix_bus_sum or mix_pcm_sum
+ call over all lanes, and prints the time of each. Both must leave the timeline exactly the same: exits with 1
+ if they do not. Last prints a checksum of the timelines, which must be the same with every instruction set.
+
+ Usage: benchMix [seconds] [isa]   (default 3600 s, auto)*/
+#define _POSIX_C_SOURCE 199309L /* For clock_gettime with -ansi*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "WAVGenerator.h" /* For mix_in*/
+#include "soundwaves.h" /* For SAMPLE_RATE and SAMPLES_PER_BEAT*/
+#include "oscillators.h"
+
+#define MAX_LANES 16
+
+/* FNV-1a of size bytes*/
+static unsigned long checksum(unsigned long hash, const void *data, size_t size) {
+    const unsigned char *bytes;
+    size_t i;
+
+    bytes = (const unsigned char *)data;
+    for (i = 0; i < size; i++) {
+        hash = ((hash ^ bytes[i]) * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return hash;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Mixes lanes into every beat of the float timeline, one call per lane or one call in all. Returns the seconds taken.*/
+static double mix_float(float *timeline, size_t num_beats, const MixSource *lanes, int num_lanes, int at_once) {
+    double start;
+    size_t beat;
+    int k;
+
+    start = now_seconds();
+    for (beat = 0; beat < num_beats; beat++) {
+        if (at_once) {
+            mix_bus_sum(timeline + beat * SAMPLES_PER_BEAT, lanes, num_lanes, SAMPLES_PER_BEAT);
+            continue;
+        }
+        for (k = 0; k < num_lanes; k++) {
+            mix_in(timeline, lanes[k].samples, beat * SAMPLES_PER_BEAT, SAMPLES_PER_BEAT);
+        }
+    }
+    return now_seconds() - start;
+}
+
+static double mix_pcm(int16_t *timeline, size_t num_beats, const MixSourcePcm *lanes, int num_lanes, int at_once) {
+    double start;
+    size_t beat;
+    int k;
+
+    start = now_seconds();
+    for (beat = 0; beat < num_beats; beat++) {
+        if (at_once) {
+            mix_pcm_sum(timeline + beat * SAMPLES_PER_BEAT, lanes, num_lanes, SAMPLES_PER_BEAT);
+            continue;
+        }
+        for (k = 0; k < num_lanes; k++) {
+            mix_pcm_sum(timeline + beat * SAMPLES_PER_BEAT, &lanes[k], 1, SAMPLES_PER_BEAT);
+        }
+    }
+    return now_seconds() - start;
+}
+
+int main(int argc, char *argv[]) {
+    static const int lane_counts[] = { 1, 4, 16 };
+    static const char *const isa_names[] = { "auto", "scalar", "sse2", "avx2", "avx512" };
+    float *clips;
+    int16_t *pcm_clips;
+    MixSource lanes[MAX_LANES];
+    MixSourcePcm pcm_lanes[MAX_LANES];
+    float *one_by_one;
+    float *at_once;
+    int16_t *pcm_one_by_one;
+    int16_t *pcm_at_once;
+    double seconds;
+    double t_one, t_all;
+    size_t num_beats;
+    size_t num_samples;
+    size_t i;
+    int failed;
+    int c, k;
+
+    seconds = argc > 1 ? atof(argv[1]) : 3600.0;
+    for (k = 0; argc > 2 && k < 5; k++) {
+        if (strcmp(argv[2], isa_names[k]) == 0) osc_set_isa((OscIsa)k);
+    }
+    num_beats = (size_t)(seconds * SAMPLE_RATE / SAMPLES_PER_BEAT);
+    num_samples = num_beats * SAMPLES_PER_BEAT;
+
+    /* A clip per lane, loud enough that 16 lanes saturate the 16-bit timeline now and then*/
+    clips = (float *)malloc((size_t)MAX_LANES * SAMPLES_PER_BEAT * sizeof(float));
+    pcm_clips = (int16_t *)malloc((size_t)MAX_LANES * SAMPLES_PER_BEAT * sizeof(int16_t));
+    one_by_one = (float *)calloc(num_samples, sizeof(float));
+    at_once = (float *)calloc(num_samples, sizeof(float));
+    pcm_one_by_one = (int16_t *)calloc(num_samples, sizeof(int16_t));
+    pcm_at_once = (int16_t *)calloc(num_samples, sizeof(int16_t));
+    if (!clips || !pcm_clips || !one_by_one || !at_once || !pcm_one_by_one || !pcm_at_once) {
+        fprintf(stderr, "Out of memory.\n");
+        return 2;
+    }
+    srand(1);
+    for (i = 0; i < (size_t)MAX_LANES * SAMPLES_PER_BEAT; i++) {
+        pcm_clips[i] = (int16_t)(rand() % 16001 - 8000);
+        clips[i] = (float)pcm_clips[i];
+    }
+    for (k = 0; k < MAX_LANES; k++) {
+        lanes[k].samples = clips + (size_t)k * SAMPLES_PER_BEAT;
+        lanes[k].gain = 1.0f; /* mix_in has no gain*/
+        pcm_lanes[k].samples = pcm_clips + (size_t)k * SAMPLES_PER_BEAT;
+        pcm_lanes[k].gain = k % 2 ? 0.5f : 1.0f;
+    }
+
+    /* One untimed pass first, so no timing includes the page faults of first use*/
+    mix_float(one_by_one, num_beats, lanes, 1, 1);
+    mix_float(at_once, num_beats, lanes, 1, 1);
+    mix_pcm(pcm_one_by_one, num_beats, pcm_lanes, 1, 1);
+    mix_pcm(pcm_at_once, num_beats, pcm_lanes, 1, 1);
+    memset(one_by_one, 0, num_samples * sizeof(float));
+    memset(at_once, 0, num_samples * sizeof(float));
+    memset(pcm_one_by_one, 0, num_samples * sizeof(int16_t));
+    memset(pcm_at_once, 0, num_samples * sizeof(int16_t));
+
+    printf("timeline: %.0f s, %lu samples, kernels: %s\n", num_samples / (double)SAMPLE_RATE,
+           (unsigned long)num_samples, osc_isa_name(osc_active_isa()));
+    failed = 0;
+    for (c = 0; c < (int)(sizeof(lane_counts) / sizeof(lane_counts[0])); c++) {
+        t_one = mix_float(one_by_one, num_beats, lanes, lane_counts[c], 0);
+        t_all = mix_float(at_once, num_beats, lanes, lane_counts[c], 1);
+        if (memcmp(one_by_one, at_once, num_samples * sizeof(float)) != 0) failed = 1;
+        printf("float %2d lanes: mix_in x%-2d %9.1f ms  mix_bus_sum %9.1f ms  %5.2fx  %6.2f Gsamples/s\n",
+               lane_counts[c], lane_counts[c], t_one * 1e3, t_all * 1e3, t_one / t_all,
+               (double)num_samples * lane_counts[c] / t_all / 1e9);
+
+        t_one = mix_pcm(pcm_one_by_one, num_beats, pcm_lanes, lane_counts[c], 0);
+        t_all = mix_pcm(pcm_at_once, num_beats, pcm_lanes, lane_counts[c], 1);
+        if (memcmp(pcm_one_by_one, pcm_at_once, num_samples * sizeof(int16_t)) != 0) failed = 1;
+        printf("int16 %2d lanes: 1-way x%-2d %9.1f ms  mix_pcm_sum %9.1f ms  %5.2fx  %6.2f Gsamples/s\n",
+               lane_counts[c], lane_counts[c], t_one * 1e3, t_all * 1e3, t_one / t_all,
+               (double)num_samples * lane_counts[c] / t_all / 1e9);
+    }
+    printf("checksum: %08lx\n", checksum(checksum(2166136261UL, at_once, num_samples * sizeof(float)),
+                                          pcm_at_once, num_samples * sizeof(int16_t)));
+    if (failed) {
+        printf("FAIL: mixing all lanes at once differs from mixing them one at a time\n");
+    }
+    free(clips);
+    free(pcm_clips);
+    free(one_by_one);
+    free(at_once);
+    free(pcm_one_by_one);
+    free(pcm_at_once);
+    return failed;
+}
@@ -0,0 +1,74 @@
+"""Ahead-of-time backend: render time of `djc song.djir` vs the C renderer emitted with `djc --emit-c`.
+
+Generates a song, compiles it once to IR and once to C (built with gcc -O3 as a standalone renderer and
+as a shared object), then times rendering + WAV write of each, best of RUNS process runs. Both seed every
+hit's noise the same way, so the WAV files must be byte-identical; the benchmark fails otherwise.
+
+Usage (from the repo root, after `make djc`):
+    python3 Driver/bench_aot.py [num_patterns] [num_plays] [runs]
+"""
+import filecmp
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+from bench_parse import generate
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+CC = os.environ.get("CC", "gcc")
+
+
+def best_time(command, runs):
+    best = None
+    for _ in range(runs):
+        start = time.perf_counter()
+        subprocess.run(command, check=True, stdout=subprocess.DEVNULL)
+        elapsed = time.perf_counter() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+def main():
+    num_patterns = int(sys.argv[1]) if len(sys.argv) > 1 else 200
+    num_plays = int(sys.argv[2]) if len(sys.argv) > 2 else 400
+    runs = int(sys.argv[3]) if len(sys.argv) > 3 else 3
+    djc = os.path.join(ROOT, "djc" + EXE)
+
+    workdir = tempfile.mkdtemp()
+    try:
+        source = os.path.join(workdir, "song.dj")
+        ir_file = os.path.join(workdir, "song.djir")
+        c_file = os.path.join(workdir, "song.c")
+        renderer = os.path.join(workdir, "song" + EXE)
+        generate(source, num_patterns, num_plays)
+        subprocess.run([djc, source, "--emit-ir", ir_file], check=True)
+        subprocess.run([djc, source, "--emit-c", c_file], check=True)
+
+        start = time.perf_counter()
+        subprocess.run([CC, "-O3", "-ansi", "-DDJ_SONG_MAIN", "-I", os.path.join(ROOT, "Sound_Synthesis"),
+                        c_file, "-o", renderer, "-lm"], check=True)
+        build_seconds = time.perf_counter() - start
+        if os.name != "nt":
+            subprocess.run([CC, "-O3", "-ansi", "-fPIC", "-shared", "-I", os.path.join(ROOT, "Sound_Synthesis"),
+                            c_file, "-o", os.path.join(workdir, "song.so"), "-lm"], check=True)
+
+        interpreted = best_time([djc, ir_file, "-o", os.path.join(workdir, "djc.wav")], runs)
+        compiled = best_time([renderer, os.path.join(workdir, "aot.wav")], runs)
+        if not filecmp.cmp(os.path.join(workdir, "djc.wav"), os.path.join(workdir, "aot.wav"), shallow=False):
+            print("FAIL: the AOT renderer writes a different WAV than djc")
+            sys.exit(1)
+
+        print("song: %d patterns, %d plays, %.1f MB of C, gcc -O3 build %.2f s"
+              % (num_patterns, num_plays, os.path.getsize(c_file) / 1e6, build_seconds))
+        print("djc song.djir:  %8.2f ms" % (interpreted * 1e3))
+        print("AOT renderer:   %8.2f ms  (%.2fx)" % (compiled * 1e3, interpreted / compiled))
+    finally:
+        shutil.rmtree(workdir)
+
+
+if __name__ == "__main__":
+    main()
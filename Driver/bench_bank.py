@@ -0,0 +1,63 @@
+"""Differential test and benchmark of the sample bank (Sound_Synthesis/sampleBank.c).
+
+Renders a long looped arrangement with the bank (the default) and with `--no-bank`, checks the two WAVs are
+identical (without --variations noisy hits are still synthesized, so the bank must not change a sample), then
+renders it with `--variations N`, where noisy hits are mixed from N banked takes per sound as well. Reports the
+render time of each, the speedup over `--no-bank`, and the bank's entries, memory and hit rate.
+
+Usage (from the repo root, after `make djc`):
+    python3 Driver/bench_bank.py [num_plays] [variations]
+"""
+import filecmp
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+
+SONG = ("Pattern1:\nDrum boom tsst boom clap\nTriangle ding diding\n\n"
+        "Pattern2:\nDrum boom boom dun crash\nTriangle dididing ding\n\n"
+        "Drop the beat:\nPlay Pattern1 x%d\nPlay Pattern2 x%d\n")
+
+
+def render(source, output, options):
+    """Renders source with options; returns (render seconds, bank stats line or None)"""
+    result = subprocess.run([os.path.join(ROOT, "djc" + EXE), source, "-o", output, "--stats"] + options,
+                            check=True, capture_output=True, text=True)
+    seconds = float(re.search(r"render:\s*([0-9.]+) ms", result.stderr).group(1)) / 1e3
+    bank = re.search(r"^bank: (.*)$", result.stderr, re.M)
+    return seconds, bank.group(1) if bank else None
+
+
+def main():
+    num_plays = int(sys.argv[1]) if len(sys.argv) > 1 else 200
+    variations = int(sys.argv[2]) if len(sys.argv) > 2 else 8
+    workdir = tempfile.mkdtemp()
+    try:
+        source = os.path.join(workdir, "long.dj")
+        with open(source, "w") as f:
+            f.write(SONG % (num_plays, num_plays))
+        baseline = None
+        outputs = []
+        for name, options in [("no bank", ["--no-bank"]), ("bank", []),
+                              ("bank, %d variations" % variations, ["--variations", str(variations)])]:
+            output = os.path.join(workdir, "%d.wav" % len(outputs))
+            seconds, bank = min(render(source, output, options) for _ in range(3))
+            outputs.append(output)
+            baseline = baseline or seconds
+            print("%-20s render %9.2f ms  %5.2fx%s" % (name, seconds * 1e3, baseline / seconds,
+                                                      "  " + bank if bank else ""))
+        if not filecmp.cmp(outputs[0], outputs[1], shallow=False):
+            print("FAIL: the bank changed the output")
+            sys.exit(1)
+        print("bank output identical to --no-bank  ok")
+    finally:
+        shutil.rmtree(workdir)
+
+
+if __name__ == "__main__":
+    main()
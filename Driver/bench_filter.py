@@ -0,0 +1,50 @@
+"""Benchmark of the biquad filters (Sound_Synthesis/biquad.c).
+
+Runs benchFilter (built by `make benchfilter`), which filters white noise through cascades of 1, 2 and 4 biquads
+(float and fixed point) and through 4, 8 and 16 filter lanes side by side, one lane at a time and with the SIMD
+set, checks that both lane versions give the same samples, and prints the time per sample of each. The full
+signal (ten seconds by default) is filtered with the widest set the CPU has; a one-second one with every set,
+whose checksums must all match the scalar one.
+
+Usage (from the repo root, after `make benchfilter`):
+    python3 Driver/bench_filter.py [seconds]
+"""
+import os
+import re
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+ISAS = ["scalar", "sse2", "avx2", "avx512"]
+
+
+def run(seconds, isa, show):
+    """Runs benchFilter; returns (set actually used, checksum, exit code)"""
+    result = subprocess.run([os.path.join(ROOT, "benchFilter" + EXE), str(seconds), isa],
+                            capture_output=True, text=True)
+    if show:
+        sys.stdout.write(result.stdout)
+    used = re.search(r"kernels: (\w+)", result.stdout).group(1)
+    return used, re.search(r"checksum: (\w+)", result.stdout).group(1), result.returncode
+
+
+def main():
+    seconds = float(sys.argv[1]) if len(sys.argv) > 1 else 10
+    failed = False
+    sums = {}
+    for isa in ISAS:
+        used, checksum, code = run(1, isa, False)
+        failed = failed or code != 0
+        if used == isa:
+            sums[isa] = checksum
+    ok = all(checksum == sums["scalar"] for checksum in sums.values())
+    failed = failed or not ok
+    print("%s give the same samples  %s" % (", ".join(sums), "ok" if ok else "FAIL"))
+    failed = run(seconds, list(sums)[-1], True)[2] != 0 or failed
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
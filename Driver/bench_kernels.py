@@ -0,0 +1,247 @@
+"""Differential test and benchmark of the oscillator kernels (Sound_Synthesis/oscillators.c and wavetable.c).
+
+Renders songs that use the oscillator sounds (boom, dun, ding, diding, dididing) with each engine
+(`--osc direct` and `--osc wavetable`) and `--isa scalar`, the reference of that engine, and with every
+SIMD set the CPU supports, then checks that no sample is more than MAX_DIFF steps away from the reference.
+dun mixes in noise, which is seeded per hit and identical on every set, so only the oscillator math can
+differ. The noise sounds (tsst, clap, crash: filtered noise, see biquad.h) must come out bit-identical on every
+set, the same for the same --seed, and different for another seed. boom rendered with `--pcm limit` must come out the
+same on every set (which checks the SIMD limiter of the output stage against the scalar one) and quieter at its
+peaks. A song of every sound must come out the same whatever `--block` size the voices are rendered in (see
+voice.h). boom, whose pitch envelope sweeps it down an octave, must fall in pitch with every engine, and every SIMD set
+must stay within MAX_DIFF steps of the scalar reference while it sweeps. Each sound rendered with `--osc fixed` must
+stay within the signal-to-noise ratio fixedPoint.h documents of the float reference. The piano's notes and chords
+(the oscillator bank, see oscBank.h) rendered with a SIMD set must stay above OSC_BANK_MIN_SNR_DB of the scalar reference, which calls sin for every partial, and a chord-heavy song is
+timed against its length in real time. Finally reports the render time of each engine and set on a longer song, and the CPU cycles per output sample that makes (at the clock /proc/cpuinfo reports, where it exists). Every render passes
+--no-bank, so each hit runs the kernels instead of being mixed from the sample bank.
+
+Usage (from the repo root, after `make djc`):
+    python3 Driver/bench_kernels.py [num_plays]
+"""
+import array
+import math
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import wave
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+ISAS = ["scalar", "sse2", "avx2", "avx512"]
+ENGINES = ["direct", "wavetable", "wavetable-cubic", "fixed"]
+MAX_DIFF = 1
+SAMPLE_RATE = 44100
+
+SONGS = {
+    "boom": "Pattern1:\nDrum boom boom rest boom\n\nDrop the beat:\nPlay Pattern1 x2\n",
+    "ding": "Pattern1:\nTriangle ding diding dididing\n\nDrop the beat:\nPlay Pattern1 x2\n",
+    "dun": "Pattern1:\nDrum dun boom dun\nTriangle ding\n\nDrop the beat:\nPlay Pattern1 x3\n",
+    "piano": "Pattern1:\nPiano DM AM1st Bm1st GM2nd\nPiano D2 Fs4 A3 Cs4\n\nDrop the beat:\nPlay Pattern1 x2\n",
+}
+PIANO_SOUNDS = ["D3", "A4", "E4", "DM", "AM1st", "Bm1st", "GM2nd"]
+
+
+def render(source, output, isa, engine, seed=0, pcm="clip", block=256):
+    """Renders source with the kernels of isa and engine; returns (isa actually used, render seconds, samples)"""
+    result = subprocess.run([os.path.join(ROOT, "djc" + EXE), source, "-o", output, "--isa", isa, "--osc", engine,
+                             "--seed", str(seed), "--pcm", pcm, "--block", str(block), "--no-bank", "--stats"],
+                            check=True, capture_output=True, text=True)
+    used = re.search(r"kernels: (\w+)", result.stderr).group(1)
+    num_samples = int(re.search(r"samples: (\d+)", result.stderr).group(1))
+    return used, float(re.search(r"render:\s*([0-9.]+) ms", result.stderr).group(1)) / 1e3, num_samples
+
+
+def cpu_hz():
+    """Clock of the first CPU, or None if the OS does not say"""
+    try:
+        with open("/proc/cpuinfo") as f:
+            match = re.search(r"cpu MHz\s*:\s*([0-9.]+)", f.read())
+    except OSError:
+        return None
+    return float(match.group(1)) * 1e6 if match else None
+
+
+def samples(path):
+    with wave.open(path, "rb") as f:
+        data = array.array("h")
+        data.frombytes(f.readframes(f.getnframes()))
+    return data
+
+
+def fixed_bounds():
+    """FX_MIN_SNR_DB and FX_MIN_SNR_DRIFT_DB of Sound_Synthesis/fixedPoint.h"""
+    with open(os.path.join(ROOT, "Sound_Synthesis", "fixedPoint.h")) as f:
+        text = f.read()
+    return tuple(float(re.search(r"#define %s ([0-9.]+)" % name, text).group(1))
+                 for name in ("FX_MIN_SNR_DB", "FX_MIN_SNR_DRIFT_DB"))
+
+
+def bank_bound():
+    """OSC_BANK_MIN_SNR_DB of Sound_Synthesis/oscBank.h"""
+    with open(os.path.join(ROOT, "Sound_Synthesis", "oscBank.h")) as f:
+        return float(re.search(r"#define OSC_BANK_MIN_SNR_DB ([0-9.]+)", f.read()).group(1))
+
+
+def crossings(data, start, end):
+    """Zero crossings of data between start and end seconds, twice the pitch of a tone over that time"""
+    window = data[int(start * SAMPLE_RATE):int(end * SAMPLE_RATE)]
+    return sum(1 for a, b in zip(window, window[1:]) if (a < 0) != (b < 0))
+
+
+def snr_db(reference, got):
+    """Signal-to-noise ratio of got against reference, in dB"""
+    error = sum((a - b) ** 2 for a, b in zip(reference, got))
+    if error == 0:
+        return float("inf")
+    return 10 * math.log10(sum(a * a for a in reference) / error)
+
+
+def main():
+    num_plays = int(sys.argv[1]) if len(sys.argv) > 1 else 40
+    workdir = tempfile.mkdtemp()
+    failed = False
+    try:
+        supported = []
+        for name, text in SONGS.items():
+            source = os.path.join(workdir, name + ".dj")
+            with open(source, "w") as f:
+                f.write(text)
+            for engine in ENGINES[:2]:
+                render(source, os.path.join(workdir, "scalar.wav"), "scalar", engine)
+                reference = samples(os.path.join(workdir, "scalar.wav"))
+                for isa in ISAS[1:]:
+                    used, _, _ = render(source, os.path.join(workdir, isa + ".wav"), isa, engine)
+                    if used != isa:
+                        continue  # Not supported by this CPU
+                    if isa not in supported:
+                        supported.append(isa)
+                    got = samples(os.path.join(workdir, isa + ".wav"))
+                    diff = max(abs(a - b) for a, b in zip(reference, got)) if len(got) == len(reference) else None
+                    ok = diff is not None and diff <= MAX_DIFF
+                    failed = failed or not ok
+                    print("%-5s %-9s %-7s max |diff| %s steps  %s" % (name, engine, isa, diff, "ok" if ok else "FAIL"))
+
+        source = os.path.join(workdir, "noise.dj")
+        with open(source, "w") as f:
+            f.write("Pattern1:\nDrum tsst clap crash\n\nDrop the beat:\nPlay Pattern1 x2\n")
+        outputs = {}
+        for isa, seed in [("scalar", 7)] + [(isa, 7) for isa in supported] + [("scalar", 8)]:
+            render(source, os.path.join(workdir, "noise.wav"), isa, "direct", seed)
+            outputs.setdefault(seed, []).append(samples(os.path.join(workdir, "noise.wav")))
+        ok = all(got == outputs[7][0] for got in outputs[7]) and outputs[8][0] != outputs[7][0]
+        failed = failed or not ok
+        print("noise %d renders with seed 7 identical, seed 8 different  %s" % (len(outputs[7]), "ok" if ok else "FAIL"))
+
+        # boom is the swept sound: its pitch envelope (SWEEP in soundTable.c) takes it down an octave over the beat.
+        # With every engine its pitch must fall, and each SIMD set must follow the sweep of its scalar reference.
+        source = os.path.join(workdir, "sweep.dj")
+        with open(source, "w") as f:
+            f.write("Pattern1:\nDrum boom\n\nDrop the beat:\nPlay Pattern1 x1\n")
+        for engine in ENGINES:
+            render(source, os.path.join(workdir, "scalar.wav"), "scalar", engine)
+            reference = samples(os.path.join(workdir, "scalar.wav"))
+            early, late = crossings(reference, 0.0, 0.1), crossings(reference, 0.3, 0.4)
+            diffs = []
+            for isa in supported:
+                render(source, os.path.join(workdir, isa + ".wav"), isa, engine)
+                got = samples(os.path.join(workdir, isa + ".wav"))
+                diffs.append(max(abs(a - b) for a, b in zip(reference, got)) if len(got) == len(reference) else None)
+            ok = late > 0 and early > 1.3 * late and all(diff is not None and diff <= MAX_DIFF for diff in diffs)
+            failed = failed or not ok
+            print("sweep %-15s %d -> %d crossings per 0.1 s, max |diff| %s steps on %s  %s"
+                  % (engine, early, late, max(diffs) if diffs else 0, ", ".join(supported) or "no SIMD set",
+                     "ok" if ok else "FAIL"))
+
+        # The wavetable kernels are exact on every set, and boom peaks above the limiter's threshold
+        source = os.path.join(workdir, "boom.dj")
+        outputs = {}
+        for pcm in ["clip", "limit"]:
+            for isa in ["scalar"] + supported:
+                render(source, os.path.join(workdir, "limit.wav"), isa, "wavetable", 0, pcm)
+                outputs.setdefault(pcm, []).append(samples(os.path.join(workdir, "limit.wav")))
+        ok = (all(got == outputs["limit"][0] for got in outputs["limit"])
+              and max(map(abs, outputs["limit"][0])) < max(map(abs, outputs["clip"][0])))
+        failed = failed or not ok
+        print("boom  %d renders with --pcm limit identical and quieter at the peaks  %s"
+              % (len(outputs["limit"]), "ok" if ok else "FAIL"))
+
+        source = os.path.join(workdir, "all.dj")
+        with open(source, "w") as f:
+            f.write("Pattern1:\nDrum boom tsst clap dun crash rest\nTriangle ding diding dididing\n\n"
+                    "Drop the beat:\nPlay Pattern1 x2\n")
+        ok = True
+        for engine in ENGINES:
+            for isa in ["scalar"] + supported[-1:]:
+                outputs = []
+                for block in [64, 100, 256, 1024]:
+                    render(source, os.path.join(workdir, "all.wav"), isa, engine, 0, "clip", block)
+                    outputs.append(samples(os.path.join(workdir, "all.wav")))
+                ok = ok and all(got == outputs[0] for got in outputs)
+        failed = failed or not ok
+        print("all   every sound identical in blocks of 64, 100, 256 and 1024 samples  %s" % ("ok" if ok else "FAIL"))
+
+        # The triangles' reference drifts in pitch (its float phase rounds at every sample), so they are held to the
+        # bound of the float wavetable engine, whose phase is as exact as the fixed one's
+        min_snr, min_snr_drift = fixed_bounds()
+        for sound in ["boom", "dun", "tsst", "clap", "crash", "ding", "diding", "dididing"] + PIANO_SOUNDS:
+            instrument = "Piano" if sound in PIANO_SOUNDS else "Triangle" if "ding" in sound else "Drum"
+            source = os.path.join(workdir, "fixed.dj")
+            with open(source, "w") as f:
+                f.write("Pattern1:\n%s %s %s\n\nDrop the beat:\nPlay Pattern1 x2\n" % (instrument, sound, sound))
+            got = {}
+            for engine, isa in [("direct", "scalar"), ("fixed", "scalar")]:
+                render(source, os.path.join(workdir, "fixed.wav"), isa, engine)
+                got[engine] = samples(os.path.join(workdir, "fixed.wav"))
+            snr = snr_db(got["direct"], got["fixed"])
+            bound = min_snr_drift if "ding" in sound else min_snr
+            ok = len(got["fixed"]) == len(got["direct"]) and snr >= bound
+            failed = failed or not ok
+            print("%-8s --osc fixed SNR %5.1f dB (at least %.0f)  %s" % (sound, snr, bound, "ok" if ok else "FAIL"))
+
+        # The bank against sin at every sample, then a chord on every beat against the clock
+        source = os.path.join(workdir, "piano.dj")
+        bound = bank_bound()
+        render(source, os.path.join(workdir, "scalar.wav"), "scalar", "direct")
+        reference = samples(os.path.join(workdir, "scalar.wav"))
+        for isa in supported:
+            render(source, os.path.join(workdir, "bank.wav"), isa, "direct")
+            snr = snr_db(reference, samples(os.path.join(workdir, "bank.wav")))
+            ok = snr >= bound
+            failed = failed or not ok
+            print("piano    oscillator bank %-7s SNR %5.1f dB (at least %.0f)  %s"
+                  % (isa, snr, bound, "ok" if ok else "FAIL"))
+        source = os.path.join(workdir, "chords.dj")
+        with open(source, "w") as f:
+            f.write("Pattern1:\nPiano DM AM1st Bm1st GM2nd\nPiano D4 Fs4 A4 D4\nDrum boom tsst boom tsst\n\n"
+                    "Drop the beat:\nPlay Pattern1 x%d\n" % num_plays)
+        for isa in ["scalar"] + supported[-1:]:
+            seconds, num_samples = min(render(source, os.path.join(workdir, "chords.wav"), isa, "direct")[1:]
+                                       for _ in range(3))
+            print("chords   %-7s render %8.2f ms for %.1f s of audio  %6.0fx real time"
+                  % (isa, seconds * 1e3, num_samples / SAMPLE_RATE,
+                     num_samples / SAMPLE_RATE / seconds))
+
+        source = os.path.join(workdir, "long.dj")
+        with open(source, "w") as f:
+            f.write("Pattern1:\nDrum boom dun boom\nTriangle ding diding dididing\n\nDrop the beat:\n")
+            f.write("Play Pattern1 x%d\n" % num_plays)
+        hz = cpu_hz()
+        baseline = None
+        for engine in ENGINES:
+            for isa in ["scalar"] + supported[-1:]:
+                seconds, num_samples = min(render(source, os.path.join(workdir, "long.wav"), isa, engine)[1:]
+                                           for _ in range(3))
+                baseline = baseline or seconds
+                cycles = " %7.1f cycles/sample" % (seconds * hz / num_samples) if hz else ""
+                print("%-15s %-7s render %8.2f ms  %5.2fx%s" % (engine, isa, seconds * 1e3, baseline / seconds, cycles))
+    finally:
+        shutil.rmtree(workdir)
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,141 @@
+"""Lexer check and throughput: SIMD scanner (fastLexer.c) vs the flex scanner (lexer.l).
+
+1. Differential test: lexes a set of inputs with the flex scanner and with the fast
+   scanner using each classifier (scalar, sse2, avx2) and compares the full token
+   records (type, offset, length, line, value) printed by `lexer --spans`.
+   Inputs are test.dj, a generated song, hand-written edge cases (keyword prefixes,
+   tokens straddling 32-byte blocks, huge numbers, NUL and high bytes) and random
+   mixes of keyword fragments. Exits with status 1 on the first difference.
+2. Throughput: lexes a generated file of SIZE_MB megabytes with every backend and
+   reports GB/s, timed inside the lexer (file mapping and output not counted).
+
+Both only mean something against a real flex build: the script reads the flex version out of Lexer_Parser/lex.yy.c
+and warns, and labels the reference "lex.yy.c" instead of "flex", when the file was not generated by flex.
+
+Usage (from the repo root, after `make lexer`):
+    python3 Driver/bench_lex.py [size_mb]
+"""
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+
+from bench_parse import generate
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+LEXER = os.path.join(ROOT, "Lexer_Parser", "lexer" + EXE)
+SCANNER = os.path.join(ROOT, "Lexer_Parser", "lex.yy.c")
+BACKENDS = [[], ["--fast=scalar"], ["--fast=sse2"], ["--fast=avx2"]]
+
+FRAGMENTS = [b"Pattern", b"Patter", b"Play", b"Pla", b"Drum", b"Dru", b"Drop the beat", b"Drop the bea",
+             b"Triangle", b"Triangl", b"boom", b"tsst", b"clap", b"cla", b"crash", b"dun", b"ding",
+             b"diding", b"dididing", b"didi", b"dididin", b"rest", b"x", b":", b"0", b"42",
+             b"99999999999999999999999", b" ", b"  ", b"\t", b"\n", b"\r\n", b"\x00", b"\xff", b"#", b"P", b"d",
+             b"Piano", b"Pian", b"D2", b"D3", b"D4", b"D5", b"A2", b"A4", b"B3", b"G4", b"Cs4", b"Cs", b"Fs4", b"E4",
+             b"E", b"DM", b"AM1st", b"AM1s", b"Bm1st", b"Bm", b"GM2nd", b"GM2n"]
+
+EDGE_CASES = [
+    b"",
+    b"\n\n\n",
+    b"Pattern",
+    b"Patter",
+    b"Drop the beat",
+    b"Drop the bea",
+    b"didi dididin diding dididing",
+    b"x1x2x:::",
+    b"Pattern99999999999999999999999999:",
+    b" " * 31 + b"Pattern1:",
+    b" " * 29 + b"Drop the beat:\nPlay Pattern1 x2",
+    b"\n" * 33 + b"Drum boom" + b"\t" * 40 + b"dididing",
+    b"0" * 100 + b"x",
+    b"Drum\x00boom\xff\xfeTriangle ding",
+    b"Piano DM AM1st Bm1st GM2nd\nPiano D2 Fs4 A3 Cs4",
+    b"D23 AM1 Bm1stx GM2ndd DMM Cs44 Fs E4E4 DrumD2 Pianoo",
+]
+
+
+def flex_version():
+    """Returns the version of flex that generated lex.yy.c, or None if flex did not generate it"""
+    with open(SCANNER, "rb") as f:
+        text = f.read(4096).decode("latin-1")
+    if "A lexical scanner generated by flex" not in text:
+        return None
+    parts = [re.search(r"#define YY_FLEX_%s_VERSION (\d+)" % part, text) for part in ("MAJOR", "MINOR", "SUBMINOR")]
+    return ".".join(match.group(1) if match else "?" for match in parts)
+
+
+def lex(source, backend):
+    result = subprocess.run([LEXER, "--spans", source] + backend, check=True, capture_output=True)
+    return result.stdout
+
+
+def lex_stats(source, backend):
+    """Returns (classifier actually used, lex seconds) from `lexer --stats`."""
+    result = subprocess.run([LEXER, "--stats", source] + backend, check=True, capture_output=True, text=True)
+    match = re.search(r"lexer: (\w+), tokens: \d+, lex: ([0-9.]+) ms", result.stderr)
+    return match.group(1), float(match.group(2)) / 1e3
+
+
+def differential(workdir, reference_name):
+    rng = random.Random(1234)
+    cases = [("test.dj", open(os.path.join(ROOT, "Lexer_Parser", "test.dj"), "rb").read())]
+    song = os.path.join(workdir, "song.dj")
+    generate(song, 500, 200)
+    cases.append(("generated song", open(song, "rb").read()))
+    cases += [("edge case %d" % i, data) for i, data in enumerate(EDGE_CASES)]
+    for i in range(40):
+        cases.append(("random mix %d" % i,
+                      b"".join(rng.choice(FRAGMENTS) for _ in range(rng.randint(1, 2000)))))
+
+    source = os.path.join(workdir, "case.dj")
+    for name, data in cases:
+        with open(source, "wb") as f:
+            f.write(data)
+        reference = lex(source, BACKENDS[0])
+        for backend in BACKENDS[1:]:
+            if lex(source, backend) != reference:
+                print("FAIL: %s differs from %s on %s" % (backend[0], reference_name, name))
+                sys.exit(1)
+    print("OK: %d inputs lex identically with %s and %s"
+          % (len(cases), reference_name, ", ".join(backend[0] for backend in BACKENDS[1:])))
+
+
+def throughput(workdir, size_mb, reference_name):
+    source = os.path.join(workdir, "large.dj")
+    num_patterns = int(size_mb * 1e6 / 55) + 1  # A generated pattern is about 55 bytes
+    generate(source, num_patterns, num_patterns // 10)
+    size_gb = os.path.getsize(source) / 1e9
+    print("input: %.1f MB" % (size_gb * 1e3))
+    for backend in BACKENDS:
+        runs = [lex_stats(source, backend) for _ in range(3)]
+        seconds = min(run[1] for run in runs)
+        label = backend[0] if backend else reference_name
+        note = "" if (backend[0] if backend else "flex").endswith(runs[0][0]) else "  (ran as %s)" % runs[0][0]
+        print("%-14s %9.2f ms  %7.3f GB/s%s" % (label, seconds * 1e3, size_gb / seconds, note))
+    os.remove(source)
+
+
+def main():
+    size_mb = float(sys.argv[1]) if len(sys.argv) > 1 else 128
+    version = flex_version()
+    if version:
+        reference_name = "flex"
+        print("reference: lex.yy.c generated by flex %s" % version)
+    else:
+        reference_name = "lex.yy.c"
+        print("WARNING: %s was not generated by flex; the results below compare against it, not flex" % SCANNER)
+    workdir = tempfile.mkdtemp()
+    try:
+        differential(workdir, reference_name)
+        throughput(workdir, size_mb, reference_name)
+    finally:
+        for name in os.listdir(workdir):
+            os.remove(os.path.join(workdir, name))
+        os.rmdir(workdir)
+
+
+if __name__ == "__main__":
+    main()
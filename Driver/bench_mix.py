@@ -0,0 +1,51 @@
+"""Benchmark of the N-way mixer (mix_bus_sum and mix_pcm_sum in Sound_Synthesis/mixBus.c).
+
+Runs benchMix (built by `make benchmix`), which mixes 1, 4 and 16 lanes of beat-long clips into every beat of a
+timeline, once with one call per lane (mix_in on the float bus, single-source mix_pcm_sum on 16-bit PCM) and once
+with one call for all lanes, checks that both give the same timeline, and prints the time of each. The full
+timeline (one hour by default) is mixed with the scalar kernels and with the widest set the CPU has; a one-minute
+one with every set, whose checksums must all match the scalar one.
+
+Usage (from the repo root, after `make benchmix`):
+    python3 Driver/bench_mix.py [seconds]
+"""
+import os
+import re
+import subprocess
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+ISAS = ["scalar", "sse2", "avx2", "avx512"]
+
+
+def run(seconds, isa, show):
+    """Runs benchMix; returns (set actually used, checksum, exit code)"""
+    result = subprocess.run([os.path.join(ROOT, "benchMix" + EXE), str(seconds), isa],
+                            capture_output=True, text=True)
+    if show:
+        sys.stdout.write(result.stdout)
+    used = re.search(r"kernels: (\w+)", result.stdout).group(1)
+    return used, re.search(r"checksum: (\w+)", result.stdout).group(1), result.returncode
+
+
+def main():
+    seconds = float(sys.argv[1]) if len(sys.argv) > 1 else 3600
+    failed = False
+    sums = {}
+    for isa in ISAS:
+        used, checksum, code = run(60, isa, False)
+        failed = failed or code != 0
+        if used == isa:
+            sums[isa] = checksum
+    ok = all(checksum == sums["scalar"] for checksum in sums.values())
+    failed = failed or not ok
+    print("%s give the same timelines  %s" % (", ".join(sums), "ok" if ok else "FAIL"))
+    for isa in ["scalar", list(sums)[-1]]:
+        failed = run(seconds, isa, True)[2] != 0 or failed
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,75 @@
+"""Parse-throughput benchmark: native AST parser (djc --check) vs Lexer_Parser/parser.py.
+
+Generates a .dj file with many patterns, then reports MB/s of .dj source for
+  - djc --check: lexing + AST construction + semantic checks, timed inside djc
+  - parser.py:   parse_program() on the lexer's tokens.txt, timed in-process
+                 (lexing and interpreter startup are not counted for Python)
+
+Usage (from the repo root, after `make lexer djc`):
+    python3 Driver/bench_parse.py [num_patterns] [num_plays]
+"""
+import contextlib
+import importlib.util
+import io
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+
+DRUM = ["boom", "clap", "tsst", "crash", "rest", "dun"]
+TRIANGLE = ["ding", "diding", "dididing"]
+
+
+def generate(path, num_patterns, num_plays):
+    with open(path, "w") as f:
+        for n in range(1, num_patterns + 1):
+            f.write("Pattern%d:\n" % n)
+            f.write("Drum %s %s %s\n" % (DRUM[n % 6], DRUM[(n + 1) % 6], DRUM[(n + 2) % 6]))
+            f.write("Triangle %s\n\n" % TRIANGLE[n % 3])
+        f.write("Drop the beat:\n")
+        for n in range(num_plays):
+            f.write("Play Pattern%d x%d\n" % (n % num_patterns + 1, n % 4 + 1))
+
+
+def bench_native(source):
+    result = subprocess.run([os.path.join(ROOT, "djc" + EXE), "--check", "--stats", source],
+                            check=True, capture_output=True, text=True)
+    return float(re.search(r"lex\+parse:\s*([0-9.]+) ms", result.stderr).group(1)) / 1e3
+
+
+def bench_python(source):
+    tokens = subprocess.run([os.path.join(ROOT, "Lexer_Parser", "lexer" + EXE), source],
+                            check=True, capture_output=True, text=True).stdout
+    lines = [line.strip() for line in tokens.splitlines() if line.strip()]
+    spec = importlib.util.spec_from_file_location("djparser", os.path.join(ROOT, "Lexer_Parser", "parser.py"))
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    start = time.perf_counter()
+    with contextlib.redirect_stdout(io.StringIO()):
+        module.parse_program(lines)
+    return time.perf_counter() - start
+
+
+def main():
+    num_patterns = int(sys.argv[1]) if len(sys.argv) > 1 else 20000
+    num_plays = int(sys.argv[2]) if len(sys.argv) > 2 else 2000
+    fd, source = tempfile.mkstemp(suffix=".dj")
+    os.close(fd)
+    try:
+        generate(source, num_patterns, num_plays)
+        size_mb = os.path.getsize(source) / 1e6
+        print("input: %d patterns, %d plays, %.2f MB" % (num_patterns, num_plays, size_mb))
+        for name, fn in (("djc --check", bench_native), ("parser.py", bench_python)):
+            seconds = min(fn(source) for _ in range(3))
+            print("%-12s %9.2f ms  %8.1f MB/s" % (name, seconds * 1e3, size_mb / seconds))
+    finally:
+        os.remove(source)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,76 @@
+"""Scaling of the parallel renderer (render_song_ir_parallel) from 1 to 16 threads.
+
+Generates an arrangement of the given length (one hour by default) that plays every sound, drums, triangles and
+piano chords, and renders it with `djc --threads T --no-bank --stats` for T = 1, 2, 4, 8 and 16, so every hit is
+synthesized. Reports the render time, how many times faster than real time that is, and the speedup over one
+thread, and checks that every thread count writes the same WAV as one thread. Then renders it once more with the
+sample bank on the most threads, where the threads share the bank, and checks that WAV too.
+
+Speedups above the number of CPUs are not to be expected: the threads then take turns on the same cores.
+
+Usage (from the repo root, after `make djc`):
+    python3 Driver/bench_render.py [minutes]
+"""
+import filecmp
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+THREADS = [1, 2, 4, 8, 16]
+BEATS_PER_MINUTE = 120  # MS_PER_BEAT of Sound_Synthesis/soundwaves.h
+
+# 12 beats each: drums, chords over a bass line, triangles and a melody
+PATTERNS = ("Pattern1:\nDrum boom tsst boom clap\nPiano DM AM1st Bm1st GM2nd\nPiano D2 A2 B2 G2\n\n"
+            "Pattern2:\nDrum boom dun crash rest\nTriangle ding diding dididing ding\nPiano D4 Fs4 A4 Cs4\n\n")
+
+
+def render(source, output, threads, options):
+    """Renders source on threads threads; returns the render seconds"""
+    result = subprocess.run([os.path.join(ROOT, "djc" + EXE), source, "-o", output, "--threads", str(threads),
+                             "--stats"] + options, check=True, capture_output=True, text=True)
+    return float(re.search(r"render:\s*([0-9.]+) ms", result.stderr).group(1)) / 1e3
+
+
+def main():
+    minutes = float(sys.argv[1]) if len(sys.argv) > 1 else 60
+    plays = max(1, int(minutes * BEATS_PER_MINUTE / 24))  # Of each pattern
+    workdir = tempfile.mkdtemp()
+    source = os.path.join(workdir, "hour.dj")
+    reference = os.path.join(workdir, "reference.wav")
+    output = os.path.join(workdir, "threads.wav")
+    failed = False
+    try:
+        with open(source, "w") as f:
+            f.write(PATTERNS + "Drop the beat:\nPlay Pattern1 x%d\nPlay Pattern2 x%d\n" % (plays, plays))
+        audio_seconds = plays * 24 * 60.0 / BEATS_PER_MINUTE
+        print("song: %.1f min of audio, %d beats, %d CPUs" % (audio_seconds / 60, plays * 24, os.cpu_count() or 1))
+        baseline = None
+        for threads in THREADS:
+            seconds = min(render(source, reference if threads == 1 else output, threads, ["--no-bank"])
+                          for _ in range(2))
+            ok = threads == 1 or filecmp.cmp(reference, output, shallow=False)
+            failed = failed or not ok
+            baseline = baseline or seconds
+            print("%3d threads %10.2f ms  %7.0fx real time  %5.2fx  %s"
+                  % (threads, seconds * 1e3, audio_seconds / seconds, baseline / seconds, "ok" if ok else "FAIL"))
+
+        # Without --variations the bank must not change a sample, however many threads fill it
+        seconds = render(source, output, THREADS[-1], [])
+        ok = filecmp.cmp(reference, output, shallow=False)
+        failed = failed or not ok
+        print("%3d threads %10.2f ms  %7.0fx real time  with the sample bank  %s"
+              % (THREADS[-1], seconds * 1e3, audio_seconds / seconds, "ok" if ok else "FAIL"))
+    finally:
+        shutil.rmtree(workdir)
+    if failed:
+        print("FAIL: a thread count wrote a different WAV than one thread")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
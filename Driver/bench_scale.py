@@ -0,0 +1,61 @@
+"""Scale check: parse time of djc must grow linearly with the size of the song.
+
+Generates .dj files with 12.5k, 25k, 50k and 100k patterns (and as many play
+commands), compiles each with `djc --emit-ir --stats` and reads the lex+parse
+time, which covers lexing, the AST and lowering into the growable song storage.
+Prints the time per pattern at every size and exits with status 1 if the
+largest file costs more than MAX_RATIO times as much per pattern as the
+smallest one (a quadratic step would cost 8x).
+
+Usage (from the repo root, after `make djc`):
+    python3 Driver/bench_scale.py [max_patterns]
+"""
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+from bench_parse import generate
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+MAX_RATIO = 2.0
+
+
+def parse_seconds(source, ir_file):
+    result = subprocess.run([os.path.join(ROOT, "djc" + EXE), source, "--emit-ir", ir_file, "--stats"],
+                            check=True, capture_output=True, text=True)
+    return float(re.search(r"lex\+parse ([0-9.]+) ms", result.stderr).group(1)) / 1e3
+
+
+def main():
+    max_patterns = int(sys.argv[1]) if len(sys.argv) > 1 else 100000
+    sizes = [max_patterns // 8, max_patterns // 4, max_patterns // 2, max_patterns]
+    workdir = tempfile.mkdtemp()
+    source = os.path.join(workdir, "scale.dj")
+    ir_file = os.path.join(workdir, "scale.djir")
+    per_pattern = []
+    try:
+        for num_patterns in sizes:
+            generate(source, num_patterns, num_patterns)
+            seconds = min(parse_seconds(source, ir_file) for _ in range(3))
+            per_pattern.append(seconds / num_patterns)
+            print("%7d patterns %7d plays %9.2f ms  %7.0f ns/pattern"
+                  % (num_patterns, num_patterns, seconds * 1e3, per_pattern[-1] * 1e9))
+    finally:
+        for path in (source, ir_file):
+            if os.path.exists(path):
+                os.remove(path)
+        os.rmdir(workdir)
+
+    ratio = per_pattern[-1] / per_pattern[0]
+    print("cost per pattern, largest / smallest: %.2fx (limit %.1fx)" % (ratio, MAX_RATIO))
+    if ratio > MAX_RATIO:
+        print("FAIL: parse time grows faster than linearly")
+        sys.exit(1)
+    print("OK: parse time grows linearly")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,70 @@
+"""Startup-to-first-byte benchmark: legacy `make all` chain vs the single-process djc driver.
+
+Both pipelines only write the WAV once rendering is done, so the time from launching the
+first process until the output file exists is the startup-to-first-byte latency.
+The legacy chain runs in a scratch copy so tokens.txt / transformed_tokens.txt in the repo are untouched.
+
+Usage (from the repo root, after `make lexer djc soundgen`):
+    python3 Driver/bench_startup.py [input.dj] [runs]
+"""
+import os
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+
+
+def run_legacy(workdir, source):
+    lexer_dir = os.path.join(workdir, "Lexer_Parser")
+    sound_dir = os.path.join(workdir, "Sound_Synthesis")
+    with open(os.path.join(lexer_dir, "tokens.txt"), "w") as tokens:
+        subprocess.run([os.path.join(ROOT, "Lexer_Parser", "lexer" + EXE), source], stdout=tokens, check=True)
+    subprocess.run([sys.executable, "transform_tokens.py"], cwd=lexer_dir, check=True, stdout=subprocess.DEVNULL)
+    subprocess.run([sys.executable, "parser.py"], cwd=lexer_dir, check=True, stdout=subprocess.DEVNULL)
+    subprocess.run([os.path.join(ROOT, "Sound_Synthesis", "dj_generator" + EXE)], cwd=sound_dir, check=True,
+                   stdout=subprocess.DEVNULL)
+    return os.path.join(workdir, "NEW_DJcode_Beats.wav")
+
+
+def run_djc(workdir, source):
+    output = os.path.join(workdir, "djc.wav")
+    subprocess.run([os.path.join(ROOT, "djc" + EXE), source, "-o", output], check=True)
+    return output
+
+
+def measure(fn, workdir, source, runs):
+    times = []
+    for _ in range(runs):
+        start = time.perf_counter()
+        output = fn(workdir, source)
+        times.append(time.perf_counter() - start)
+        if not os.path.getsize(output):
+            raise RuntimeError("no output written by " + fn.__name__)
+        os.remove(output)
+    return times
+
+
+def main():
+    source = os.path.abspath(sys.argv[1] if len(sys.argv) > 1 else os.path.join(ROOT, "Lexer_Parser", "test.dj"))
+    runs = int(sys.argv[2]) if len(sys.argv) > 2 else 10
+    workdir = tempfile.mkdtemp(prefix="djbench")
+    try:
+        os.makedirs(os.path.join(workdir, "Lexer_Parser"))
+        os.makedirs(os.path.join(workdir, "Sound_Synthesis"))
+        for script in ("transform_tokens.py", "parser.py"):
+            shutil.copy(os.path.join(ROOT, "Lexer_Parser", script), os.path.join(workdir, "Lexer_Parser"))
+        for name, fn in (("legacy pipeline", run_legacy), ("djc", run_djc)):
+            times = measure(fn, workdir, source, runs)
+            print("%-16s median %8.2f ms   min %8.2f ms   (%d runs)" %
+                  (name, statistics.median(times) * 1e3, min(times) * 1e3, runs))
+    finally:
+        shutil.rmtree(workdir)
+
+
+if __name__ == "__main__":
+    main()
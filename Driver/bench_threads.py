@@ -0,0 +1,68 @@
+"""Scaling of the parallel front end (parse_dj_buffer_parallel) from 1 to N threads.
+
+Generates a .dj file of SIZE_MB megabytes, compiles it with
+`djc --lexer fast --threads T --emit-ir --stats` for T = 1, 2, 4, ... up to
+max_threads, and reports the lex+parse time, GB/s and the speedup over one
+thread. Checks that every thread count writes the same IR as one thread.
+
+The compiled song takes about 8x the size of the source in memory, so the
+default 2 GB input needs a machine with 16 GB or more; pass a smaller size otherwise.
+
+Usage (from the repo root, after `make djc`):
+    python3 Driver/bench_threads.py [size_mb] [max_threads]
+"""
+import filecmp
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+from bench_parse import generate
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+EXE = ".exe" if os.name == "nt" else ""
+
+
+def parse_seconds(source, ir_file, threads):
+    result = subprocess.run([os.path.join(ROOT, "djc" + EXE), source, "--lexer", "fast", "--threads", str(threads),
+                             "--emit-ir", ir_file, "--stats"], check=True, capture_output=True, text=True)
+    return float(re.search(r"lex\+parse ([0-9.]+) ms", result.stderr).group(1)) / 1e3
+
+
+def main():
+    size_mb = float(sys.argv[1]) if len(sys.argv) > 1 else 2048
+    max_threads = int(sys.argv[2]) if len(sys.argv) > 2 else (os.cpu_count() or 1)
+    thread_counts = [1]
+    while thread_counts[-1] * 2 <= max_threads:
+        thread_counts.append(thread_counts[-1] * 2)
+    if thread_counts[-1] != max_threads:
+        thread_counts.append(max_threads)
+
+    workdir = tempfile.mkdtemp()
+    source = os.path.join(workdir, "large.dj")
+    reference = os.path.join(workdir, "reference.djir")
+    ir_file = os.path.join(workdir, "threads.djir")
+    try:
+        num_patterns = int(size_mb * 1e6 / 55) + 1  # A generated pattern is about 55 bytes
+        generate(source, num_patterns, num_patterns // 10)
+        size_gb = os.path.getsize(source) / 1e9
+        print("input: %.2f GB, %d patterns" % (size_gb, num_patterns))
+        baseline = None
+        for threads in thread_counts:
+            seconds = min(parse_seconds(source, reference if threads == 1 else ir_file, threads) for _ in range(2))
+            if threads > 1 and not filecmp.cmp(reference, ir_file, shallow=False):
+                print("FAIL: %d threads compile to a different IR than 1 thread" % threads)
+                sys.exit(1)
+            baseline = baseline or seconds
+            print("%3d threads %10.2f ms  %6.3f GB/s  %5.2fx"
+                  % (threads, seconds * 1e3, size_gb / seconds, baseline / seconds))
+    finally:
+        for path in (source, reference, ir_file):
+            if os.path.exists(path):
+                os.remove(path)
+        os.rmdir(workdir)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,674 @@
+/* djc: single-process DJcode compiler. Runs lex -> parse -> IR -> render -> WAV write in memory,
+ replacing the lexer | transform_tokens.py | parser.py | dj_generator chain of `make all`.
+ A binary IR written with --emit-ir can be rendered later without lexing or parsing.*/
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+#include "parser.h"
+#include "WAVGenerator.h"
+#include "songIR.h"
+#include "soundwaves.h"
+#include "compileCache.h"
+#include "songCodegen.h"
+#include "oscillators.h"
+#include "threadPool.h"
+#include "voice.h"
+
+#define DEFAULT_OUTPUT "output.wav"
+
+/* Wall clock in seconds, used for the --stats stage timings*/
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s input.dj|input.djir [-o out.wav] [--emit-ir out.djir] [--emit-c out.c] [--check] [--lexer flex|fast] [--isa NAME] [--osc NAME] [--pcm clip|limit] [--block N] [--seed N] [--no-bank] [--variations N] [--threads N] [--cache DIR] [--stats]\n", prog);
+    fprintf(stderr, "       %s --batch LIST|DIR [-o OUTDIR] [--lexer flex|fast] [--isa NAME] [--osc NAME] [--pcm clip|limit]\n"
+            "       [--block N] [--seed N] [--no-bank] [--variations N] [--threads N] [--cache DIR]\n", prog);
+    fprintf(stderr, "  --emit-ir FILE  write the compiled binary IR instead of rendering\n");
+    fprintf(stderr, "  --emit-c FILE   write a C renderer specialized for the song instead of rendering\n");
+    fprintf(stderr, "  --check         only lex, parse and check the program (replaces parser.py)\n");
+    fprintf(stderr, "  --batch LIST    compile and render every file named in LIST (one path per line), or every .dj\n");
+    fprintf(stderr, "                  file in directory DIR, to a .wav beside it or in OUTDIR\n");
+    fprintf(stderr, "  --lexer NAME    flex (default, the reference scanner) or fast (SIMD scanner)\n");
+    fprintf(stderr, "  --isa NAME      sound kernels: auto (default), scalar (the reference), sse2, avx2 or avx512\n");
+    fprintf(stderr, "  --osc NAME      oscillators: wavetable (default, band-limited), wavetable-cubic, direct\n");
+    fprintf(stderr, "                  (sin and the naive triangle, the reference), or fixed (every sound in integer\n");
+    fprintf(stderr, "                  arithmetic, the default of builds made with FIXED=1)\n");
+    fprintf(stderr, "  --pcm NAME      conversion of the float mix to 16 bits: clip (default) or limit (soft knee\n");
+    fprintf(stderr, "                  from about -2.5 dBFS)\n");
+    fprintf(stderr, "  --block N       render hits N samples at a time, 64 to 1024 (default 256); the output is the same\n");
+    fprintf(stderr, "  --seed N        seed of the noise in tsst, clap, crash and dun (default 0); every hit's noise\n");
+    fprintf(stderr, "                  depends only on it, the song and the hit's place in the song\n");
+    fprintf(stderr, "  --no-bank       synthesize every hit instead of mixing repeated ones from the sample bank\n");
+    fprintf(stderr, "  --variations N  bank N takes of each noisy sound and spread the hits over them (default 0:\n");
+    fprintf(stderr, "                  every noisy hit is synthesized with its own noise)\n");
+    fprintf(stderr, "  --threads N     lex, parse and render on N threads (default 1; the output is the same); with\n");
+    fprintf(stderr, "                  --batch, the number of files processed at once (default: one per CPU)\n");
+    fprintf(stderr, "  --cache DIR     reuse the compiled IR of unchanged sources (default $DJC_CACHE_DIR, if set)\n");
+    fprintf(stderr, "  --stats         print per-stage timings\n");
+}
+
+/* Parses the name of an --isa choice. Returns 1 if it is one.*/
+static int parse_osc_isa(const char* name, OscIsa* isa) {
+    static const OscIsa choices[] = { OSC_ISA_AUTO, OSC_ISA_SCALAR, OSC_ISA_SSE2, OSC_ISA_AVX2, OSC_ISA_AVX512 };
+    size_t i;
+
+    for (i = 0; i < sizeof(choices) / sizeof(choices[0]); i++) {
+        if (strcmp(name, osc_isa_name(choices[i])) == 0) {
+            *isa = choices[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Parses the name of an --osc choice. Returns 1 if it is one.*/
+static int parse_osc_engine(const char* name, OscEngine* engine) {
+    static const OscEngine choices[] = { OSC_ENGINE_WAVETABLE, OSC_ENGINE_WAVETABLE_CUBIC, OSC_ENGINE_DIRECT,
+                                         OSC_ENGINE_FIXED };
+    size_t i;
+
+    for (i = 0; i < sizeof(choices) / sizeof(choices[0]); i++) {
+        if (strcmp(name, osc_engine_name(choices[i])) == 0) {
+            *engine = choices[i];
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* --stats line of the sample bank*/
+static void print_bank_stats(FILE* fp, const SampleBank* bank) {
+    unsigned long lookups;
+
+    lookups = bank->hits + bank->misses + bank->synthesized;
+    fprintf(fp, "bank: %lu entries, %.1f KB, %lu hits, %lu misses, %lu noisy hits synthesized (hit rate %.1f%%)\n",
+            (unsigned long)bank->num_entries, bank->bytes / 1024.0, bank->hits, bank->misses, bank->synthesized,
+            lookups ? 100.0 * bank->hits / lookups : 0.0);
+}
+
+/* --check: build and validate the AST without rendering*/
+static int check_program(const char* input_filename, const char* source, size_t length, int show_stats) {
+    Arena arena;
+    ProgramNode* program;
+    int result;
+    double t_start, t_parsed;
+
+    arena_init(&arena, 0);
+    t_start = now_seconds();
+    result = parse_dj_ast(source, length, &arena, &program);
+    t_parsed = now_seconds();
+
+    if (result == 0) {
+        printf("%s parsed successfully: %d patterns, %d play commands.\n",
+               input_filename, program->num_patterns, program->num_plays);
+        if (show_stats) {
+            fprintf(stderr, "lex+parse: %8.3f ms (%.1f MB/s), AST arena: %lu bytes\n",
+                    (t_parsed - t_start) * 1e3,
+                    (double)length / 1e6 / (t_parsed - t_start > 0 ? t_parsed - t_start : 1e-9),
+                    (unsigned long)arena.total_bytes);
+        }
+    } else {
+        fprintf(stderr, "Failed to compile %s (Error code: %d).\n", input_filename, result);
+    }
+    arena_release(&arena);
+    return result == 0 ? 0 : 1;
+}
+
+/* Maps the cached IR of a source from cache_dir and counts the hit in counts. Returns 0 on a hit, 1 on a miss.*/
+static int load_cached(const char* cache_dir, const char* key, double t_start, int show_stats, SongIR* ir,
+                       CompileCacheStats* counts) {
+    double compile_seconds;
+    double saved_seconds;
+
+    if (compile_cache_load(cache_dir, key, ir, &compile_seconds) != 0) {
+        return 1;
+    }
+    /* A hit still maps and hashes the source, so only the rest of the original compile is saved*/
+    saved_seconds = compile_seconds - (now_seconds() - t_start);
+    if (saved_seconds < 0.0) saved_seconds = 0.0;
+    counts->hits++;
+    counts->saved_seconds += saved_seconds;
+    if (show_stats) {
+        fprintf(stderr, "cache:     hit, saved %.3f ms\n", saved_seconds * 1e3);
+    }
+    return 0;
+}
+
+/* Lexes and parses a .dj file and builds its IR in memory, or loads the IR from cache_dir (if not NULL)
+ when the same source was compiled before. The hit or miss is added to counts, for compile_cache_record.
+ Returns 0 on success.*/
+static int compile_source(const char* input_filename, const char* cache_dir, int num_threads, int show_stats,
+                          SongIR* ir, double* parse_seconds, CompileCacheStats* counts) {
+    const char* source;
+    size_t source_length;
+    char key[COMPILE_CACHE_KEY_SIZE];
+    Song song;
+    int result;
+    double t_start;
+
+    *parse_seconds = 0.0;
+    if (map_source_file(input_filename, &source, &source_length) != 0) {
+        return -1;
+    }
+    t_start = now_seconds();
+    if (cache_dir) {
+        compile_cache_key(source, source_length, key);
+        if (load_cached(cache_dir, key, t_start, show_stats, ir, counts) == 0) {
+            unmap_source_file(source, source_length);
+            return 0;
+        }
+    }
+
+    song_init(&song);
+    result = parse_dj_buffer_parallel(source, source_length, &song, num_threads);
+    *parse_seconds = now_seconds() - t_start;
+    unmap_source_file(source, source_length);
+    if (result == 0) {
+        result = song_ir_build(&song, ir);
+    }
+    song_release(&song);
+    if (result != 0) {
+        fprintf(stderr, "Failed to compile %s (Error code: %d).\n", input_filename, result);
+        return result;
+    }
+
+    if (cache_dir) {
+        compile_cache_store(cache_dir, key, ir, now_seconds() - t_start);
+        counts->misses++;
+        if (show_stats) {
+            fprintf(stderr, "cache:     miss, stored %s\n", key);
+        }
+    }
+    return 0;
+}
+
+/* One file of a --batch run and what happened to it*/
+typedef struct {
+    const char* input;
+    char* output;
+    int result;            /* 0, or the step that failed: 1 compile, 2 render, 3 write*/
+    double compile_seconds;
+    double render_seconds; /* Rendering and writing the WAV*/
+    size_t samples;
+    CompileCacheStats cache; /* Recorded once for the whole batch*/
+} BatchJob;
+
+typedef struct {
+    BatchJob* jobs;
+    const char* cache_dir;
+    SampleBank* bank;     /* Shared by all jobs, so each distinct hit is synthesized once per run; NULL with --no-bank*/
+} Batch;
+
+static char* copy_string(const char* text, size_t length) {
+    char* copy;
+
+    copy = (char*)malloc(length + 1);
+    if (copy) {
+        memcpy(copy, text, length);
+        copy[length] = '\0';
+    }
+    return copy;
+}
+
+/* Appends a copy of path to *paths. Returns 0, or -1 if out of memory.*/
+static int add_path(char*** paths, size_t* count, size_t* capacity, const char* path, size_t length) {
+    char** grown;
+
+    if (*count == *capacity) {
+        *capacity = *capacity ? *capacity * 2 : 64;
+        grown = (char**)realloc(*paths, *capacity * sizeof(char*));
+        if (!grown) return -1;
+        *paths = grown;
+    }
+    (*paths)[*count] = copy_string(path, length);
+    if (!(*paths)[*count]) return -1;
+    (*count)++;
+    return 0;
+}
+
+static int compare_paths(const void* a, const void* b) {
+    return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+/* The inputs of a batch: the .dj files of a directory in name order, or the lines of a list file
+ (blank lines and lines starting with '#' are skipped). Returns 0, or -1 on file or allocation error.*/
+static int read_batch_inputs(const char* list, char*** paths, size_t* count) {
+    size_t capacity;
+    const char* text;
+    size_t length;
+    size_t start, end, last;
+    int result;
+#ifndef _WIN32
+    struct stat info;
+    DIR* dir;
+    struct dirent* entry;
+    char* path;
+    size_t name_length;
+#endif
+
+    *paths = NULL;
+    *count = 0;
+    capacity = 0;
+    result = 0;
+#ifndef _WIN32
+    if (stat(list, &info) == 0 && S_ISDIR(info.st_mode)) {
+        dir = opendir(list);
+        if (!dir) {
+            perror("Error opening batch directory");
+            return -1;
+        }
+        while (result == 0 && (entry = readdir(dir)) != NULL) {
+            name_length = strlen(entry->d_name);
+            if (name_length < 4 || strcmp(entry->d_name + name_length - 3, ".dj") != 0) continue;
+            path = (char*)malloc(strlen(list) + name_length + 2);
+            if (!path) {
+                result = -1;
+                break;
+            }
+            sprintf(path, "%s/%s", list, entry->d_name);
+            result = add_path(paths, count, &capacity, path, strlen(path));
+            free(path);
+        }
+        closedir(dir);
+        if (result == 0) {
+            qsort(*paths, *count, sizeof(char*), compare_paths);
+        }
+        return result;
+    }
+#endif
+
+    if (map_source_file(list, &text, &length) != 0) {
+        return -1;
+    }
+    for (start = 0; start < length && result == 0; start = end + 1) {
+        for (end = start; end < length && text[end] != '\n'; end++) {
+        }
+        /* Trailing '\r' and blanks are not part of the path*/
+        for (last = end; last > start && (text[last - 1] == '\r' || text[last - 1] == ' ' || text[last - 1] == '\t'); last--) {
+        }
+        if (last > start && text[start] != '#') {
+            result = add_path(paths, count, &capacity, text + start, last - start);
+        }
+    }
+    unmap_source_file(text, length);
+    return result;
+}
+
+/* The WAV path of a batch input: input.dj -> input.wav, placed in out_dir if not NULL*/
+static char* batch_output_path(const char* input, const char* out_dir) {
+    const char* name;
+    const char* slash;
+    size_t name_length;
+    char* path;
+
+    name = input;
+    if (out_dir) {
+        slash = strrchr(input, '/');
+        if (slash) name = slash + 1;
+    }
+    name_length = strlen(name);
+    if (name_length > 3 && strcmp(name + name_length - 3, ".dj") == 0) {
+        name_length -= 3;
+    }
+    path = (char*)malloc((out_dir ? strlen(out_dir) + 1 : 0) + name_length + 5);
+    if (!path) return NULL;
+    if (out_dir) {
+        sprintf(path, "%s/%.*s.wav", out_dir, (int)name_length, name);
+    } else {
+        sprintf(path, "%.*s.wav", (int)name_length, name);
+    }
+    return path;
+}
+
+/* Thread pool task: compiles, renders and writes one file of the batch*/
+static void run_batch_job(void* context, size_t index, int worker) {
+    Batch* batch;
+    BatchJob* job;
+    SongIR ir;
+    int16_t* buffer;
+    WavHeader header;
+    double t_start, t_compiled;
+    double parse_seconds;
+    int result;
+
+    (void)worker;
+    batch = (Batch*)context;
+    job = &batch->jobs[index];
+    t_start = now_seconds();
+
+    result = song_ir_map(job->input, &ir);
+    if (result == -3) {
+        result = compile_source(job->input, batch->cache_dir, 1, 0, &ir, &parse_seconds, &job->cache);
+    }
+    t_compiled = now_seconds();
+    job->compile_seconds = t_compiled - t_start;
+    if (result != 0) {
+        job->result = 1;
+        return;
+    }
+    result = render_song_ir_cached(&ir, batch->bank, &buffer, &job->samples);
+    song_ir_release(&ir);
+    if (result != 0) {
+        job->result = 2;
+        return;
+    }
+    if (job->samples > 0) {
+        initWavHeader(&header, SAMPLE_RATE, BIT_DEPTH, DEFAULT_NUM_CHANNELS);
+        result = writeWavFile(job->output, &header, buffer, job->samples);
+        free(buffer);
+        if (result != 0) {
+            job->result = 3;
+        }
+    }
+    job->render_seconds = now_seconds() - t_compiled;
+}
+
+/* --batch: runs every input as a job on a work-stealing pool and reports per-file and total throughput.
+ bank_variations is the number of variation slots of the sample bank, or -1 for none.
+ Returns the process exit code: 0 if every file was rendered.*/
+static int run_batch(const char* list, const char* out_dir, const char* cache_dir, int num_threads,
+                     int bank_variations) {
+    static const char* const failures[] = { "ok", "compile failed", "render failed", "write failed" };
+    char** inputs;
+    size_t count;
+    Batch batch;
+    SampleBank bank;
+    BatchJob* job;
+    CompileCacheStats cache_counts, cache_totals;
+    size_t i;
+    size_t failed;
+    double audio_seconds, busy_seconds;
+    double t_start, t_end, wall;
+    int result;
+
+    if (read_batch_inputs(list, &inputs, &count) != 0) {
+        fprintf(stderr, "Failed to read batch list %s.\n", list);
+        return 1;
+    }
+    batch.jobs = (BatchJob*)calloc(count ? count : 1, sizeof(BatchJob));
+    /* Warmed up front, so the threads mostly read the bank*/
+    bank.buckets = NULL;
+    result = batch.jobs ? 0 : -1;
+    if (result == 0 && bank_variations >= 0) {
+        result = sample_bank_init(&bank, bank_variations);
+        if (result == 0) result = sample_bank_warm(&bank);
+    }
+    for (i = 0; i < count && result == 0; i++) {
+        batch.jobs[i].input = inputs[i];
+        batch.jobs[i].output = batch_output_path(inputs[i], out_dir);
+        if (!batch.jobs[i].output) result = -1;
+    }
+    batch.cache_dir = cache_dir;
+    batch.bank = bank_variations >= 0 ? &bank : NULL;
+    /* The SIMD set is picked here rather than by the first worker (the bank warm-up does it only with the bank)*/
+    osc_active_isa();
+
+    t_start = now_seconds();
+    if (result == 0) {
+        result = thread_pool_run(num_threads, count, run_batch_job, &batch);
+    }
+    t_end = now_seconds();
+    if (result != 0) {
+        fprintf(stderr, "Out of memory setting up the batch.\n");
+    } else {
+        failed = 0;
+        audio_seconds = 0.0;
+        busy_seconds = 0.0;
+        for (i = 0; i < count; i++) {
+            job = &batch.jobs[i];
+            busy_seconds += job->compile_seconds + job->render_seconds;
+            if (job->result != 0) {
+                failed++;
+                printf("%-40s %s\n", job->input, failures[job->result]);
+                continue;
+            }
+            if (job->samples == 0) {
+                printf("%-40s no beats, nothing written\n", job->input);
+                continue;
+            }
+            audio_seconds += (double)job->samples / SAMPLE_RATE;
+            printf("%-40s compile %8.3f ms  render+write %8.3f ms  %8.1f s audio  %8.1fx realtime\n",
+                   job->input, job->compile_seconds * 1e3, job->render_seconds * 1e3,
+                   (double)job->samples / SAMPLE_RATE,
+                   (double)job->samples / SAMPLE_RATE / (job->compile_seconds + job->render_seconds + 1e-9));
+        }
+        wall = t_end - t_start > 0 ? t_end - t_start : 1e-9;
+        printf("batch: %lu files, %lu failed, %d threads, %.3f s wall (%.3f s busy)\n",
+               (unsigned long)count, (unsigned long)failed,
+               num_threads < (int)count ? num_threads : (int)(count ? count : 1), wall, busy_seconds);
+        printf("throughput: %.1f files/s, %.1f s of audio in total (%.1fx realtime)\n",
+               (double)count / wall, audio_seconds, audio_seconds / wall);
+        if (batch.bank) print_bank_stats(stdout, batch.bank);
+        if (cache_dir) {
+            memset(&cache_counts, 0, sizeof(cache_counts));
+            for (i = 0; i < count; i++) {
+                cache_counts.hits += batch.jobs[i].cache.hits;
+                cache_counts.misses += batch.jobs[i].cache.misses;
+                cache_counts.saved_seconds += batch.jobs[i].cache.saved_seconds;
+            }
+            compile_cache_record(cache_dir, &cache_counts, &cache_totals);
+            printf("cache: %lu hits, %lu misses (total %lu hits, %lu misses, %.3f ms saved)\n",
+                   cache_counts.hits, cache_counts.misses, cache_totals.hits, cache_totals.misses,
+                   cache_totals.saved_seconds * 1e3);
+        }
+        result = failed ? 1 : 0;
+    }
+    if (bank.buckets) sample_bank_release(&bank);
+
+    for (i = 0; i < count; i++) {
+        if (batch.jobs) free(batch.jobs[i].output);
+        free(inputs[i]);
+    }
+    free(batch.jobs);
+    free(inputs);
+    return result == 0 ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    const char* input_filename;
+    const char* output_filename;
+    const char* ir_filename;
+    const char* c_filename;
+    const char* cache_dir;
+    const char* batch_list;
+    int show_stats;
+    int check_only;
+    int num_threads;
+    OscIsa isa;
+    OscEngine engine;
+    int bank_variations;
+    SampleBank bank;
+    const char* source;
+    size_t source_length;
+    SongIR ir;
+    CompileCacheStats cache_counts, cache_totals;
+    int16_t *buffer;
+    size_t total_samples;
+    WavHeader header;
+    int result;
+    int i;
+    double t_start, t_loaded, t_rendered, t_written;
+    double parse_seconds;
+
+    t_start = now_seconds();
+    parse_seconds = 0.0;
+    input_filename = NULL;
+    output_filename = NULL;
+    ir_filename = NULL;
+    c_filename = NULL;
+    cache_dir = getenv("DJC_CACHE_DIR");
+    batch_list = NULL;
+    show_stats = 0;
+    check_only = 0;
+    num_threads = 0;
+    bank_variations = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            output_filename = argv[++i];
+        } else if (strcmp(argv[i], "--emit-ir") == 0 && i + 1 < argc) {
+            ir_filename = argv[++i];
+        } else if (strcmp(argv[i], "--emit-c") == 0 && i + 1 < argc) {
+            c_filename = argv[++i];
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batch_list = argv[++i];
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = 1;
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check_only = 1;
+        } else if (strcmp(argv[i], "--lexer") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "flex") == 0 || strcmp(argv[i + 1], "fast") == 0)) {
+            parser_set_lexer(strcmp(argv[++i], "fast") == 0 ? LEXER_FAST : LEXER_FLEX);
+        } else if (strcmp(argv[i], "--isa") == 0 && i + 1 < argc && parse_osc_isa(argv[i + 1], &isa)) {
+            osc_set_isa(isa);
+            i++;
+        } else if (strcmp(argv[i], "--osc") == 0 && i + 1 < argc && parse_osc_engine(argv[i + 1], &engine)) {
+            osc_set_engine(engine);
+            i++;
+        } else if (strcmp(argv[i], "--pcm") == 0 && i + 1 < argc &&
+                   (strcmp(argv[i + 1], "clip") == 0 || strcmp(argv[i + 1], "limit") == 0)) {
+            mix_set_output(strcmp(argv[++i], "limit") == 0 ? MIX_OUTPUT_LIMIT : MIX_OUTPUT_CLIP);
+        } else if (strcmp(argv[i], "--block") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= VOICE_BLOCK_MIN &&
+                   atoi(argv[i + 1]) <= VOICE_BLOCK_MAX) {
+            voice_set_block_frames(atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--no-bank") == 0) {
+            bank_variations = -1;
+        } else if (strcmp(argv[i], "--variations") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0) {
+            bank_variations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            noise_set_song_seed(strtoul(argv[++i], NULL, 0));
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            num_threads = atoi(argv[++i]);
+        } else if (argv[i][0] != '-' && !input_filename) {
+            input_filename = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cache_dir && !*cache_dir) {
+        cache_dir = NULL;
+    }
+    if (batch_list) {
+        if (input_filename || ir_filename || c_filename || check_only) {
+            usage(argv[0]);
+            return 1;
+        }
+        return run_batch(batch_list, output_filename, cache_dir,
+                         num_threads > 0 ? num_threads : thread_pool_cpu_count(), bank_variations);
+    }
+    if (!input_filename) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!output_filename) {
+        output_filename = DEFAULT_OUTPUT;
+    }
+    if (num_threads == 0) {
+        num_threads = 1;
+    }
+
+    if (check_only) {
+        if (map_source_file(input_filename, &source, &source_length) != 0) {
+            return 1;
+        }
+        result = check_program(input_filename, source, source_length, show_stats);
+        unmap_source_file(source, source_length);
+        return result;
+    }
+
+    /* A compiled .djir is mapped and used as is; anything else is compiled from .dj source*/
+    result = song_ir_map(input_filename, &ir);
+    if (result == -3) {
+        memset(&cache_counts, 0, sizeof(cache_counts));
+        result = compile_source(input_filename, cache_dir, num_threads, show_stats, &ir, &parse_seconds,
+                                &cache_counts);
+        if (result == 0 && cache_dir) {
+            compile_cache_record(cache_dir, &cache_counts, &cache_totals);
+            if (show_stats) {
+                fprintf(stderr, "cache:     total %lu hits, %lu misses, %.3f ms saved\n",
+                        cache_totals.hits, cache_totals.misses, cache_totals.saved_seconds * 1e3);
+            }
+        }
+    }
+    if (result != 0) {
+        return 1;
+    }
+    t_loaded = now_seconds();
+
+    if (ir_filename || c_filename) {
+        result = ir_filename ? song_ir_write(&ir, ir_filename) : 0;
+        if (result == 0 && c_filename) {
+            result = song_ir_emit_c(&ir, input_filename, c_filename);
+        }
+        song_ir_release(&ir);
+        if (show_stats) {
+            fprintf(stderr, "compile:   %8.3f ms (lex+parse %.3f ms)\n", (t_loaded - t_start) * 1e3, parse_seconds * 1e3);
+        }
+        return result == 0 ? 0 : 1;
+    }
+
+    if (bank_variations >= 0) {
+        if (sample_bank_init(&bank, bank_variations) != 0) {
+            fprintf(stderr, "Out of memory.\n");
+            song_ir_release(&ir);
+            return 1;
+        }
+    }
+    result = render_song_ir_parallel(&ir, bank_variations >= 0 ? &bank : NULL, num_threads, &buffer, &total_samples);
+    if (result != 0) {
+        if (bank_variations >= 0) sample_bank_release(&bank);
+        song_ir_release(&ir);
+        return 1;
+    }
+    if (total_samples == 0) {
+        fprintf(stderr, "No beats to generate.\n");
+        if (bank_variations >= 0) sample_bank_release(&bank);
+        song_ir_release(&ir);
+        return 0;
+    }
+    t_rendered = now_seconds();
+
+    initWavHeader(&header, SAMPLE_RATE, BIT_DEPTH, DEFAULT_NUM_CHANNELS);
+    result = writeWavFile(output_filename, &header, buffer, total_samples);
+    free(buffer);
+    if (result != 0) {
+        fprintf(stderr, "Failed to write WAV file (Error code: %d).\n", result);
+        if (bank_variations >= 0) sample_bank_release(&bank);
+        song_ir_release(&ir);
+        return 1;
+    }
+    t_written = now_seconds();
+
+    if (show_stats) {
+        fprintf(stderr, "patterns: %lu, play commands: %lu, samples: %lu, kernels: %s %s, block: %d, pcm: %s\n",
+                (unsigned long)ir.header->num_patterns, (unsigned long)ir.header->num_plays,
+                (unsigned long)total_samples, osc_isa_name(osc_active_isa()), osc_engine_name(osc_active_engine()),
+                voice_block_frames(), mix_output_name(mix_active_output()));
+        if (ir.is_mapped) {
+            fprintf(stderr, "map IR:    %8.3f ms\n", (t_loaded - t_start) * 1e3);
+        } else {
+            fprintf(stderr, "compile:   %8.3f ms (lex+parse %.3f ms)\n", (t_loaded - t_start) * 1e3, parse_seconds * 1e3);
+        }
+        fprintf(stderr, "render:    %8.3f ms (%d thread%s)\n", (t_rendered - t_loaded) * 1e3, num_threads,
+                num_threads > 1 ? "s" : "");
+        fprintf(stderr, "write:     %8.3f ms\n", (t_written - t_rendered) * 1e3);
+        fprintf(stderr, "total:     %8.3f ms\n", (t_written - t_start) * 1e3);
+        if (bank_variations >= 0) print_bank_stats(stderr, &bank);
+    }
+    if (bank_variations >= 0) sample_bank_release(&bank);
+    song_ir_release(&ir);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+/* Alignment good enough for any of our node types*/
+typedef union {
+    long l;
+    double d;
+    void *p;
+} ArenaAlign;
+
+#define ARENA_ALIGNMENT sizeof(ArenaAlign)
+#define ARENA_ROUND_UP(n) (((n) + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT)
+#define ARENA_HEADER_SIZE ARENA_ROUND_UP(sizeof(ArenaBlock))
+
+void arena_init(Arena *arena, size_t block_size) {
+    arena->head = NULL;
+    arena->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    arena->total_bytes = 0;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    ArenaBlock *block;
+    size_t block_size;
+    void *result;
+
+    size = ARENA_ROUND_UP(size ? size : 1);
+    block = arena->head;
+
+    if (!block || block->size - block->used < size) {
+        block_size = size > arena->block_size ? size : arena->block_size;
+        block = (ArenaBlock *)malloc(ARENA_HEADER_SIZE + block_size);
+        if (!block) {
+            return NULL;
+        }
+        block->used = 0;
+        block->size = block_size;
+        if (size > arena->block_size && arena->head) {
+            /* Oversized requests get a block of their own behind the current one, which keeps its free space*/
+            block->next = arena->head->next;
+            arena->head->next = block;
+        } else {
+            block->next = arena->head;
+            arena->head = block;
+        }
+    }
+
+    result = (char *)block + ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+    arena->total_bytes += size;
+    return result;
+}
+
+void *arena_grow(Arena *arena, void *old, size_t old_size, size_t new_size) {
+    ArenaBlock *block;
+    char *block_end;
+    void *result;
+
+    if (!old) {
+        return arena_alloc(arena, new_size);
+    }
+    old_size = ARENA_ROUND_UP(old_size);
+    new_size = ARENA_ROUND_UP(new_size);
+    if (new_size <= old_size) {
+        return old;
+    }
+
+    /* Extend in place if old is the most recent allocation in the current block*/
+    block = arena->head;
+    block_end = (char *)block + ARENA_HEADER_SIZE + block->used;
+    if ((char *)old + old_size == block_end && block->size - block->used >= new_size - old_size) {
+        block->used += new_size - old_size;
+        arena->total_bytes += new_size - old_size;
+        return old;
+    }
+
+    result = arena_alloc(arena, new_size);
+    if (result) {
+        memcpy(result, old, old_size);
+    }
+    return result;
+}
+
+char *arena_strndup(Arena *arena, const char *text, size_t length) {
+    char *copy;
+
+    copy = (char *)arena_alloc(arena, length + 1);
+    if (!copy) {
+        return NULL;
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+void arena_adopt(Arena *arena, Arena *other) {
+    ArenaBlock *tail;
+
+    if (!other->head) {
+        return;
+    }
+    if (!arena->head) {
+        arena->head = other->head;
+    } else {
+        /* Behind the current block, so in-place growth of the last allocation still works*/
+        for (tail = other->head; tail->next; tail = tail->next) {
+        }
+        tail->next = arena->head->next;
+        arena->head->next = other->head;
+    }
+    arena->total_bytes += other->total_bytes;
+    other->head = NULL;
+    other->total_bytes = 0;
+}
+
+void arena_release(Arena *arena) {
+    ArenaBlock *block;
+    ArenaBlock *next;
+
+    for (block = arena->head; block; block = next) {
+        next = block->next;
+        free(block);
+    }
+    arena->head = NULL;
+    arena->total_bytes = 0;
+}
@@ -0,0 +1,40 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h> /* For size_t*/
+
+/* Bump allocator. Everything allocated from an arena is freed together by arena_release,
+ so tree-shaped data (the AST, song tables) needs no per-node free.*/
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    size_t size;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    size_t block_size;  /* Default size of new blocks*/
+    size_t total_bytes; /* Bytes handed out so far, for statistics*/
+} Arena;
+
+void arena_init(Arena *arena, size_t block_size);
+
+/* Returns size bytes aligned for any type, or NULL if out of memory. Memory is not zeroed.*/
+void *arena_alloc(Arena *arena, size_t size);
+
+/* Resizes an allocation made from this arena. The last allocation is grown in place when the block has room,
+ otherwise the data is copied to a new allocation (the old space is reclaimed only by arena_release).
+ Doubling the size on each call keeps growable arrays amortised O(1) per element. Returns NULL if out of memory.*/
+void *arena_grow(Arena *arena, void *old, size_t old_size, size_t new_size);
+
+/* Copies length bytes of text into the arena and NUL terminates them*/
+char *arena_strndup(Arena *arena, const char *text, size_t length);
+
+/* Moves every block of other into arena, which frees them on release. Nothing is copied, so pointers into
+ other stay valid; other is left empty. Used to merge the per-thread arenas of the parallel parser.*/
+void arena_adopt(Arena *arena, Arena *other);
+
+/* Frees every block at once and leaves the arena empty but usable*/
+void arena_release(Arena *arena);
+
+#endif /* ARENA_H*/
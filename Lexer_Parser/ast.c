@@ -0,0 +1,312 @@
+#include "ast.h"
+#include "nameTable.h"
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Same table as VALID_SOUNDS in parser.py*/
+typedef struct {
+    const char *instrument;
+    const char *const *sounds;
+} InstrumentSounds;
+
+static const char *const DRUM_SOUNDS[] = {"boom", "clap", "tsst", "crash", "rest", "dun", NULL};
+static const char *const TRIANGLE_SOUNDS[] = {"ding", "diding", "dididing", NULL};
+static const char *const PIANO_SOUNDS[] = {"D2", "G2", "A2", "B2", "D3", "G3", "A3", "B3", "Cs4", "D4", "E4", "Fs4",
+                                           "G4", "A4", "B4", "DM", "AM1st", "Bm1st", "GM2nd", NULL};
+
+static const InstrumentSounds VALID_SOUNDS[] = {
+    {"Drum", DRUM_SOUNDS},
+    {"Triangle", TRIANGLE_SOUNDS},
+    {"Piano", PIANO_SOUNDS},
+    {NULL, NULL}
+};
+
+/* Cursor over the token array. Kept per call so several files can be parsed in parallel.*/
+typedef struct {
+    const char *source;
+    const Token *tokens;
+    size_t count;
+    size_t pos;
+    int flags;                       /* AST_QUIET, AST_DEFER_PLAY_BINDING*/
+    Arena *arena;
+    NameTable pattern_numbers;       /* Pattern number text -> index in patterns_by_index*/
+    const PatternNode **patterns_by_index;
+    size_t patterns_capacity;
+} AstParser;
+
+static int peek(const AstParser *p) {
+    return p->pos < p->count ? (int)p->tokens[p->pos].type : TOK_EOF;
+}
+
+static int line_of(const AstParser *p) {
+    if (p->count == 0) return 1;
+    return p->tokens[p->pos < p->count ? p->pos : p->count - 1].line;
+}
+
+/* Prints a diagnostic on stderr unless the parse is quiet*/
+static void report(const AstParser *p, const char *format, ...) {
+    va_list args;
+
+    if (p->flags & AST_QUIET) return;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+static int expect(const AstParser *p, int token, const char *message) {
+    if (peek(p) != token) {
+        report(p, "Syntax error (line %d): %s\n", line_of(p), message);
+        return -2;
+    }
+    return 0;
+}
+
+/* Arena copy of the current token's text*/
+static const char *token_text(AstParser *p) {
+    const Token *token;
+
+    token = &p->tokens[p->pos];
+    return arena_strndup(p->arena, p->source + token->offset, token->length);
+}
+
+static const char *const *valid_sounds_for(const char *instrument) {
+    int i;
+    for (i = 0; VALID_SOUNDS[i].instrument != NULL; i++) {
+        if (strcmp(VALID_SOUNDS[i].instrument, instrument) == 0) return VALID_SOUNDS[i].sounds;
+    }
+    return NULL;
+}
+
+static int is_valid_sound(const char *const *sounds, const char *sound) {
+    int i;
+    for (i = 0; sounds[i] != NULL; i++) {
+        if (strcmp(sounds[i], sound) == 0) return 1;
+    }
+    return 0;
+}
+
+/* INSTRUMENT INSTRUMENT_SOUND+ */
+static int parse_instrument_sound_group(AstParser *p, InstrumentGroupNode **out) {
+    InstrumentGroupNode *group;
+    SoundNode *sound;
+    SoundNode **tail;
+    const char *const *sounds;
+
+    group = (InstrumentGroupNode *)arena_alloc(p->arena, sizeof(InstrumentGroupNode));
+    if (!group || !(group->instrument = token_text(p))) return -1;
+    group->line = line_of(p);
+    group->sounds = NULL;
+    group->num_sounds = 0;
+    group->next = NULL;
+
+    sounds = valid_sounds_for(group->instrument);
+    if (!sounds) {
+        report(p, "Error (line %d): Unknown instrument '%s'\n", group->line, group->instrument);
+        return -2;
+    }
+    p->pos++;
+
+    if (peek(p) != TOK_INSTRUMENT_SOUND) {
+        report(p, "Error (line %d): Instrument '%s' declared with no sound!\n", line_of(p), group->instrument);
+        return -2;
+    }
+
+    tail = &group->sounds;
+    while (peek(p) == TOK_INSTRUMENT_SOUND) {
+        sound = (SoundNode *)arena_alloc(p->arena, sizeof(SoundNode));
+        if (!sound || !(sound->name = token_text(p))) return -1;
+        sound->line = line_of(p);
+        sound->next = NULL;
+        if (!is_valid_sound(sounds, sound->name)) {
+            report(p, "Error (line %d): '%s' is not valid for instrument '%s'\n",
+                   sound->line, sound->name, group->instrument);
+            return -2;
+        }
+        *tail = sound;
+        tail = &sound->next;
+        group->num_sounds++;
+        p->pos++;
+    }
+
+    *out = group;
+    return 0;
+}
+
+/* PATTERN NUMBER COLON instrument_sound_group* */
+static int parse_named_pattern(AstParser *p, PatternNode **out) {
+    PatternNode *pattern;
+    InstrumentGroupNode **tail;
+    int result;
+
+    if (expect(p, TOK_PATTERN, "Expected PATTERN") != 0) return -2;
+    p->pos++;
+    if (expect(p, TOK_NUMBER, "Expected NUMBER") != 0) return -2;
+
+    pattern = (PatternNode *)arena_alloc(p->arena, sizeof(PatternNode));
+    if (!pattern || !(pattern->number = token_text(p))) return -1;
+    pattern->line = line_of(p);
+    pattern->groups = NULL;
+    pattern->num_sounds = 0;
+    pattern->next = NULL;
+    p->pos++;
+
+    if (expect(p, TOK_COLON, "Expected COLON") != 0) return -2;
+    p->pos++;
+
+    tail = &pattern->groups;
+    while (peek(p) == TOK_INSTRUMENT) {
+        result = parse_instrument_sound_group(p, tail);
+        if (result != 0) return result;
+        pattern->num_sounds += (*tail)->num_sounds;
+        tail = &(*tail)->next;
+    }
+
+    *out = pattern;
+    return 0;
+}
+
+/* Records a defined pattern so MAIN can find it in O(1). A repeated number keeps its first definition.*/
+static int index_pattern(AstParser *p, const ProgramNode *program, const PatternNode *pattern) {
+    const PatternNode **grown;
+    size_t index;
+    int inserted;
+
+    index = (size_t)program->num_patterns;
+    if (index == p->patterns_capacity) {
+        grown = (const PatternNode **)arena_grow(p->arena, (void *)p->patterns_by_index,
+                                                 p->patterns_capacity * sizeof(PatternNode *),
+                                                 (p->patterns_capacity ? p->patterns_capacity * 2 : 64) * sizeof(PatternNode *));
+        if (!grown) return -1;
+        p->patterns_by_index = grown;
+        p->patterns_capacity = p->patterns_capacity ? p->patterns_capacity * 2 : 64;
+    }
+    p->patterns_by_index[index] = pattern;
+    if (!name_table_insert(&p->pattern_numbers, pattern->number, strlen(pattern->number), (uint32_t)index, &inserted)) {
+        return -1;
+    }
+    return 0;
+}
+
+static const PatternNode *find_pattern(const AstParser *p, const char *number) {
+    const NameTableEntry *entry;
+
+    entry = name_table_find(&p->pattern_numbers, number, strlen(number));
+    return entry ? p->patterns_by_index[entry->value] : NULL;
+}
+
+/* PLAY PATTERN NUMBER LOOP NUMBER */
+static int parse_play_command(AstParser *p, PlayNode **out) {
+    PlayNode *play;
+
+    if (expect(p, TOK_PLAY, "Expected PLAY after COLON") != 0) return -2;
+    p->pos++;
+    if (expect(p, TOK_PATTERN, "Expected PATTERN after PLAY") != 0) return -2;
+    p->pos++;
+    if (expect(p, TOK_NUMBER, "Expected NUMBER after PATTERN") != 0) return -2;
+
+    play = (PlayNode *)arena_alloc(p->arena, sizeof(PlayNode));
+    if (!play || !(play->pattern_number = token_text(p))) return -1;
+    play->line = line_of(p);
+    play->next = NULL;
+    play->pattern = NULL;
+    if (!(p->flags & AST_DEFER_PLAY_BINDING)) {
+        play->pattern = find_pattern(p, play->pattern_number);
+        if (!play->pattern) {
+            report(p, "Error (line %d): Pattern %s used in MAIN but not defined earlier\n",
+                   play->line, play->pattern_number);
+            return -2;
+        }
+    }
+    p->pos++;
+
+    if (expect(p, TOK_LOOP, "Expected LOOP") != 0) return -2;
+    p->pos++;
+    if (expect(p, TOK_NUMBER, "Expected NUMBER after LOOP") != 0) return -2;
+    play->loop_count = p->tokens[p->pos].value;
+    /* Any count parser.py accepts, x0 included, as long as it fits PlayCommand.loop_count (an int)*/
+    if (play->loop_count > INT_MAX) {
+        report(p, "Error (line %d): Loop count must be at most %d.\n", line_of(p), INT_MAX);
+        return -2;
+    }
+    p->pos++;
+
+    *out = play;
+    return 0;
+}
+
+/* MAIN COLON play_command* */
+static int parse_main_block(AstParser *p, ProgramNode *program) {
+    PlayNode **tail;
+    int result;
+
+    p->pos++;
+    if (expect(p, TOK_COLON, "Expected COLON after MAIN") != 0) return -2;
+    p->pos++;
+    program->has_main = 1;
+
+    tail = &program->plays;
+    while (peek(p) != TOK_EOF) {
+        result = parse_play_command(p, tail);
+        if (result != 0) return result;
+        program->num_plays++;
+        tail = &(*tail)->next;
+    }
+    return 0;
+}
+
+static int parse_program(AstParser *p, ProgramNode *program) {
+    PatternNode **tail;
+    int result;
+
+    /* program: named_pattern* main_block? EOF*/
+    tail = &program->patterns;
+    while (peek(p) != TOK_EOF && peek(p) != TOK_MAIN) {
+        result = parse_named_pattern(p, tail);
+        if (result != 0) return result;
+        if (!(p->flags & AST_DEFER_PLAY_BINDING) && index_pattern(p, program, *tail) != 0) return -1;
+        program->num_patterns++;
+        tail = &(*tail)->next;
+    }
+    if (peek(p) == TOK_MAIN) {
+        return parse_main_block(p, program);
+    }
+    return 0;
+}
+
+int ast_parse_tokens(const char *source, const TokenArray *tokens, Arena *arena, int flags, ProgramNode **out) {
+    AstParser p;
+    ProgramNode *program;
+    int result;
+
+    *out = NULL;
+    p.source = source;
+    p.tokens = tokens->tokens;
+    p.count = tokens->count;
+    p.pos = 0;
+    p.flags = flags;
+    p.arena = arena;
+    name_table_init(&p.pattern_numbers);
+    p.patterns_by_index = NULL;
+    p.patterns_capacity = 0;
+
+    program = (ProgramNode *)arena_alloc(arena, sizeof(ProgramNode));
+    if (!program) return -1;
+    program->patterns = NULL;
+    program->num_patterns = 0;
+    program->has_main = 0;
+    program->plays = NULL;
+    program->num_plays = 0;
+
+    result = parse_program(&p, program);
+    name_table_free(&p.pattern_numbers);
+    if (result != 0) return result;
+
+    *out = program;
+    return 0;
+}
+
+int ast_parse_program(const char *source, const TokenArray *tokens, Arena *arena, ProgramNode **program) {
+    return ast_parse_tokens(source, tokens, arena, 0, program);
+}
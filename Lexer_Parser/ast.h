@@ -0,0 +1,63 @@
+#ifndef AST_H
+#define AST_H
+
+#include "arena.h"
+#include "lexer.h"
+
+/* Typed syntax tree of a .dj program:
+ program -> patterns -> instrument groups -> sounds, and main -> play commands.
+ All nodes and strings live in one Arena and are freed with arena_release.*/
+
+typedef struct SoundNode {
+    const char *name;       /* As written, e.g. "boom"*/
+    int line;
+    struct SoundNode *next;
+} SoundNode;
+
+typedef struct InstrumentGroupNode {
+    const char *instrument; /* "Drum" or "Triangle"*/
+    int line;
+    SoundNode *sounds;
+    int num_sounds;
+    struct InstrumentGroupNode *next;
+} InstrumentGroupNode;
+
+typedef struct PatternNode {
+    const char *number;     /* Digits after "Pattern", as written*/
+    int line;
+    InstrumentGroupNode *groups;
+    int num_sounds;         /* Total over all groups*/
+    struct PatternNode *next;
+} PatternNode;
+
+typedef struct PlayNode {
+    const char *pattern_number;
+    const PatternNode *pattern; /* Bound by the semantic check (NULL with AST_DEFER_PLAY_BINDING)*/
+    long loop_count;
+    int line;
+    struct PlayNode *next;
+} PlayNode;
+
+typedef struct {
+    PatternNode *patterns;
+    int num_patterns;
+    int has_main;           /* 1 if a "Drop the beat:" block was present*/
+    PlayNode *plays;
+    int num_plays;
+} ProgramNode;
+
+/* Recursive-descent parse of tokens (lexed from source) into an AST allocated in arena.
+ Applies the same checks as parser.py: grammar, the instrument/sound table, and that every
+ pattern played in MAIN is defined before it.
+ Returns 0 on success, -1 on allocation error, -2 on syntax or semantic error (reported on stderr).*/
+int ast_parse_program(const char *source, const TokenArray *tokens, Arena *arena, ProgramNode **program);
+
+/* Flags of ast_parse_tokens*/
+#define AST_QUIET 1              /* Do not print diagnostics; the caller reparses to report them*/
+#define AST_DEFER_PLAY_BINDING 2 /* Leave PlayNode.pattern NULL and skip the "defined earlier" check, for a chunk
+                                    of a file whose MAIN refers to patterns defined in other chunks*/
+
+/* ast_parse_program with flags*/
+int ast_parse_tokens(const char *source, const TokenArray *tokens, Arena *arena, int flags, ProgramNode **program);
+
+#endif /* AST_H*/
@@ -0,0 +1,329 @@
+/* Hand-written scanner for .dj sources, an alternative to the flex scanner built from lexer.l.
+ It follows the same rules: keywords, digit runs and ":" become tokens, everything else is skipped.
+ No keyword is a prefix of another, so at any byte at most one rule can produce a token and flex's
+ longest-match choice reduces to "try the keywords that start with this byte".
+ The source is classified in 32-byte blocks into two bit masks: bytes that can start a token and newlines.
+ Only the set bits are visited, so runs of whitespace and ignored characters cost one block compare.*/
+#include "lexer.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FAST_LEXER_X86 1
+#include <immintrin.h>
+#endif
+
+#define BLOCK_SIZE 32
+
+/* Fills starts and newlines with one bit per byte of block[0 .. BLOCK_SIZE)*/
+typedef void (*ClassifyBlock)(const char *block, uint32_t *starts, uint32_t *newlines);
+
+/* Bytes that begin some token: the first letters of the keywords (the note names take all of 'A' .. 'G'), ':'
+ and digits*/
+static int is_token_start(unsigned char c) {
+    switch (c) {
+        case 'P': case 'T': case 'b': case 't': case 'c': case 'd': case 'r': case 'x': case ':':
+            return 1;
+        default:
+            return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'G');
+    }
+}
+
+/* Classifies count <= BLOCK_SIZE bytes; used for the last partial block and when there is no SIMD*/
+static void classify_scalar(const char *block, size_t count, uint32_t *starts, uint32_t *newlines) {
+    size_t i;
+    unsigned char c;
+
+    *starts = 0;
+    *newlines = 0;
+    for (i = 0; i < count; i++) {
+        c = (unsigned char)block[i];
+        if (c == '\n') {
+            *newlines |= (uint32_t)1 << i;
+        } else if (is_token_start(c)) {
+            *starts |= (uint32_t)1 << i;
+        }
+    }
+}
+
+static void classify_block_scalar(const char *block, uint32_t *starts, uint32_t *newlines) {
+    classify_scalar(block, BLOCK_SIZE, starts, newlines);
+}
+
+#ifdef FAST_LEXER_X86
+/* Mask of the bytes of v that can start a token. Digits and 'A' .. 'G' are found with one unsigned range compare
+ each.*/
+__attribute__((target("sse2")))
+static __m128i token_starts_sse2(__m128i v) {
+    __m128i digits, letters, mask;
+
+    digits = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    mask = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    letters = _mm_sub_epi8(v, _mm_set1_epi8('A'));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8('G' - 'A')), letters));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('P')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('T')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('b')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('t')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('c')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('d')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('r')));
+    mask = _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8('x')));
+    return _mm_or_si128(mask, _mm_cmpeq_epi8(v, _mm_set1_epi8(':')));
+}
+
+__attribute__((target("sse2")))
+static void classify_block_sse2(const char *block, uint32_t *starts, uint32_t *newlines) {
+    __m128i low, high;
+    __m128i newline;
+
+    low = _mm_loadu_si128((const __m128i *)block);
+    high = _mm_loadu_si128((const __m128i *)(block + 16));
+    newline = _mm_set1_epi8('\n');
+    *starts = (uint32_t)_mm_movemask_epi8(token_starts_sse2(low)) |
+              (uint32_t)_mm_movemask_epi8(token_starts_sse2(high)) << 16;
+    *newlines = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(low, newline)) |
+                (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(high, newline)) << 16;
+}
+
+__attribute__((target("avx2")))
+static void classify_block_avx2(const char *block, uint32_t *starts, uint32_t *newlines) {
+    __m256i v, digits, letters, mask;
+
+    v = _mm256_loadu_si256((const __m256i *)block);
+    digits = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    mask = _mm256_cmpeq_epi8(_mm256_min_epu8(digits, _mm256_set1_epi8(9)), digits);
+    letters = _mm256_sub_epi8(v, _mm256_set1_epi8('A'));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(_mm256_min_epu8(letters, _mm256_set1_epi8('G' - 'A')), letters));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('P')));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('T')));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('b')));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('t')));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('c')));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('d')));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('r')));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('x')));
+    mask = _mm256_or_si256(mask, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')));
+    *starts = (uint32_t)_mm256_movemask_epi8(mask);
+    *newlines = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+}
+#endif
+
+/* Index of the lowest set bit of a non-zero mask*/
+static unsigned lowest_bit(uint32_t bits) {
+#ifdef __GNUC__
+    return (unsigned)__builtin_ctz(bits);
+#else
+    unsigned i;
+
+    for (i = 0; !(bits & 1u); i++) bits >>= 1;
+    return i;
+#endif
+}
+
+LexIsa lex_isa_resolve(LexIsa isa) {
+#ifdef FAST_LEXER_X86
+    if ((isa == LEX_ISA_AUTO || isa == LEX_ISA_AVX2) && __builtin_cpu_supports("avx2")) {
+        return LEX_ISA_AVX2;
+    }
+    if (isa != LEX_ISA_SCALAR && __builtin_cpu_supports("sse2")) {
+        return LEX_ISA_SSE2;
+    }
+#else
+    (void)isa;
+#endif
+    return LEX_ISA_SCALAR;
+}
+
+const char *lex_isa_name(LexIsa isa) {
+    switch (isa) {
+        case LEX_ISA_SCALAR: return "scalar";
+        case LEX_ISA_SSE2:   return "sse2";
+        case LEX_ISA_AVX2:   return "avx2";
+        default:             return "auto";
+    }
+}
+
+static ClassifyBlock select_classifier(LexIsa isa) {
+    switch (lex_isa_resolve(isa)) {
+#ifdef FAST_LEXER_X86
+        case LEX_ISA_AVX2: return classify_block_avx2;
+        case LEX_ISA_SSE2: return classify_block_sse2;
+#endif
+        default:           return classify_block_scalar;
+    }
+}
+
+/* Length of word if source[offset ..] starts with it, 0 otherwise*/
+static size_t match_word(const char *source, size_t length, size_t offset, const char *word, size_t word_length) {
+    if (length - offset < word_length || memcmp(source + offset, word, word_length) != 0) {
+        return 0;
+    }
+    return word_length;
+}
+
+/* Length of a note name at source[offset]: its letter (already matched) and an octave from low to high, 0 if none*/
+static size_t match_octave(const char *source, size_t length, size_t offset, char low, char high) {
+    if (length - offset < 2 || source[offset + 1] < low || source[offset + 1] > high) {
+        return 0;
+    }
+    return 2;
+}
+
+/* Matches the token starting at source[offset], whose byte is a token start.
+ Returns its length (0 if no rule matches there, so flex would skip the byte) and sets *type and *value.*/
+static size_t match_token(const char *source, size_t length, size_t offset, TokenType *type, long *value) {
+    size_t end;
+    size_t matched;
+    long number;
+    int digit;
+
+    *value = 0;
+    switch (source[offset]) {
+        case ':':
+            *type = TOK_COLON;
+            return 1;
+        case 'x':
+            *type = TOK_LOOP;
+            return 1;
+        case 'P':
+            *type = TOK_PATTERN;
+            if ((matched = match_word(source, length, offset, "Pattern", 7)) != 0) return matched;
+            *type = TOK_INSTRUMENT;
+            if ((matched = match_word(source, length, offset, "Piano", 5)) != 0) return matched;
+            *type = TOK_PLAY;
+            return match_word(source, length, offset, "Play", 4);
+        case 'D':
+            *type = TOK_INSTRUMENT;
+            if ((matched = match_word(source, length, offset, "Drum", 4)) != 0) return matched;
+            *type = TOK_INSTRUMENT_SOUND;
+            if ((matched = match_octave(source, length, offset, '2', '4')) != 0) return matched;
+            if ((matched = match_word(source, length, offset, "DM", 2)) != 0) return matched;
+            *type = TOK_MAIN;
+            return match_word(source, length, offset, "Drop the beat", 13);
+        case 'A':
+            *type = TOK_INSTRUMENT_SOUND;
+            if ((matched = match_octave(source, length, offset, '2', '4')) != 0) return matched;
+            return match_word(source, length, offset, "AM1st", 5);
+        case 'B':
+            *type = TOK_INSTRUMENT_SOUND;
+            if ((matched = match_octave(source, length, offset, '2', '4')) != 0) return matched;
+            return match_word(source, length, offset, "Bm1st", 5);
+        case 'G':
+            *type = TOK_INSTRUMENT_SOUND;
+            if ((matched = match_octave(source, length, offset, '2', '4')) != 0) return matched;
+            return match_word(source, length, offset, "GM2nd", 5);
+        case 'C':
+            *type = TOK_INSTRUMENT_SOUND;
+            return match_word(source, length, offset, "Cs4", 3);
+        case 'E':
+            *type = TOK_INSTRUMENT_SOUND;
+            return match_word(source, length, offset, "E4", 2);
+        case 'F':
+            *type = TOK_INSTRUMENT_SOUND;
+            return match_word(source, length, offset, "Fs4", 3);
+        case 'T':
+            *type = TOK_INSTRUMENT;
+            return match_word(source, length, offset, "Triangle", 8);
+        case 'b':
+            *type = TOK_INSTRUMENT_SOUND;
+            return match_word(source, length, offset, "boom", 4);
+        case 't':
+            *type = TOK_INSTRUMENT_SOUND;
+            return match_word(source, length, offset, "tsst", 4);
+        case 'c':
+            *type = TOK_INSTRUMENT_SOUND;
+            if ((matched = match_word(source, length, offset, "clap", 4)) != 0) return matched;
+            return match_word(source, length, offset, "crash", 5);
+        case 'd':
+            *type = TOK_INSTRUMENT_SOUND;
+            if ((matched = match_word(source, length, offset, "dun", 3)) != 0) return matched;
+            if ((matched = match_word(source, length, offset, "ding", 4)) != 0) return matched;
+            if ((matched = match_word(source, length, offset, "diding", 6)) != 0) return matched;
+            return match_word(source, length, offset, "dididing", 8);
+        case 'r':
+            *type = TOK_INSTRUMENT_SOUND;
+            return match_word(source, length, offset, "rest", 4);
+        default:
+            break;
+    }
+
+    /* A digit run, converted like strtol: values past LONG_MAX saturate*/
+    *type = TOK_NUMBER;
+    number = 0;
+    for (end = offset; end < length && source[end] >= '0' && source[end] <= '9'; end++) {
+        digit = source[end] - '0';
+        number = number > (LONG_MAX - digit) / 10 ? LONG_MAX : number * 10 + digit;
+    }
+    *value = number;
+    return end - offset;
+}
+
+int dj_lex_buffer_fast(const char *source, size_t length, TokenArray *tokens, LexIsa isa) {
+    ClassifyBlock classify;
+    Token token;
+    uint32_t starts, newlines, bits;
+    size_t block;
+    size_t next;   /* First byte not consumed by a token*/
+    size_t offset;
+    size_t matched;
+    int line;
+
+    classify = select_classifier(isa);
+    next = 0;
+    line = 1;
+
+    for (block = 0; block < length; block += BLOCK_SIZE) {
+        if (next >= block + BLOCK_SIZE) {
+            continue; /* Inside a long token; tokens never contain newlines*/
+        }
+        if (length - block >= BLOCK_SIZE) {
+            classify(source + block, &starts, &newlines);
+        } else {
+            classify_scalar(source + block, length - block, &starts, &newlines);
+        }
+        bits = starts | newlines;
+        if (next > block) {
+            bits &= (uint32_t)0xFFFFFFFFu << (next - block);
+        }
+
+        while (bits) {
+            offset = block + lowest_bit(bits);
+            bits &= bits - 1;
+            if (source[offset] == '\n') {
+                line++;
+                continue;
+            }
+            matched = match_token(source, length, offset, &token.type, &token.value);
+            if (matched == 0) {
+                continue; /* Skipped like any other character*/
+            }
+
+            token.offset = offset;
+            token.length = matched;
+            token.line = line;
+            if (tokens->count < tokens->capacity) {
+                tokens->tokens[tokens->count++] = token;
+            } else if (token_array_push(tokens, &token) != 0) {
+                return -1;
+            }
+
+            next = offset + matched;
+            if (next - block >= BLOCK_SIZE) {
+                bits = 0;
+            } else {
+                bits &= (uint32_t)0xFFFFFFFFu << (next - block);
+            }
+        }
+    }
+    return 0;
+}
+
+int dj_lex(LexerBackend backend, const char *source, size_t length, TokenArray *tokens) {
+    if (backend == LEXER_FAST) {
+        return dj_lex_buffer_fast(source, length, tokens, LEX_ISA_AUTO);
+    }
+    return dj_lex_buffer(source, length, tokens);
+}
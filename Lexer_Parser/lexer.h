@@ -0,0 +1,90 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stddef.h> /* For size_t*/
+
+/* Token codes produced by the scanner*/
+typedef enum {
+    TOK_EOF = 0,
+    TOK_PATTERN,
+    TOK_COLON,
+    TOK_NUMBER,
+    TOK_INSTRUMENT,
+    TOK_INSTRUMENT_SOUND,
+    TOK_MAIN,
+    TOK_PLAY,
+    TOK_LOOP
+} TokenType;
+
+/* A token and where it came from. The text is source[offset .. offset + length).*/
+typedef struct {
+    TokenType type;
+    size_t offset;
+    size_t length;
+    int line;
+    long value;     /* Numeric value for TOK_NUMBER, 0 otherwise*/
+} Token;
+
+/* Growable array of tokens, filled in source order*/
+typedef struct {
+    Token *tokens;
+    size_t count;
+    size_t capacity;
+} TokenArray;
+
+void token_array_init(TokenArray *array);
+void token_array_free(TokenArray *array);
+
+/* Appends a copy of token. Returns 0 on success, -1 if the array could not grow.*/
+int token_array_push(TokenArray *array, const Token *token);
+
+/* Lexes a .dj source buffer that is already in memory and appends its tokens to tokens.
+ The buffer does not need to be NUL terminated. The scanner is reentrant, so several
+ threads can lex different buffers at the same time.
+ Returns 0 on success, -1 on allocation error or if the buffer is too large.*/
+int dj_lex_buffer(const char *source, size_t length, TokenArray *tokens);
+
+/* Lexer backends. LEXER_FLEX is the scanner generated from lexer.l and is the reference;
+ LEXER_FAST is the hand-written scanner in fastLexer.c, which produces the same tokens.*/
+typedef enum {
+    LEXER_FLEX = 0,
+    LEXER_FAST
+} LexerBackend;
+
+/* Instruction sets of the fast scanner's block classifier. LEX_ISA_AUTO picks the widest one the CPU supports;
+ asking for one the CPU (or compiler) lacks falls back to the next narrower one.*/
+typedef enum {
+    LEX_ISA_AUTO = 0,
+    LEX_ISA_SCALAR,
+    LEX_ISA_SSE2,
+    LEX_ISA_AVX2
+} LexIsa;
+
+/* Hand-written scanner producing exactly the tokens, spans, lines and values of dj_lex_buffer.
+ Whitespace, newlines and ignored characters are found 32 bytes at a time with SIMD compares, so only
+ bytes that can start a token are looked at one by one. Reentrant, and the buffer has no size limit.
+ Returns 0 on success, -1 on allocation error.*/
+int dj_lex_buffer_fast(const char *source, size_t length, TokenArray *tokens, LexIsa isa);
+
+/* The instruction set dj_lex_buffer_fast actually uses when asked for isa*/
+LexIsa lex_isa_resolve(LexIsa isa);
+
+/* "scalar", "sse2", "avx2" ("auto" for LEX_ISA_AUTO)*/
+const char *lex_isa_name(LexIsa isa);
+
+/* Lexes with the chosen backend (the fast one with LEX_ISA_AUTO)*/
+int dj_lex(LexerBackend backend, const char *source, size_t length, TokenArray *tokens);
+
+/* Reads a whole .dj file into a newly allocated buffer (not NUL terminated) for dj_lex_buffer.
+ Caller frees *data. Returns 0 on success, -1 on file or allocation error.*/
+int read_source_file(const char* filename, char** data, size_t* length);
+
+/* Maps a whole .dj file read-only for the scanners (read into memory on Windows), so large files are not copied.
+ An empty file gives length 0. Release with unmap_source_file. Returns 0 on success, -1 on file error.*/
+int map_source_file(const char* filename, const char** data, size_t* length);
+void unmap_source_file(const char* data, size_t length);
+
+/* Name of a token as written to tokens.txt ("PATTERN", "NUMBER", ...)*/
+const char *token_name(int token);
+
+#endif /* LEXER_H*/
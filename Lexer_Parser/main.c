@@ -1,16 +1,125 @@
+#define _POSIX_C_SOURCE 199309L /* For clock_gettime with -ansi*/
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lexer.h"
 
-extern int yylex();
-extern FILE *yyin;
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--fast[=scalar|sse2|avx2]] [--spans] [--stats] input.dj\n", prog);
+    fprintf(stderr, "  --fast    lex the mapped file with the SIMD scanner instead of the flex one\n");
+    fprintf(stderr, "  --spans   print every token as: type offset length line value\n");
+    fprintf(stderr, "  --stats   print the token count and lex throughput instead of the tokens\n");
+}
+
+/* Parses the ISA named after "--fast=". Returns 0 on success.*/
+static int parse_isa(const char *name, LexIsa *isa) {
+    if (strcmp(name, "scalar") == 0) *isa = LEX_ISA_SCALAR;
+    else if (strcmp(name, "sse2") == 0) *isa = LEX_ISA_SSE2;
+    else if (strcmp(name, "avx2") == 0) *isa = LEX_ISA_AVX2;
+    else return -1;
+    return 0;
+}
 
 int main(int argc, char **argv) {
-    if (argc > 1) {
-        yyin = fopen(argv[1], "r");
-        if (!yyin) {
-            perror("fopen");
+    const char *filename;
+    const char *source;
+    char *read_buffer;
+    size_t length;
+    TokenArray tokens;
+    const Token *token;
+    LexerBackend backend;
+    LexIsa isa;
+    int show_spans;
+    int show_stats;
+    int result;
+    double t_start, t_lexed;
+    size_t i;
+
+    filename = NULL;
+    backend = LEXER_FLEX;
+    isa = LEX_ISA_AUTO;
+    show_spans = 0;
+    show_stats = 0;
+    for (i = 1; i < (size_t)argc; i++) {
+        if (strcmp(argv[i], "--fast") == 0) {
+            backend = LEXER_FAST;
+        } else if (strncmp(argv[i], "--fast=", 7) == 0 && parse_isa(argv[i] + 7, &isa) == 0) {
+            backend = LEXER_FAST;
+        } else if (strcmp(argv[i], "--spans") == 0) {
+            show_spans = 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = 1;
+        } else if (argv[i][0] != '-' && !filename) {
+            filename = argv[i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!filename) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* The flex scanner copies its input anyway; the fast one works on the mapped file in place*/
+    read_buffer = NULL;
+    if (backend == LEXER_FAST) {
+        if (map_source_file(filename, &source, &length) != 0) {
+            return 1;
+        }
+    } else {
+        if (read_source_file(filename, &read_buffer, &length) != 0) {
             return 1;
         }
+        source = read_buffer;
+    }
+
+    token_array_init(&tokens);
+    t_start = now_seconds();
+    if (backend == LEXER_FAST) {
+        result = dj_lex_buffer_fast(source, length, &tokens, isa);
+    } else {
+        result = dj_lex_buffer(source, length, &tokens);
+    }
+    t_lexed = now_seconds();
+    if (result != 0) {
+        fprintf(stderr, "Lexing failed.\n");
+        token_array_free(&tokens);
+        if (read_buffer) free(read_buffer); else unmap_source_file(source, length);
+        return 1;
     }
-    yylex();
+
+    if (show_stats) {
+        fprintf(stderr, "lexer: %s, tokens: %lu, lex: %.3f ms (%.3f GB/s)\n",
+                backend == LEXER_FAST ? lex_isa_name(lex_isa_resolve(isa)) : "flex",
+                (unsigned long)tokens.count, (t_lexed - t_start) * 1e3,
+                (double)length / 1e9 / (t_lexed - t_start > 0 ? t_lexed - t_start : 1e-9));
+    } else if (show_spans) {
+        for (i = 0; i < tokens.count; i++) {
+            token = &tokens.tokens[i];
+            printf("%s %lu %lu %d %ld\n", token_name(token->type), (unsigned long)token->offset,
+                   (unsigned long)token->length, token->line, token->value);
+        }
+    } else {
+        /* Print one token per line in the format transform_tokens.py and parser.py expect*/
+        for (i = 0; i < tokens.count; i++) {
+            token = &tokens.tokens[i];
+            if (token->type == TOK_NUMBER || token->type == TOK_INSTRUMENT || token->type == TOK_INSTRUMENT_SOUND) {
+                printf("%s %.*s\n", token_name(token->type), (int)token->length, source + token->offset);
+            } else {
+                printf("%s\n", token_name(token->type));
+            }
+        }
+    }
+
+    token_array_free(&tokens);
+    if (read_buffer) free(read_buffer); else unmap_source_file(source, length);
     return 0;
 }
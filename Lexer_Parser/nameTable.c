@@ -0,0 +1,96 @@
+#include "nameTable.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NAME_TABLE_INITIAL_CAPACITY 64
+
+void name_table_init(NameTable *table) {
+    table->entries = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+void name_table_free(NameTable *table) {
+    free(table->entries);
+    name_table_init(table);
+}
+
+uint32_t name_hash(const char *key, size_t length) {
+    uint32_t hash;
+    size_t i;
+
+    hash = 2166136261u;
+    for (i = 0; i < length; i++) {
+        hash ^= (unsigned char)key[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Linear probing. Returns the slot holding key, or the empty slot where it would go.*/
+static NameTableEntry *probe(NameTableEntry *entries, size_t capacity, const char *key, size_t length, uint32_t hash) {
+    size_t mask;
+    size_t i;
+    NameTableEntry *entry;
+
+    mask = capacity - 1;
+    for (i = hash & mask; ; i = (i + 1) & mask) {
+        entry = &entries[i];
+        if (!entry->key) return entry;
+        if (entry->hash == hash && entry->length == length && memcmp(entry->key, key, length) == 0) return entry;
+    }
+}
+
+static int grow(NameTable *table) {
+    NameTableEntry *entries;
+    NameTableEntry *old;
+    size_t capacity;
+    size_t i;
+
+    capacity = table->capacity ? table->capacity * 2 : NAME_TABLE_INITIAL_CAPACITY;
+    entries = (NameTableEntry *)calloc(capacity, sizeof(NameTableEntry));
+    if (!entries) return -1;
+
+    for (i = 0; i < table->capacity; i++) {
+        old = &table->entries[i];
+        if (old->key) {
+            *probe(entries, capacity, old->key, old->length, old->hash) = *old;
+        }
+    }
+    free(table->entries);
+    table->entries = entries;
+    table->capacity = capacity;
+    return 0;
+}
+
+NameTableEntry *name_table_find(const NameTable *table, const char *key, size_t length) {
+    NameTableEntry *entry;
+
+    if (table->count == 0) return NULL;
+    entry = probe(table->entries, table->capacity, key, length, name_hash(key, length));
+    return entry->key ? entry : NULL;
+}
+
+NameTableEntry *name_table_insert(NameTable *table, const char *key, size_t length, uint32_t value, int *inserted) {
+    NameTableEntry *entry;
+    uint32_t hash;
+
+    /* Keep the load factor at or below 1/2 so probe sequences stay short*/
+    if ((table->count + 1) * 2 > table->capacity && grow(table) != 0) {
+        return NULL;
+    }
+
+    hash = name_hash(key, length);
+    entry = probe(table->entries, table->capacity, key, length, hash);
+    if (entry->key) {
+        *inserted = 0;
+        return entry;
+    }
+    entry->key = key;
+    entry->length = length;
+    entry->hash = hash;
+    entry->value = value;
+    table->count++;
+    *inserted = 1;
+    return entry;
+}
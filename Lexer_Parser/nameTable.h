@@ -0,0 +1,35 @@
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+#include <stddef.h> /* For size_t*/
+#include <stdint.h>
+
+/* Open-addressing hash table keyed by byte strings, with a 32-bit value per key.
+ Keys are not copied: they must outlive the table (e.g. live in an Arena).*/
+typedef struct {
+    const char *key;  /* NULL for an empty slot*/
+    size_t length;
+    uint32_t hash;
+    uint32_t value;
+} NameTableEntry;
+
+typedef struct {
+    NameTableEntry *entries;
+    size_t capacity;  /* Always a power of two*/
+    size_t count;
+} NameTable;
+
+void name_table_init(NameTable *table);
+void name_table_free(NameTable *table);
+
+/* FNV-1a hash of length bytes*/
+uint32_t name_hash(const char *key, size_t length);
+
+/* Returns the entry for key, or NULL if it is not in the table*/
+NameTableEntry *name_table_find(const NameTable *table, const char *key, size_t length);
+
+/* Returns the entry for key, inserting it with value if it is not there yet (*inserted tells which).
+ Returns NULL if the table could not grow.*/
+NameTableEntry *name_table_insert(NameTable *table, const char *key, size_t length, uint32_t value, int *inserted);
+
+#endif /* NAMETABLE_H*/
@@ -0,0 +1,338 @@
+#define _POSIX_C_SOURCE 200112L /* For pthreads with -ansi*/
+#include "parser.h"
+#include "lexer.h"
+#include "ast.h"
+#include "soundTable.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+/* Bounds on the size of a chunk of the parallel parser. Small files are not worth splitting, and capping
+ the size keeps the token arrays of the chunks in flight small and the threads evenly loaded.*/
+#define MIN_PARSE_CHUNK (1024 * 1024)
+#define MAX_PARSE_CHUNK (32 * 1024 * 1024)
+
+/* Scanner used by parse_dj_ast; set once at startup by the driver*/
+static LexerBackend parser_lexer = LEXER_FLEX;
+
+void parser_set_lexer(LexerBackend backend) {
+    parser_lexer = backend;
+}
+
+/* Makes sure the scratch buffer can hold size bytes. Returns 0 on success, -1 if out of memory.*/
+static int reserve_scratch(char** scratch, size_t* scratch_size, size_t size) {
+    char* grown;
+
+    if (size <= *scratch_size) return 0;
+    grown = (char*)realloc(*scratch, size);
+    if (!grown) return -1;
+    *scratch = grown;
+    *scratch_size = size;
+    return 0;
+}
+
+/* Pattern N is named "patternN", matching transform_tokens.py and the transformed_tokens.txt format*/
+static const char* make_pattern_name(Song* song, char** scratch, size_t* scratch_size, const char* number) {
+    size_t length;
+
+    length = strlen("pattern") + strlen(number);
+    if (reserve_scratch(scratch, scratch_size, length + 1) != 0) return NULL;
+    strcpy(*scratch, "pattern");
+    strcat(*scratch, number);
+    return song_intern(song, *scratch, length);
+}
+
+/* Flattens the AST into the song's pattern and play tables, doing what transform_tokens.py does:
+ sounds of all instrument groups in order. Sound names are upper-cased and resolved to SoundIds here.*/
+static int lower_program(const ProgramNode* program, Song* song)
+{
+    const PatternNode* pattern_node;
+    const InstrumentGroupNode* group;
+    const SoundNode* sound;
+    const PlayNode* play;
+    const char* name;
+    char* scratch;
+    size_t scratch_size;
+    size_t length;
+    size_t i;
+    int sound_id;
+    int result;
+
+    scratch = NULL;
+    scratch_size = 0;
+    result = 0;
+
+    for (pattern_node = program->patterns; pattern_node && result == 0; pattern_node = pattern_node->next) {
+        name = make_pattern_name(song, &scratch, &scratch_size, pattern_node->number);
+        if (!name || song_add_pattern(song, name, strlen(name)) != 0) {
+            result = -1;
+            break;
+        }
+        for (group = pattern_node->groups; group && result == 0; group = group->next) {
+            for (sound = group->sounds; sound; sound = sound->next) {
+                length = strlen(sound->name);
+                if (reserve_scratch(&scratch, &scratch_size, length + 1) != 0) {
+                    result = -1;
+                    break;
+                }
+                for (i = 0; i < length; i++) {
+                    scratch[i] = (char)toupper((unsigned char)sound->name[i]);
+                }
+                scratch[length] = '\0';
+                /* The checker only accepts known sounds, so this never falls back to REST*/
+                sound_id = sound_id_from_name(scratch);
+                if (song_add_sound(song, sound_id < 0 ? SOUND_REST : sound_id) != 0) {
+                    result = -1;
+                    break;
+                }
+            }
+        }
+    }
+
+    for (play = program->plays; play && result == 0; play = play->next) {
+        name = make_pattern_name(song, &scratch, &scratch_size, play->pattern_number);
+        if (!name || song_add_play(song, name, strlen(name), (int)play->loop_count) != 0) {
+            result = -1;
+        }
+    }
+
+    free(scratch);
+    return result;
+}
+
+int parse_dj_ast(const char* source, size_t length, Arena* arena, ProgramNode** program) {
+    TokenArray tokens;
+    int result;
+
+    *program = NULL;
+    token_array_init(&tokens);
+    if (dj_lex(parser_lexer, source, length, &tokens) != 0) {
+        token_array_free(&tokens);
+        return -1;
+    }
+    result = ast_parse_program(source, &tokens, arena, program);
+    token_array_free(&tokens);
+    return result;
+}
+
+int parse_dj_buffer(const char* source, size_t length, Song* song)
+{
+    Arena arena;
+    ProgramNode* program;
+    int result;
+
+    arena_init(&arena, 0);
+    result = parse_dj_ast(source, length, &arena, &program);
+    if (result == 0) {
+        result = lower_program(program, song);
+    }
+    if (result == 0) {
+        result = song_bind_plays(song);
+    }
+    arena_release(&arena); /* Frees the whole tree at once*/
+    return result;
+}
+
+int parse_dj_file(const char* filename, Song* song)
+{
+    char* source;
+    size_t length;
+    int result;
+
+    if (read_source_file(filename, &source, &length) != 0) {
+        return -1; /* File error*/
+    }
+    result = parse_dj_buffer(source, length, song);
+    free(source);
+    return result;
+}
+
+/* A piece of the source that starts at a pattern definition, parsed on its own*/
+typedef struct {
+    const char* source;  /* Token offsets and lines are relative to this*/
+    size_t length;
+    Song song;           /* The chunk's patterns (and, in the last chunk, plays) in an arena of its own*/
+    int has_main;
+    int result;
+} ParseChunk;
+
+/* Lexes, parses and lowers one chunk. Diagnostics are not printed: on error the whole file is reparsed
+ sequentially, which reports them with the right line numbers.*/
+static void parse_chunk(ParseChunk* chunk)
+{
+    TokenArray tokens;
+    Arena arena;
+    ProgramNode* program;
+
+    token_array_init(&tokens);
+    arena_init(&arena, 0);
+    chunk->result = dj_lex(parser_lexer, chunk->source, chunk->length, &tokens) == 0 ? 0 : -1;
+    if (chunk->result == 0) {
+        chunk->result = ast_parse_tokens(chunk->source, &tokens, &arena, AST_QUIET | AST_DEFER_PLAY_BINDING, &program);
+    }
+    token_array_free(&tokens);
+    if (chunk->result == 0) {
+        chunk->has_main = program->has_main;
+        chunk->result = lower_program(program, &chunk->song);
+    }
+    arena_release(&arena);
+}
+
+/* Start of the first line after offset that begins with "Pattern", or length if there is none.
+ A token never contains a newline, so lexing from there gives the same tokens as lexing the whole file.*/
+static size_t find_split(const char* source, size_t length, size_t offset)
+{
+    const char* newline;
+
+    while (offset < length) {
+        newline = (const char*)memchr(source + offset, '\n', length - offset);
+        if (!newline) break;
+        offset = (size_t)(newline - source) + 1;
+        if (length - offset >= 7 && memcmp(source + offset, "Pattern", 7) == 0) {
+            return offset;
+        }
+    }
+    return length;
+}
+
+#ifndef _WIN32
+/* Work queue shared by the parser threads: each takes the next unparsed chunk*/
+typedef struct {
+    ParseChunk* chunks;
+    size_t num_chunks;
+    size_t next;
+    pthread_mutex_t lock;
+} ParseQueue;
+
+static void* parse_worker(void* arg)
+{
+    ParseQueue* queue;
+    size_t index;
+
+    queue = (ParseQueue*)arg;
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        index = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+        if (index >= queue->num_chunks) break;
+        parse_chunk(&queue->chunks[index]);
+    }
+    return NULL;
+}
+
+/* Parses every chunk on num_threads threads, the calling one included*/
+static void parse_chunks(ParseChunk* chunks, size_t num_chunks, int num_threads)
+{
+    ParseQueue queue;
+    pthread_t* threads;
+    int started;
+
+    queue.chunks = chunks;
+    queue.num_chunks = num_chunks;
+    queue.next = 0;
+    pthread_mutex_init(&queue.lock, NULL);
+
+    threads = (pthread_t*)malloc((size_t)num_threads * sizeof(pthread_t));
+    started = 0;
+    while (threads && started < num_threads - 1 && pthread_create(&threads[started], NULL, parse_worker, &queue) == 0) {
+        started++;
+    }
+    parse_worker(&queue); /* Runs every chunk itself if no thread could be started*/
+    while (started > 0) {
+        pthread_join(threads[--started], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&queue.lock);
+}
+#else
+/* No pthreads in Windows builds: the chunks are parsed one after the other*/
+static void parse_chunks(ParseChunk* chunks, size_t num_chunks, int num_threads)
+{
+    size_t i;
+
+    (void)num_threads;
+    for (i = 0; i < num_chunks; i++) {
+        parse_chunk(&chunks[i]);
+    }
+}
+#endif
+
+/* Merges the chunk songs into song in file order and binds MAIN. Returns 0 on success, -1 if out of memory,
+ or 1 if the split was not valid or the song has an error, so the file must be reparsed sequentially.*/
+static int merge_chunks(ParseChunk* chunks, size_t num_chunks, Song* song)
+{
+    const NameTableEntry* entry;
+    const PlayCommand* command;
+    size_t i;
+
+    for (i = 0; i < num_chunks; i++) {
+        if (chunks[i].result == -1) return -1;
+        /* MAIN ends the program, so only the last chunk may have it*/
+        if (chunks[i].result != 0 || (chunks[i].has_main && i + 1 < num_chunks)) return 1;
+    }
+    for (i = 0; i < num_chunks; i++) {
+        if (song_append(song, &chunks[i].song) != 0) return -1;
+    }
+
+    /* Every pattern comes before MAIN, so "defined earlier" means defined in any chunk*/
+    for (i = 0; i < song->num_play_commands; i++) {
+        command = &song->play_sequence[i];
+        entry = name_table_find(&song->names, command->pattern_name, strlen(command->pattern_name));
+        if (!entry || entry->value == 0) return 1;
+    }
+    return song_bind_plays(song);
+}
+
+int parse_dj_buffer_parallel(const char* source, size_t length, Song* song, int num_threads)
+{
+    ParseChunk* chunks;
+    size_t num_chunks;
+    size_t chunk_size;
+    size_t start;
+    size_t split;
+    size_t i;
+    int result;
+
+    if (length < 2 * MIN_PARSE_CHUNK) {
+        return parse_dj_buffer(source, length, song);
+    }
+    if (num_threads < 1) {
+        num_threads = 1; /* Still chunked: only the tokens of the chunks in flight are kept*/
+    }
+
+    /* A few chunks per thread, so a thread that finishes early takes more work*/
+    chunk_size = length / ((size_t)num_threads * 4);
+    chunk_size = chunk_size < MIN_PARSE_CHUNK ? MIN_PARSE_CHUNK : chunk_size > MAX_PARSE_CHUNK ? MAX_PARSE_CHUNK : chunk_size;
+    chunks = (ParseChunk*)malloc((length / chunk_size + 1) * sizeof(ParseChunk));
+    if (!chunks) return -1;
+
+    num_chunks = 0;
+    for (start = 0; start < length; start = split) {
+        split = start + chunk_size < length ? find_split(source, length, start + chunk_size) : length;
+        chunks[num_chunks].source = source + start;
+        chunks[num_chunks].length = split - start;
+        song_init(&chunks[num_chunks].song);
+        chunks[num_chunks].has_main = 0;
+        chunks[num_chunks].result = 0;
+        num_chunks++;
+    }
+
+    parse_chunks(chunks, num_chunks, num_threads);
+    result = merge_chunks(chunks, num_chunks, song);
+    for (i = 0; i < num_chunks; i++) {
+        song_release(&chunks[i].song);
+    }
+    free(chunks);
+
+    if (result == 1) {
+        /* Not a valid split, or an error to report: do it the sequential way*/
+        song_release(song);
+        song_init(song);
+        result = parse_dj_buffer(source, length, song);
+    }
+    return result;
+}
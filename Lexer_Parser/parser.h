@@ -0,0 +1,34 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stddef.h> /* For size_t*/
+#include "tokensParser.h" /* For Song*/
+#include "arena.h"
+#include "ast.h"
+
+/* Chooses the scanner the functions below lex with (LEXER_FLEX unless changed). Not synchronised:
+ call it before parsing starts.*/
+void parser_set_lexer(LexerBackend backend);
+
+/* Lexes source and builds its checked AST in arena (see ast_parse_program).
+ Returns 0 on success, -1 on allocation error, -2 on syntax or semantic error.*/
+int parse_dj_ast(const char* source, size_t length, Arena* arena, ProgramNode** program);
+
+/* Lexes and parses a .dj source buffer straight into the pattern and play tables of song (initialised by the caller).
+ Does the job of transform_tokens.py and the checks of parser.py in process, without going through tokens.txt.
+ Returns 0 on success, -1 on allocation error, -2 on syntax or semantic error.*/
+int parse_dj_buffer(const char* source, size_t length, Song* song);
+
+/* Same result as parse_dj_buffer, using up to num_threads threads. The source is split into chunks at lines
+ that start with "Pattern"; the chunks are lexed, parsed and lowered concurrently, each into its own arena,
+ then their pattern tables are merged in file order and the play commands of MAIN are bound.
+ If a split turns out not to fall between pattern definitions, or the program has an error, the file is
+ parsed again with parse_dj_buffer, so results and diagnostics are always those of the sequential parser.
+ Even with one thread, large files are parsed chunk by chunk, which bounds the memory used by tokens.
+ song must be empty. Returns 0 on success, -1 on allocation error, -2 on syntax or semantic error.*/
+int parse_dj_buffer_parallel(const char* source, size_t length, Song* song, int num_threads);
+
+/* Same as parse_dj_buffer for a .dj file on disk. Returns -1 on file error as well.*/
+int parse_dj_file(const char* filename, Song* song);
+
+#endif /* PARSER_H*/
@@ -3,7 +3,9 @@ tokens = ['PATTERN', 'NUMBER', 'COLON', 'INSTRUMENT', 'INSTRUMENT_SOUND', 'MAIN'
 
 VALID_SOUNDS = {
     "Drum": {"boom", "clap", "tsst", "crash", "rest", "dun"},
-    "Triangle": {"ding", "diding", "dididing"}
+    "Triangle": {"ding", "diding", "dididing"},
+    "Piano": {"D2", "G2", "A2", "B2", "D3", "G3", "A3", "B3", "Cs4", "D4", "E4", "Fs4", "G4", "A4", "B4",
+              "DM", "AM1st", "Bm1st", "GM2nd"}
 }
 
 
@@ -0,0 +1,121 @@
+#define _POSIX_C_SOURCE 200112L /* For mmap with -ansi*/
+#include "lexer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+int read_source_file(const char* filename, char** data, size_t* length) {
+    FILE *fp;
+    char *buffer;
+    char *grown;
+    size_t capacity;
+    size_t size;
+    size_t got;
+
+    *data = NULL;
+    *length = 0;
+
+    fp = fopen(filename, "rb");
+    if (!fp) {
+        perror("Error opening .dj file");
+        return -1;
+    }
+
+    capacity = 4096;
+    size = 0;
+    buffer = (char *)malloc(capacity);
+    while (buffer) {
+        got = fread(buffer + size, 1, capacity - size, fp);
+        size += got;
+        if (size < capacity) break;
+        capacity *= 2;
+        grown = (char *)realloc(buffer, capacity);
+        if (!grown) {
+            free(buffer);
+            buffer = NULL;
+        } else {
+            buffer = grown;
+        }
+    }
+    if (!buffer || ferror(fp)) {
+        fprintf(stderr, "Error reading .dj file '%s'.\n", filename);
+        free(buffer);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    *data = buffer;
+    *length = size;
+    return 0;
+}
+
+#ifndef _WIN32
+int map_source_file(const char* filename, const char** data, size_t* length) {
+    int fd;
+    struct stat st;
+    void *image;
+
+    *data = "";
+    *length = 0;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        perror("Error opening .dj file");
+        return -1;
+    }
+    if (fstat(fd, &st) != 0) {
+        perror("Error reading .dj file");
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd); /* mmap rejects empty files; an empty source lexes to no tokens*/
+        return 0;
+    }
+    image = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        perror("Error mapping .dj file");
+        return -1;
+    }
+
+    *data = (const char *)image;
+    *length = (size_t)st.st_size;
+    return 0;
+}
+
+void unmap_source_file(const char* data, size_t length) {
+    if (length > 0) {
+        munmap((void *)data, length);
+    }
+}
+#else
+/* No mmap on Windows builds: read the file into memory instead*/
+int map_source_file(const char* filename, const char** data, size_t* length) {
+    char *buffer;
+
+    *data = "";
+    *length = 0;
+    if (read_source_file(filename, &buffer, length) != 0) {
+        return -1;
+    }
+    if (*length == 0) {
+        free(buffer);
+        return 0;
+    }
+    *data = buffer;
+    return 0;
+}
+
+void unmap_source_file(const char* data, size_t length) {
+    if (length > 0) {
+        free((void *)data);
+    }
+}
+#endif
@@ -0,0 +1,33 @@
+#include "lexer.h"
+#include <stdlib.h>
+
+#define INITIAL_TOKEN_CAPACITY 64
+
+void token_array_init(TokenArray *array) {
+    array->tokens = NULL;
+    array->count = 0;
+    array->capacity = 0;
+}
+
+void token_array_free(TokenArray *array) {
+    free(array->tokens);
+    token_array_init(array);
+}
+
+int token_array_push(TokenArray *array, const Token *token) {
+    Token *grown;
+    size_t new_capacity;
+
+    if (array->count == array->capacity) {
+        /* Double the capacity so pushes stay amortised O(1)*/
+        new_capacity = array->capacity ? array->capacity * 2 : INITIAL_TOKEN_CAPACITY;
+        grown = (Token *)realloc(array->tokens, new_capacity * sizeof(Token));
+        if (!grown) {
+            return -1;
+        }
+        array->tokens = grown;
+        array->capacity = new_capacity;
+    }
+    array->tokens[array->count++] = *token;
+    return 0;
+}
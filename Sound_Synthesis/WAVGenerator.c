@@ -6,6 +6,8 @@
 #include <string.h> 
 #include "soundwaves.h" 
 #include "tokensParser.h"     
+#include "threadPool.h"
+#include "oscillators.h" /* For osc_active_isa*/
 
 
 void initWavHeader(WavHeader *header, int32_t sample_rate, int16_t bits_per_sample, int16_t num_channels) {
@@ -35,55 +37,6 @@ void initWavHeader(WavHeader *header, int32_t sample_rate, int16_t bits_per_samp
     header->dlength = 0;
 }
 
-SoundFunction get_sound_function(const char* sound_name, float* frequency) {
-    SoundFunction result;
-    result.requires_freq = 1; /* Assume frequency is needed by default*/
-
-    if (strcmp(sound_name, "BOOM") == 0) { 
-        *frequency = BOOM_FREQ; 
-        result.func.with_freq = generate_boom;
-    }
-    else if (strcmp(sound_name, "TSST") == 0) { 
-        *frequency = TSST_FREQ; 
-        result.func.with_freq = generate_tsst;
-    }
-    else if (strcmp(sound_name, "CLAP") == 0) { 
-        *frequency = CLAP_FREQ; 
-        result.func.with_freq = generate_clap;
-    }
-    else if (strcmp(sound_name, "DUN") == 0) { 
-        *frequency = BOOM_FREQ; 
-        result.func.with_freq = generate_floortom;
-    }
-    else if (strcmp(sound_name, "DING") == 0) { 
-        *frequency = DING_FREQ; 
-        result.func.with_freq = generate_ding;
-    }
-    else if (strcmp(sound_name, "DIDING") == 0) { 
-        *frequency = DING_FREQ; 
-        result.func.with_freq = generate_diding;
-    }
-    else if (strcmp(sound_name, "DIDIDING") == 0) { 
-        *frequency = DING_FREQ; 
-        result.func.with_freq = generate_dididing;
-    }
-    else if (strcmp(sound_name, "CRASH") == 0) { 
-        result.requires_freq = 0; 
-        result.func.no_freq = generate_crash;
-    }
-    else if (strcmp(sound_name, "REST") == 0) { 
-        result.requires_freq = 0; 
-        result.func.no_freq = generate_rest;
-    }
-    else {
-        fprintf(stderr, "Warning: Unknown sound name '%s'\n", sound_name);
-        result.requires_freq = 0;
-        result.func.no_freq = generate_rest; /* Default to rest if unknown*/
-    }
-
-    return result;
-}
-
 int writeWavFile(const char *filename, WavHeader *header, const short int *buffer, size_t buffer_sample_count) {
     FILE *fp;
     size_t written;
@@ -122,18 +75,207 @@ int writeWavFile(const char *filename, WavHeader *header, const short int *buffe
     return 0; /* Success*/
 }
 
-void mix_in(int16_t *dest, int16_t *src, int start, int length) {
-    int i;
-    int32_t mixed;
-    
-    for (i = 0; i < length; i++) {
-        mixed = dest[start + i] + src[i];
-        if (mixed > 32767) mixed = 32767;
-        if (mixed < -32768) mixed = -32768;
-        dest[start + i] = (int16_t)mixed;
+void mix_in(float *dest, const float *src, size_t start, int length) {
+    MixSource source;
+
+    source.samples = src;
+    source.gain = 1.0f;
+    mix_bus_sum(dest + start, &source, 1, (size_t)length);
+}
+
+int render_song_ir(const SongIR *ir, int16_t **out_buffer, size_t *out_samples) {
+    return render_song_ir_parallel(ir, NULL, 1, out_buffer, out_samples);
+}
+
+int render_song_ir_cached(const SongIR *ir, SampleBank *bank, int16_t **out_buffer, size_t *out_samples) {
+    return render_song_ir_parallel(ir, bank, 1, out_buffer, out_samples);
+}
+
+/* One beat of the flattened song: the hit it plays and its place in the play sequence, which seeds its noise*/
+typedef struct {
+    uint32_t play;
+    uint32_t loop;
+    uint32_t sound_index;   /* Position of the sound in its pattern*/
+    uint32_t sound_id;
+} RenderEvent;
+
+/* Most beats a render can hold: the PCM of the song must fit a size_t of bytes*/
+#define MAX_RENDER_BEATS ((size_t)-1 / (SAMPLES_PER_BEAT * sizeof(int16_t)))
+
+/* Samples of a task's span: its own beats*/
+#define RENDER_SPAN_SAMPLES ((size_t)RENDER_TASK_BEATS * SAMPLES_PER_BEAT)
+
+/* What the tasks of a render share. Each one writes only the PCM of its own beats and the span and counts of its
+ worker; the bank was warmed before they started, so they only read it.*/
+typedef struct {
+    const RenderEvent *events;
+    size_t num_events;
+    const SampleBank *bank;
+    unsigned long song_key;     /* Key of the song's noise*/
+    SampleBankCounts *counts;   /* Per worker*/
+    float *spans;               /* RENDER_SPAN_SAMPLES of float mix bus per worker*/
+    int16_t *pcm;
+    MixOutput output;
+} RenderJob;
+
+/* Thread pool task: renders the beats [index * RENDER_TASK_BEATS, ...) onto the worker's span, each hit synthesized
+ straight onto it (or mixed from the bank) at its offset, and converts them to their range of the PCM in one pass.
+ Every hit ends with its beat, so no other task's hits reach the range and any split gives the same PCM.*/
+static void render_task(void *context, size_t index, int worker) {
+    const RenderJob *job;
+    const RenderEvent *event;
+    const SoundEntry *sound;
+    const float *banked;
+    NoiseEvent noise;
+    float *span;
+    size_t first, last, k;
+    size_t offset;
+
+    job = (const RenderJob *)context;
+    span = job->spans + (size_t)worker * RENDER_SPAN_SAMPLES;
+    first = index * RENDER_TASK_BEATS;
+    last = first + RENDER_TASK_BEATS < job->num_events ? first + RENDER_TASK_BEATS : job->num_events;
+    memset(span, 0, (last - first) * SAMPLES_PER_BEAT * sizeof(float));
+    for (k = first; k < last; k++) {
+        event = &job->events[k];
+        /* IDs were range-checked when the IR was built or mapped*/
+        sound = &SOUND_TABLE[event->sound_id];
+        noise_event_init(&noise, job->song_key, event->play, event->loop, event->sound_index);
+        offset = (k - first) * SAMPLES_PER_BEAT;
+        banked = job->bank ? sample_bank_find(job->bank, (int)event->sound_id, &sound->params, SAMPLES_PER_BEAT,
+                                              &noise, &job->counts[worker])
+                           : NULL;
+        if (banked) {
+            mix_in(span, banked, offset, SAMPLES_PER_BEAT);
+        } else {
+            /* Synthesized straight onto the span*/
+            sound->accumulate(span, offset, SAMPLES_PER_BEAT, 1.0f, &sound->params, &noise);
+        }
     }
+    mix_bus_to_pcm(span, job->pcm + first * SAMPLES_PER_BEAT,
+                   (last - first) * SAMPLES_PER_BEAT, job->output);
 }
 
+int render_song_ir_parallel(const SongIR *ir, SampleBank *bank, int num_threads, int16_t **out_buffer,
+                            size_t *out_samples) {
+    uint32_t i, loop, sound_idx;
+    size_t total_beats;
+    size_t total_samples;
+    size_t num_tasks;
+    size_t beat;
+    RenderEvent *events;
+    RenderJob job;
+    const SongIRPattern* current_pattern;
+    const uint8_t* sound_ids;
+    char used[NUM_SOUND_IDS];
+    int result;
+    int id;
+
+    *out_buffer = NULL;
+    *out_samples = 0;
+
+    /* Calculate total audio length. Pattern references were bound to indices when the IR was built. Loop counts
+     have no cap, so a song longer than a size_t of 16-bit samples is refused before anything is allocated.*/
+    total_beats = 0;
+    for (i = 0; i < ir->header->num_plays; i++) {
+        loop = ir->plays[i].loop_count;
+        sound_idx = ir->patterns[ir->plays[i].pattern_id].num_sounds;
+        if (loop != 0 && sound_idx > (MAX_RENDER_BEATS - total_beats) / loop) {
+            fprintf(stderr, "Song is too long to render in memory.\n");
+            return -1;
+        }
+        total_beats += (size_t)loop * sound_idx;
+    }
+
+    if (total_beats == 0) {
+        return 0;
+    }
+
+    total_samples = total_beats * SAMPLES_PER_BEAT;
+    num_tasks = (total_beats + RENDER_TASK_BEATS - 1) / RENDER_TASK_BEATS;
+    if (num_threads < 1) num_threads = 1;
+    if ((size_t)num_threads > num_tasks) num_threads = (int)num_tasks;
+
+    events = (RenderEvent *)malloc(total_beats * sizeof(RenderEvent));
+    job.spans = (float *)malloc((size_t)num_threads * RENDER_SPAN_SAMPLES * sizeof(float));
+    job.counts = (SampleBankCounts *)calloc((size_t)num_threads, sizeof(SampleBankCounts));
+    job.pcm = (int16_t *)malloc(total_samples * sizeof(int16_t));
+    if (!events || !job.spans || !job.counts || !job.pcm) {
+        fprintf(stderr, "Buffer allocation failed for %lu samples.\n", (unsigned long)total_samples);
+        free(events);
+        free(job.spans);
+        free(job.counts);
+        free(job.pcm);
+        return -1;
+    }
+
+    /* Flatten the play sequence: beat k starts at sample k * SAMPLES_PER_BEAT*/
+    memset(used, 0, sizeof(used));
+    beat = 0;
+    for (i = 0; i < ir->header->num_plays; i++) {
+        current_pattern = &ir->patterns[ir->plays[i].pattern_id];
+        sound_ids = ir->sounds + current_pattern->first_sound;
+
+        for (loop = 0; loop < ir->plays[i].loop_count; loop++) {
+            for (sound_idx = 0; sound_idx < current_pattern->num_sounds; sound_idx++) {
+                events[beat].play = i;
+                events[beat].loop = loop;
+                events[beat].sound_index = sound_idx;
+                events[beat].sound_id = sound_ids[sound_idx];
+                used[sound_ids[sound_idx]] = 1;
+                beat++;
+            }
+        }
+    }
+
+    /* Every hit the song can take from the bank is put there now, so the tasks look it up without a lock*/
+    result = 0;
+    for (id = 0; bank && result == 0 && id < NUM_SOUND_IDS; id++) {
+        if (used[id]) result = sample_bank_warm_sound(bank, id, &SOUND_TABLE[id].params, SAMPLES_PER_BEAT);
+    }
+
+    job.events = events;
+    job.num_events = total_beats;
+    job.bank = bank;
+    job.song_key = noise_song_key(noise_song_seed(), song_ir_hash(ir));
+    job.output = mix_active_output();
+    /* Resolved before the threads start, so they only read it*/
+    osc_active_isa();
+    if (result == 0) {
+        result = thread_pool_run(num_threads, num_tasks, render_task, &job);
+    }
+    for (id = 0; bank && result == 0 && id < num_threads; id++) {
+        sample_bank_add_counts(bank, &job.counts[id]);
+    }
+    free(events);
+    free(job.spans);
+    free(job.counts);
+    if (result != 0) {
+        free(job.pcm);
+        fprintf(stderr, "Out of memory rendering the song.\n");
+        return -1;
+    }
+
+    *out_buffer = job.pcm;
+    *out_samples = total_samples;
+    return 0;
+}
+
+int render_song(const Song *song, int16_t **out_buffer, size_t *out_samples) {
+    SongIR ir;
+    int result;
+
+    *out_buffer = NULL;
+    *out_samples = 0;
+
+    result = song_ir_build(song, &ir);
+    if (result != 0) {
+        return result;
+    }
+    result = render_song_ir(&ir, out_buffer, out_samples);
+    song_ir_release(&ir);
+    return result;
+}
 
 /* TEMPORARY Main Application Logic FOR TESTING */
 #ifdef WAV_GENERATOR_STANDALONE_MAIN
@@ -141,119 +283,42 @@ void mix_in(int16_t *dest, int16_t *src, int start, int length) {
 int main(int argc, char *argv[]) {
     const char* token_filename;
     const char* output_filename;
-    Pattern patterns[MAX_PATTERNS];
-    PlayCommand play_sequence[MAX_PLAY_COMMANDS];
-    int num_patterns;
-    int num_play_commands;
+    Song song;
     int parse_result;
-    int pattern_found;
-    int i, j, loop, sound_idx;
     size_t total_samples;
-    size_t current_sample_index;
     int16_t *buffer;
-    int16_t temp_buffer[SAMPLES_PER_BEAT]; /* Buffer for a single beat*/
-    Pattern* current_pattern;
-    const char* sound_name;
-    float frequency;
-    SoundFunction sound_func;
     WavHeader header;
     int result;
-    size_t total_beats;
 
     printf("DJ Code WAV Generator\n");
 
     token_filename = "../Lexer_Parser/transformed_tokens.txt";
     output_filename = "../NEW_DJcode_Beats.wav";
-    num_patterns = 0;
-    num_play_commands = 0;
+    song_init(&song);
 
     printf("Parsing token file: %s\n", token_filename);
-    parse_result = parse_tokens_file(token_filename, patterns, &num_patterns, play_sequence, &num_play_commands);
+    parse_result = parse_tokens_file(token_filename, &song);
 
     if (parse_result != 0) {
         fprintf(stderr, "Failed to parse token file (Error code: %d).\n", parse_result);
+        song_release(&song);
         return 1;
     }
-    printf("Parsed %d patterns and %d play commands.\n", num_patterns, num_play_commands);
+    printf("Parsed %lu patterns and %lu play commands.\n",
+           (unsigned long)song.num_patterns, (unsigned long)song.num_play_commands);
 
-    /* Calculate total audio length*/
-    total_beats = 0;
-    for (i = 0; i < num_play_commands; i++) {
-        pattern_found = 0;
-        for (j = 0; j < num_patterns; j++) {
-            if (strcmp(play_sequence[i].pattern_name, patterns[j].name) == 0) {
-                total_beats += play_sequence[i].loop_count * patterns[j].num_sounds;
-                pattern_found = 1;
-                break;
-            }
-        }
-        if (!pattern_found) {
-            fprintf(stderr, "Error: Pattern '%s' specified in PLAY command not found.\n", play_sequence[i].pattern_name);
-            return 1;
-        }
+    /* Generate Audio*/
+    printf("Generating audio...\n");
+    result = render_song(&song, &buffer, &total_samples);
+    song_release(&song);
+    if (result != 0) {
+        return 1;
     }
-
-    if (total_beats == 0) {
+    if (total_samples == 0) {
         printf("No beats to generate. Exiting.\n");
         return 0;
     }
-
-    total_samples = total_beats * SAMPLES_PER_BEAT;
-    printf("Total beats: %lu, Total samples: %lu\n", (unsigned long) total_beats, (unsigned long) total_samples);
-
-    /* Allocate buffer*/
-    buffer = (int16_t *)calloc(total_samples, sizeof(int16_t));
-    if (!buffer) {
-        fprintf(stderr, "Buffer allocation failed for %lu samples.\n", (unsigned long)total_samples);
-        return 1;
-    }
-    printf("Allocated buffer for %lu samples.\n", (unsigned long) total_samples);
-
-    /* Generate Audio*/
-    printf("Generating audio...\n");
-    current_sample_index = 0;
-
-    for (i = 0; i < num_play_commands; i++) {
-        current_pattern = NULL;
-        for (j = 0; j < num_patterns; j++) {
-            if (strcmp(play_sequence[i].pattern_name, patterns[j].name) == 0) {
-                current_pattern = &patterns[j];
-                break;
-            }
-        }
-        if (!current_pattern) continue;
-
-        printf("Playing pattern '%s' %d times...\n", current_pattern->name, play_sequence[i].loop_count);
-
-        for (loop = 0; loop < play_sequence[i].loop_count; loop++) {
-            for (sound_idx = 0; sound_idx < current_pattern->num_sounds; sound_idx++) {
-                sound_name = current_pattern->sounds[sound_idx];
-                frequency = 0;
-                sound_func = get_sound_function(sound_name, &frequency);
-
-                memset(temp_buffer, 0, sizeof(temp_buffer)); /* Clear temp buffer*/
-
-                if (sound_func.requires_freq) {
-                    sound_func.func.with_freq(temp_buffer, SAMPLES_PER_BEAT, frequency);
-                } else {
-                    sound_func.func.no_freq(temp_buffer, SAMPLES_PER_BEAT);
-                }
-
-                /* Mix into the main buffer if within bounds*/
-                if (current_sample_index < total_samples) {
-                    mix_in(buffer, temp_buffer, current_sample_index, SAMPLES_PER_BEAT);
-                } else {
-                    fprintf(stderr, "Warning: Exceeded calculated buffer size during generation.\n");
-                    goto generation_end;
-                }
-
-                current_sample_index += SAMPLES_PER_BEAT;
-            }
-        }
-    }
-
-generation_end:
-    printf("Audio generation complete.\n");
+    printf("Audio generation complete (%lu samples).\n", (unsigned long) total_samples);
 
     /* Write WAV file*/
     initWavHeader(&header, SAMPLE_RATE, BIT_DEPTH, DEFAULT_NUM_CHANNELS);
@@ -3,6 +3,12 @@
 
 #include <stdint.h>
 #include <stdio.h> /* For FILE*/
+#include <stddef.h> /* For size_t*/
+#include "tokensParser.h" /* For Song*/
+#include "songIR.h" /* For SongIR*/
+#include "soundTable.h" /* For SoundId and SOUND_TABLE*/
+#include "sampleBank.h" /* For SampleBank*/
+#include "mixBus.h" /* For the conversion of the mix bus to PCM*/
 
 #define DEFAULT_SAMPLE_RATE 16000
 #define DEFAULT_BITS_PER_SAMPLE 16
@@ -34,22 +40,6 @@ typedef struct {
     WavHeader header;
 } WavData;*/
 
-/* Define types for the sound generation functions */
-typedef void (*SoundFunc)(int16_t*, int, float);
-typedef void (*SoundFuncNoFreq)(int16_t*, int);
-
-/* Union to safely handle both types of sound functions */
-typedef union {
-    SoundFunc with_freq;
-    SoundFuncNoFreq no_freq;
-} SoundFuncUnion;
-
-/* Structure to hold sound function and its properties */
-typedef struct {
-    SoundFuncUnion func;
-    int requires_freq;
-} SoundFunction;
-
 /*Initializes a WavHeader struct with default values.*/
 void initWavHeader(WavHeader *header, int32_t sample_rate, int16_t bits_per_sample, int16_t num_channels);
 
@@ -57,11 +47,35 @@ void initWavHeader(WavHeader *header, int32_t sample_rate, int16_t bits_per_samp
  return 0 on success, -1 on file open error, -2 on write error.*/
 int writeWavFile(const char *filename, WavHeader *header, const short int *buffer, size_t buffer_sample_count);
 
-/* Function to get the appropriate sound generation function based on name.
- Returns a SoundFunction structure containing the function pointer and its properties. */
-SoundFunction get_sound_function(const char* sound_name, float* frequency);
+/* Adds length samples of src to the mix bus dest from sample start on. The bus is float, so nothing clips here;
+ see mixBus.h. To add several sources at once, mix_bus_sum does it in one pass.*/
+void mix_in(float *dest, const float *src, size_t start, int length);
+
+/* Beats rendered by one task of render_song_ir_parallel: the unit of work the threads share and steal*/
+#define RENDER_TASK_BEATS 16
+
+/* Renders a song held in binary IR form (built in memory or mmap'ed from disk) into a newly allocated 16-bit PCM
+ buffer, converted with mix_active_output(). Every hit is synthesized straight onto a float mix bus by its
+ accumulating kernel, in blocks of voice_block_frames() samples (see voice.h), and the bus is converted to PCM
+ a task's range at a time. The caller frees *out_buffer.
+ A song with no beats gives *out_buffer == NULL and *out_samples == 0.
+ return 0 on success, -1 on allocation error.*/
+int render_song_ir(const SongIR *ir, int16_t **out_buffer, size_t *out_samples);
+
+/* Same as render_song_ir, but every hit the bank (if not NULL) can hold is mixed from it; the song's sounds are
+ warmed into it before the render starts (see sampleBank.h). The output is identical unless the bank has
+ variation slots for noisy sounds.*/
+int render_song_ir_cached(const SongIR *ir, SampleBank *bank, int16_t **out_buffer, size_t *out_samples);
+
+/* Same as render_song_ir_cached, on num_threads threads (the calling one included). The flattened beats are split
+ into tasks of RENDER_TASK_BEATS run on the work-stealing pool of threadPool.h. A hit lasts exactly its beat, so each
+ task accumulates its own hits into a float span of its own and converts it to its part of the PCM: the tasks take
+ no lock and the output is bit-identical for any number of threads.*/
+int render_song_ir_parallel(const SongIR *ir, SampleBank *bank, int num_threads, int16_t **out_buffer,
+                            size_t *out_samples);
 
-/* Allows for mixing capabilities, like parallelizing sounds using a buffer*/
-void mix_in(int16_t *dest, int16_t *src, int start, int length) ;
+/* Convenience wrapper: builds the IR for a parsed song (patterns + play sequence) and renders it.
+ return 0 on success, -1 on allocation error, -2 if a PLAY command names an undefined pattern.*/
+int render_song(const Song *song, int16_t **out_buffer, size_t *out_samples);
 
 #endif /* WAVGENERATOR_H*/
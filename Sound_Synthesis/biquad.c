@@ -0,0 +1,382 @@
+#include "biquad.h"
+#include "oscillators.h" /* For osc_active_isa*/
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BIQUAD_X86 1
+#include <immintrin.h>
+#endif
+
+#define PI 3.14159265358979323846
+
+/* Frames biquad_lanes_sum filters at a time (the interleaved copy of them lives on the stack)*/
+#define SUM_CHUNK 64
+
+/* Q30 of a coefficient, clamped to the int32 range (a1 comes close to -2 for low frequencies)*/
+static int32_t to_q30(float coefficient) {
+    double value;
+
+    value = floor((double)coefficient * 1073741824.0 + 0.5);
+    if (value > 2147483647.0) value = 2147483647.0;
+    if (value < -2147483648.0) value = -2147483648.0;
+    return (int32_t)value;
+}
+
+void biquad_design(BiquadCoeffs *coeffs, BiquadType type, float frequency, float q, float gain, float sample_rate) {
+    double w0, cosine, alpha, a0;
+    double b0, b1, b2;
+
+    if (frequency > 0.49f * sample_rate) frequency = 0.49f * sample_rate;
+    w0 = 2.0 * PI * frequency / sample_rate;
+    cosine = cos(w0);
+    alpha = sin(w0) / (2.0 * q);
+    switch (type) {
+        case BIQUAD_LOWPASS:
+            b0 = (1.0 - cosine) / 2.0;
+            b1 = 1.0 - cosine;
+            b2 = b0;
+            break;
+        case BIQUAD_HIGHPASS:
+            b0 = (1.0 + cosine) / 2.0;
+            b1 = -(1.0 + cosine);
+            b2 = b0;
+            break;
+        case BIQUAD_BANDPASS:
+            b0 = alpha;
+            b1 = 0.0;
+            b2 = -alpha;
+            break;
+        default: /* BIQUAD_NOTCH*/
+            b0 = 1.0;
+            b1 = -2.0 * cosine;
+            b2 = 1.0;
+            break;
+    }
+    a0 = 1.0 + alpha;
+    coeffs->b0 = (float)(gain * b0 / a0);
+    coeffs->b1 = (float)(gain * b1 / a0);
+    coeffs->b2 = (float)(gain * b2 / a0);
+    coeffs->a1 = (float)(-2.0 * cosine / a0);
+    coeffs->a2 = (float)((1.0 - alpha) / a0);
+}
+
+int biquad_butterworth(BiquadCoeffs *stages, BiquadType type, float frequency, int order, float sample_rate) {
+    int num_stages;
+    int k;
+
+    num_stages = order / 2;
+    if (num_stages < 1) num_stages = 1;
+    if (num_stages > BIQUAD_MAX_STAGES) num_stages = BIQUAD_MAX_STAGES;
+    /* The poles of a Butterworth filter of order 2n pair up into n biquads of Q = 1 / (2 cos((2k + 1) pi / 4n))*/
+    for (k = 0; k < num_stages; k++) {
+        biquad_design(&stages[k], type, frequency,
+                      (float)(1.0 / (2.0 * cos((2 * k + 1) * PI / (4.0 * num_stages)))), 1.0f, sample_rate);
+    }
+    return num_stages;
+}
+
+void biquad_cascade_init(BiquadCascade *cascade, const BiquadCoeffs *stages, int num_stages) {
+    int s;
+
+    if (num_stages > BIQUAD_MAX_STAGES) num_stages = BIQUAD_MAX_STAGES;
+    cascade->num_stages = num_stages;
+    for (s = 0; s < num_stages; s++) {
+        cascade->stages[s] = stages[s];
+        cascade->z1[s] = 0.0f;
+        cascade->z2[s] = 0.0f;
+    }
+}
+
+void biquad_cascade_process(BiquadCascade *cascade, float *samples, int count) {
+    const BiquadCoeffs *c;
+    const BiquadCoeffs *d;
+    float x, y, z1, z2;
+    float w1, w2;
+    int s;
+    int i;
+
+    /* Two stages at a time over the whole block, their state in registers. Each stage is a chain of dependent
+     multiply-adds, but the second stage's chain for one sample runs alongside the first stage's for the next.*/
+    for (s = 0; s + 1 < cascade->num_stages; s += 2) {
+        c = &cascade->stages[s];
+        d = &cascade->stages[s + 1];
+        z1 = cascade->z1[s];
+        z2 = cascade->z2[s];
+        w1 = cascade->z1[s + 1];
+        w2 = cascade->z2[s + 1];
+        for (i = 0; i < count; i++) {
+            x = samples[i];
+            y = c->b0 * x + z1;
+            z1 = c->b1 * x - c->a1 * y + z2;
+            z2 = c->b2 * x - c->a2 * y;
+            x = y;
+            y = d->b0 * x + w1;
+            w1 = d->b1 * x - d->a1 * y + w2;
+            w2 = d->b2 * x - d->a2 * y;
+            samples[i] = y;
+        }
+        cascade->z1[s] = z1;
+        cascade->z2[s] = z2;
+        cascade->z1[s + 1] = w1;
+        cascade->z2[s + 1] = w2;
+    }
+    if (s < cascade->num_stages) {
+        c = &cascade->stages[s];
+        z1 = cascade->z1[s];
+        z2 = cascade->z2[s];
+        for (i = 0; i < count; i++) {
+            x = samples[i];
+            y = c->b0 * x + z1;
+            z1 = c->b1 * x - c->a1 * y + z2;
+            z2 = c->b2 * x - c->a2 * y;
+            samples[i] = y;
+        }
+        cascade->z1[s] = z1;
+        cascade->z2[s] = z2;
+    }
+}
+
+void biquad_lanes_init(BiquadLanes *lanes, const BiquadCoeffs *coeffs, int num_lanes) {
+    int k;
+
+    if (num_lanes > BIQUAD_MAX_LANES) num_lanes = BIQUAD_MAX_LANES;
+    lanes->num_lanes = num_lanes;
+    for (k = 0; k < BIQUAD_MAX_LANES; k++) {
+        lanes->b0[k] = k < num_lanes ? coeffs[k].b0 : 0.0f;
+        lanes->b1[k] = k < num_lanes ? coeffs[k].b1 : 0.0f;
+        lanes->b2[k] = k < num_lanes ? coeffs[k].b2 : 0.0f;
+        lanes->a1[k] = k < num_lanes ? coeffs[k].a1 : 0.0f;
+        lanes->a2[k] = k < num_lanes ? coeffs[k].a2 : 0.0f;
+        lanes->z1[k] = 0.0f;
+        lanes->z2[k] = 0.0f;
+    }
+}
+
+/* Lanes first .. first + width - 1, one at a time: the reference the vector versions match*/
+static void lanes_scalar(BiquadLanes *lanes, int first, int width, float *frames, int count) {
+    float x, y, z1, z2;
+    float *p;
+    int stride;
+    int i;
+    int k;
+
+    stride = lanes->num_lanes;
+    for (k = first; k < first + width; k++) {
+        z1 = lanes->z1[k];
+        z2 = lanes->z2[k];
+        for (i = 0, p = frames + k; i < count; i++, p += stride) {
+            x = *p;
+            y = lanes->b0[k] * x + z1;
+            z1 = lanes->b1[k] * x - lanes->a1[k] * y + z2;
+            z2 = lanes->b2[k] * x - lanes->a2[k] * y;
+            *p = y;
+        }
+        lanes->z1[k] = z1;
+        lanes->z2[k] = z2;
+    }
+}
+
+#ifdef BIQUAD_X86
+/* Lanes first .. first + 3*/
+__attribute__((target("sse2")))
+static void lanes_sse2(BiquadLanes *lanes, int first, float *frames, int count) {
+    __m128 b0, b1, b2, a1, a2, z1, z2, x, y;
+    float *p;
+    int stride;
+    int i;
+
+    stride = lanes->num_lanes;
+    b0 = _mm_loadu_ps(lanes->b0 + first);
+    b1 = _mm_loadu_ps(lanes->b1 + first);
+    b2 = _mm_loadu_ps(lanes->b2 + first);
+    a1 = _mm_loadu_ps(lanes->a1 + first);
+    a2 = _mm_loadu_ps(lanes->a2 + first);
+    z1 = _mm_loadu_ps(lanes->z1 + first);
+    z2 = _mm_loadu_ps(lanes->z2 + first);
+    for (i = 0, p = frames + first; i < count; i++, p += stride) {
+        x = _mm_loadu_ps(p);
+        y = _mm_add_ps(_mm_mul_ps(b0, x), z1);
+        z1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), z2);
+        z2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+        _mm_storeu_ps(p, y);
+    }
+    _mm_storeu_ps(lanes->z1 + first, z1);
+    _mm_storeu_ps(lanes->z2 + first, z2);
+}
+
+/* Lanes first .. first + 7*/
+__attribute__((target("avx2")))
+static void lanes_avx2(BiquadLanes *lanes, int first, float *frames, int count) {
+    __m256 b0, b1, b2, a1, a2, z1, z2, x, y;
+    float *p;
+    int stride;
+    int i;
+
+    stride = lanes->num_lanes;
+    b0 = _mm256_loadu_ps(lanes->b0 + first);
+    b1 = _mm256_loadu_ps(lanes->b1 + first);
+    b2 = _mm256_loadu_ps(lanes->b2 + first);
+    a1 = _mm256_loadu_ps(lanes->a1 + first);
+    a2 = _mm256_loadu_ps(lanes->a2 + first);
+    z1 = _mm256_loadu_ps(lanes->z1 + first);
+    z2 = _mm256_loadu_ps(lanes->z2 + first);
+    for (i = 0, p = frames + first; i < count; i++, p += stride) {
+        x = _mm256_loadu_ps(p);
+        y = _mm256_add_ps(_mm256_mul_ps(b0, x), z1);
+        z1 = _mm256_add_ps(_mm256_sub_ps(_mm256_mul_ps(b1, x), _mm256_mul_ps(a1, y)), z2);
+        z2 = _mm256_sub_ps(_mm256_mul_ps(b2, x), _mm256_mul_ps(a2, y));
+        _mm256_storeu_ps(p, y);
+    }
+    _mm256_storeu_ps(lanes->z1 + first, z1);
+    _mm256_storeu_ps(lanes->z2 + first, z2);
+}
+
+/* Lanes first .. first + 15*/
+__attribute__((target("avx512f")))
+static void lanes_avx512(BiquadLanes *lanes, int first, float *frames, int count) {
+    __m512 b0, b1, b2, a1, a2, z1, z2, x, y;
+    float *p;
+    int stride;
+    int i;
+
+    stride = lanes->num_lanes;
+    b0 = _mm512_loadu_ps(lanes->b0 + first);
+    b1 = _mm512_loadu_ps(lanes->b1 + first);
+    b2 = _mm512_loadu_ps(lanes->b2 + first);
+    a1 = _mm512_loadu_ps(lanes->a1 + first);
+    a2 = _mm512_loadu_ps(lanes->a2 + first);
+    z1 = _mm512_loadu_ps(lanes->z1 + first);
+    z2 = _mm512_loadu_ps(lanes->z2 + first);
+    for (i = 0, p = frames + first; i < count; i++, p += stride) {
+        x = _mm512_loadu_ps(p);
+        y = _mm512_add_ps(_mm512_mul_ps(b0, x), z1);
+        z1 = _mm512_add_ps(_mm512_sub_ps(_mm512_mul_ps(b1, x), _mm512_mul_ps(a1, y)), z2);
+        z2 = _mm512_sub_ps(_mm512_mul_ps(b2, x), _mm512_mul_ps(a2, y));
+        _mm512_storeu_ps(p, y);
+    }
+    _mm512_storeu_ps(lanes->z1 + first, z1);
+    _mm512_storeu_ps(lanes->z2 + first, z2);
+}
+#endif
+
+void biquad_lanes_process(BiquadLanes *lanes, float *frames, int count) {
+    OscIsa isa;
+    int first;
+    int rest;
+
+    isa = osc_active_isa();
+    /* The widest vectors first, then narrower ones for what is left, then one lane at a time*/
+    for (first = 0; first < lanes->num_lanes; ) {
+        rest = lanes->num_lanes - first;
+#ifdef BIQUAD_X86
+        if (isa == OSC_ISA_AVX512 && rest >= 16) {
+            lanes_avx512(lanes, first, frames, count);
+            first += 16;
+            continue;
+        }
+        if ((isa == OSC_ISA_AVX512 || isa == OSC_ISA_AVX2) && rest >= 8) {
+            lanes_avx2(lanes, first, frames, count);
+            first += 8;
+            continue;
+        }
+        if (isa != OSC_ISA_SCALAR && rest >= 4) {
+            lanes_sse2(lanes, first, frames, count);
+            first += 4;
+            continue;
+        }
+#endif
+        lanes_scalar(lanes, first, rest, frames, count);
+        break;
+    }
+    (void)isa;
+}
+
+void biquad_lanes_sum(BiquadLanes *lanes, const float *in, float *out, int count) {
+    float frames[SUM_CHUNK * BIQUAD_MAX_LANES];
+    float sum;
+    int stride;
+    int first;
+    int n;
+    int i;
+    int k;
+
+    stride = lanes->num_lanes;
+    for (first = 0; first < count; first += n) {
+        n = count - first < SUM_CHUNK ? count - first : SUM_CHUNK;
+        for (i = 0; i < n; i++) {
+            for (k = 0; k < stride; k++) {
+                frames[i * stride + k] = in[first + i];
+            }
+        }
+        biquad_lanes_process(lanes, frames, n);
+        for (i = 0; i < n; i++) {
+            sum = 0.0f;
+            for (k = 0; k < stride; k++) {
+                sum += frames[i * stride + k];
+            }
+            out[first + i] = sum;
+        }
+    }
+}
+
+void biquad_fixed_init(BiquadFixed *filters, const BiquadCoeffs *coeffs, int num_filters) {
+    int k;
+
+    for (k = 0; k < num_filters; k++) {
+        filters[k].b0 = to_q30(coeffs[k].b0);
+        filters[k].b1 = to_q30(coeffs[k].b1);
+        filters[k].b2 = to_q30(coeffs[k].b2);
+        filters[k].a1 = to_q30(coeffs[k].a1);
+        filters[k].a2 = to_q30(coeffs[k].a2);
+        filters[k].z1 = 0;
+        filters[k].z2 = 0;
+    }
+}
+
+/* One sample through filter: x and the result in Q22*/
+static int64_t fixed_step(BiquadFixed *filter, int64_t x) {
+    int64_t y;
+
+    y = (filter->b0 * x + filter->z1) >> 30;
+    filter->z1 = filter->b1 * x - filter->a1 * y + filter->z2;
+    filter->z2 = filter->b2 * x - filter->a2 * y;
+    return y;
+}
+
+/* Q22 to Q(BIQUAD_FIXED_OUT_BITS), rounded and saturated*/
+static int16_t fixed_out(int64_t y) {
+    y = (y + ((int64_t)1 << (21 - BIQUAD_FIXED_OUT_BITS))) >> (22 - BIQUAD_FIXED_OUT_BITS);
+    if (y > 32767) return 32767;
+    if (y < -32768) return -32768;
+    return (int16_t)y;
+}
+
+void biquad_fixed_cascade(BiquadFixed *stages, int num_stages, const int16_t *in, int16_t *out, int count) {
+    int64_t x;
+    int i;
+    int s;
+
+    for (i = 0; i < count; i++) {
+        x = (int64_t)in[i] * 128; /* Q15 to Q22*/
+        for (s = 0; s < num_stages; s++) {
+            x = fixed_step(&stages[s], x);
+        }
+        out[i] = fixed_out(x);
+    }
+}
+
+void biquad_fixed_sum(BiquadFixed *lanes, int num_lanes, const int16_t *in, int16_t *out, int count) {
+    int64_t x;
+    int64_t sum;
+    int i;
+    int k;
+
+    for (i = 0; i < count; i++) {
+        x = (int64_t)in[i] * 128;
+        sum = 0;
+        for (k = 0; k < num_lanes; k++) {
+            sum += fixed_step(&lanes[k], x);
+        }
+        out[i] = fixed_out(sum);
+    }
+}
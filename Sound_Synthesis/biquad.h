@@ -0,0 +1,96 @@
+#ifndef BIQUAD_H
+#define BIQUAD_H
+
+#include <stdint.h>
+
+/* Biquad filters, in transposed direct form II: per sample
+   y = b0 x + z1,   z1 = b1 x - a1 y + z2,   z2 = b2 x - a2 y
+ which keeps two state values per filter and rounds well in float. Coefficients come from the designs of R. Bristow-
+ Johnson's "Audio EQ Cookbook" (computed in double, normalized so a0 = 1).
+
+ A cascade runs filters in series on one signal (a steeper slope than one biquad gives); that is a chain of
+ dependent multiply-adds, so it is scalar. Lanes run up to BIQUAD_MAX_LANES independent filters side by side, one
+ per lane of an interleaved signal, and use the SIMD set osc_active_isa() names: 4 lanes per SSE2 vector, 8 per
+ AVX2 and 16 per AVX-512. Every set does the same float operations in the same order (no fused multiply-add), so
+ lanes give bit-identical output whatever the set, and the same as a cascade of one filter on that lane.
+
+ The fixed-point functions run the same filters in integers for the fixed engine (fixedPoint.h): Q2.30
+ coefficients, Q15 input, and a state with 22 fractional bits.*/
+
+#define BIQUAD_MAX_STAGES 4
+#define BIQUAD_MAX_LANES 16
+
+/* Fractional bits of the output of the fixed-point filters (Q14: filtered noise can go past full scale, up to 2)*/
+#define BIQUAD_FIXED_OUT_BITS 14
+
+typedef enum {
+    BIQUAD_LOWPASS = 0,
+    BIQUAD_HIGHPASS,
+    BIQUAD_BANDPASS,      /* Constant 0 dB peak gain at the center frequency*/
+    BIQUAD_NOTCH
+} BiquadType;
+
+typedef struct {
+    float b0, b1, b2;
+    float a1, a2;
+} BiquadCoeffs;
+
+typedef struct {
+    BiquadCoeffs stages[BIQUAD_MAX_STAGES];
+    float z1[BIQUAD_MAX_STAGES];
+    float z2[BIQUAD_MAX_STAGES];
+    int num_stages;
+} BiquadCascade;
+
+/* One filter per lane, as arrays so a vector of lanes loads from each*/
+typedef struct {
+    float b0[BIQUAD_MAX_LANES];
+    float b1[BIQUAD_MAX_LANES];
+    float b2[BIQUAD_MAX_LANES];
+    float a1[BIQUAD_MAX_LANES];
+    float a2[BIQUAD_MAX_LANES];
+    float z1[BIQUAD_MAX_LANES];
+    float z2[BIQUAD_MAX_LANES];
+    int num_lanes;
+} BiquadLanes;
+
+typedef struct {
+    int32_t b0, b1, b2;   /* Q2.30*/
+    int32_t a1, a2;
+    int64_t z1, z2;       /* Q52: a Q30 coefficient times a Q22 sample*/
+} BiquadFixed;
+
+/* Designs a filter of type at frequency (clamped below Nyquist) with quality q, its output scaled by gain*/
+void biquad_design(BiquadCoeffs *coeffs, BiquadType type, float frequency, float q, float gain, float sample_rate);
+
+/* Designs a Butterworth low-pass or high-pass of order (even, at most 2 * BIQUAD_MAX_STAGES) as order / 2 stages
+ in stages[]. Returns the number of stages.*/
+int biquad_butterworth(BiquadCoeffs *stages, BiquadType type, float frequency, int order, float sample_rate);
+
+/* Starts a cascade of num_stages (at most BIQUAD_MAX_STAGES) filters at rest*/
+void biquad_cascade_init(BiquadCascade *cascade, const BiquadCoeffs *stages, int num_stages);
+
+/* Filters count samples in place through every stage, carrying the state over to the next call*/
+void biquad_cascade_process(BiquadCascade *cascade, float *samples, int count);
+
+/* Starts num_lanes (at most BIQUAD_MAX_LANES) filters at rest, lane k filtered by coeffs[k]*/
+void biquad_lanes_init(BiquadLanes *lanes, const BiquadCoeffs *coeffs, int num_lanes);
+
+/* Filters count frames in place, lane k of frame i being frames[i * num_lanes + k]*/
+void biquad_lanes_process(BiquadLanes *lanes, float *frames, int count);
+
+/* A filter bank: every lane filters in[0 .. count), and out[i] is the sum of the lanes (in lane order).
+ out may be in.*/
+void biquad_lanes_sum(BiquadLanes *lanes, const float *in, float *out, int count);
+
+/* Converts num_filters filters to fixed point, at rest*/
+void biquad_fixed_init(BiquadFixed *filters, const BiquadCoeffs *coeffs, int num_filters);
+
+/* Filters count Q15 samples of in through num_stages filters in series, writing out in Q(BIQUAD_FIXED_OUT_BITS),
+ saturated. out may be in.*/
+void biquad_fixed_cascade(BiquadFixed *stages, int num_stages, const int16_t *in, int16_t *out, int count);
+
+/* The fixed-point biquad_lanes_sum: the sum of num_lanes filters of in, in Q(BIQUAD_FIXED_OUT_BITS), saturated*/
+void biquad_fixed_sum(BiquadFixed *lanes, int num_lanes, const int16_t *in, int16_t *out, int count);
+
+#endif /* BIQUAD_H*/
@@ -0,0 +1,223 @@
+#define _POSIX_C_SOURCE 200112L /* For mkdir and getpid with -ansi*/
+#include "compileCache.h"
+#include "soundTable.h" /* For the sound names in the key*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#else
+#include <direct.h>
+#endif
+
+/* Two independent MurmurHash3 (x86, 32-bit) lanes over the same bytes make a 64-bit key.
+ Four bytes per step keeps hashing far cheaper than lexing, even for sources of hundreds of MB.*/
+typedef struct {
+    uint32_t h1;
+    uint32_t h2;
+    uint32_t length;
+} KeyHash;
+
+static uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static uint32_t mix_block(uint32_t h, uint32_t k) {
+    k *= 0xcc9e2d51u;
+    k = rotl32(k, 15);
+    k *= 0x1b873593u;
+    h ^= k;
+    h = rotl32(h, 13);
+    return h * 5 + 0xe6546b64u;
+}
+
+static uint32_t final_mix(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    return h ^ (h >> 16);
+}
+
+static void hash_bytes(KeyHash *hash, const char *data, size_t length) {
+    const unsigned char *bytes;
+    uint32_t k;
+    size_t i;
+
+    bytes = (const unsigned char *)data;
+    for (i = 0; i + 4 <= length; i += 4) {
+        k = (uint32_t)bytes[i] | (uint32_t)bytes[i + 1] << 8 | (uint32_t)bytes[i + 2] << 16 | (uint32_t)bytes[i + 3] << 24;
+        hash->h1 = mix_block(hash->h1, k);
+        hash->h2 = mix_block(hash->h2, k ^ 0x9e3779b9u);
+    }
+    /* The tail, padded with zeros; the length mixed in at the end tells paddings apart*/
+    if (i < length) {
+        k = 0;
+        for (; i < length; i++) {
+            k |= (uint32_t)bytes[i] << (8 * (i % 4));
+        }
+        hash->h1 = mix_block(hash->h1, k);
+        hash->h2 = mix_block(hash->h2, k ^ 0x9e3779b9u);
+    }
+    hash->length += (uint32_t)length;
+}
+
+void compile_cache_key(const char *source, size_t length, char key[COMPILE_CACHE_KEY_SIZE]) {
+    KeyHash hash;
+    char version[32];
+    int id;
+
+    hash.h1 = 0x2f1d9a3bu;
+    hash.h2 = 0x7c4e15d1u;
+    hash.length = 0;
+
+    /* The IR stores sound IDs, so what it means depends on the compiler, the IR layout and the ID of every name*/
+    sprintf(version, "djc %d ir %d\n", COMPILE_CACHE_VERSION, SONG_IR_VERSION);
+    hash_bytes(&hash, version, strlen(version));
+    for (id = 0; id < NUM_SOUND_IDS; id++) {
+        hash_bytes(&hash, SOUND_TABLE[id].name, strlen(SOUND_TABLE[id].name) + 1);
+    }
+    hash_bytes(&hash, source, length);
+
+    sprintf(key, "%08lx%08lx-%lu", (unsigned long)final_mix(hash.h1 ^ hash.length),
+            (unsigned long)final_mix(hash.h2 ^ hash.length), (unsigned long)length);
+}
+
+/* Returns dir/key followed by suffix in a new string, or NULL if out of memory*/
+static char *entry_path(const char *dir, const char *key, const char *suffix) {
+    char *path;
+
+    path = (char *)malloc(strlen(dir) + strlen(key) + strlen(suffix) + 2);
+    if (path) {
+        sprintf(path, "%s/%s%s", dir, key, suffix);
+    }
+    return path;
+}
+
+int compile_cache_load(const char *dir, const char *key, SongIR *ir, double *compile_seconds) {
+    char *path;
+    FILE *fp;
+    int result;
+
+    *compile_seconds = 0.0;
+    path = entry_path(dir, key, ".djir");
+    if (!path) return 1;
+    fp = fopen(path, "rb");
+    if (!fp) {
+        free(path); /* No entry: the common miss, and not an error*/
+        return 1;
+    }
+    fclose(fp);
+    result = song_ir_map(path, ir);
+    free(path);
+    if (result != 0) {
+        return 1; /* Unreadable or from another IR version: recompile and overwrite it*/
+    }
+
+    path = entry_path(dir, key, ".time");
+    if (path && (fp = fopen(path, "r")) != NULL) {
+        if (fscanf(fp, "%lf", compile_seconds) != 1) {
+            *compile_seconds = 0.0;
+        }
+        fclose(fp);
+    }
+    free(path);
+    return 0;
+}
+
+/* Writes ir, or the line text if ir is NULL, to path through a temporary file and a rename*/
+static int write_entry_file(const char *path, const SongIR *ir, const char *text) {
+    char *temp;
+    FILE *fp;
+    int result;
+
+    temp = (char *)malloc(strlen(path) + 32);
+    if (!temp) return -1;
+#ifndef _WIN32
+    /* The stack address tells apart threads of one batch run storing the same source*/
+    sprintf(temp, "%s.%ld.%lx.tmp", path, (long)getpid(), (unsigned long)&temp);
+#else
+    sprintf(temp, "%s.tmp", path);
+#endif
+
+    if (ir) {
+        result = song_ir_write(ir, temp);
+    } else {
+        fp = fopen(temp, "w");
+        result = fp && fputs(text, fp) >= 0 ? 0 : -1;
+        if (fp && fclose(fp) != 0) result = -1;
+    }
+#ifdef _WIN32
+    remove(path); /* rename does not replace an existing file on Windows*/
+#endif
+    if (result == 0 && rename(temp, path) != 0) {
+        result = -1;
+    }
+    if (result != 0) {
+        remove(temp);
+    }
+    free(temp);
+    return result;
+}
+
+int compile_cache_store(const char *dir, const char *key, const SongIR *ir, double compile_seconds) {
+    char text[64];
+    char *path;
+    int result;
+
+#ifndef _WIN32
+    mkdir(dir, 0777); /* Fails harmlessly if it exists; a real failure shows up when writing*/
+#else
+    _mkdir(dir);
+#endif
+
+    /* The time first: an entry whose .djir exists is complete*/
+    path = entry_path(dir, key, ".time");
+    sprintf(text, "%.9f\n", compile_seconds);
+    result = path ? write_entry_file(path, NULL, text) : -1;
+    free(path);
+    if (result == 0) {
+        path = entry_path(dir, key, ".djir");
+        result = path ? write_entry_file(path, ir, NULL) : -1;
+        free(path);
+    }
+    if (result != 0) {
+        fprintf(stderr, "Warning: Could not write compile cache entry in '%s'.\n", dir);
+    }
+    return result;
+}
+
+int compile_cache_record(const char *dir, const CompileCacheStats *counts, CompileCacheStats *totals) {
+    char text[128];
+    char *path;
+    FILE *fp;
+    int result;
+
+    totals->hits = 0;
+    totals->misses = 0;
+    totals->saved_seconds = 0.0;
+    path = entry_path(dir, "stats", "");
+    if (!path) return -1;
+
+    /* Never truncated in place (see write_entry_file), so this reads the old counters or the new ones*/
+    fp = fopen(path, "r");
+    if (fp) {
+        if (fscanf(fp, "hits %lu misses %lu saved %lf", &totals->hits, &totals->misses, &totals->saved_seconds) != 3) {
+            totals->hits = 0;
+            totals->misses = 0;
+            totals->saved_seconds = 0.0;
+        }
+        fclose(fp);
+    }
+    totals->hits += counts->hits;
+    totals->misses += counts->misses;
+    totals->saved_seconds += counts->saved_seconds;
+
+    sprintf(text, "hits %lu misses %lu saved %.6f\n", totals->hits, totals->misses, totals->saved_seconds);
+    result = write_entry_file(path, NULL, text);
+    free(path);
+    return result;
+}
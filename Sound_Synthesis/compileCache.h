@@ -0,0 +1,43 @@
+#ifndef COMPILECACHE_H
+#define COMPILECACHE_H
+
+#include <stddef.h> /* For size_t*/
+#include "songIR.h" /* For SongIR*/
+
+/* On-disk cache of compiled songs, so an unchanged .dj source skips lexing and parsing.
+
+ An entry is the song's binary IR, stored as DIR/<key>.djir and mapped in place on a hit, with the time the
+ compile took in DIR/<key>.time. The key hashes the source bytes together with COMPILE_CACHE_VERSION,
+ SONG_IR_VERSION and the sound names in SoundId order, so editing the source, the compiler or the sound
+ table selects a different entry and stale ones are never loaded. DIR/stats keeps the running hit and
+ miss counts and the compile time saved by hits.*/
+
+/* Bump whenever the lexer, parser or lowering change what a source compiles to*/
+#define COMPILE_CACHE_VERSION 1
+
+#define COMPILE_CACHE_KEY_SIZE 40 /* 16 hex digits, '-', the source length in decimal, NUL*/
+
+typedef struct {
+    unsigned long hits;
+    unsigned long misses;
+    double saved_seconds;
+} CompileCacheStats;
+
+/* Computes the cache key of a .dj source*/
+void compile_cache_key(const char *source, size_t length, char key[COMPILE_CACHE_KEY_SIZE]);
+
+/* Maps the cached IR of key from dir. On a hit also returns the time the original compile took.
+ Returns 0 on a hit, 1 on a miss (no entry, or one that is unreadable or from another IR version).*/
+int compile_cache_load(const char *dir, const char *key, SongIR *ir, double *compile_seconds);
+
+/* Stores ir as the entry for key, creating dir if needed. The entry is written under a temporary name and
+ renamed, so a concurrent reader never maps a partial file. Returns 0 on success, -1 on file error.*/
+int compile_cache_store(const char *dir, const char *key, const SongIR *ir, double compile_seconds);
+
+/* Adds counts (the hits, misses and saved time of one run, a batch summed over its files) to the counters in
+ dir/stats and returns the new totals. The file is replaced through a temporary file and a rename, like the entries,
+ so a concurrent run never reads it half written; two runs finishing at the same moment may still lose one's counts.
+ Call it once per run. Returns 0 on success, -1 if the stats file cannot be written.*/
+int compile_cache_record(const char *dir, const CompileCacheStats *counts, CompileCacheStats *totals);
+
+#endif /* COMPILECACHE_H*/
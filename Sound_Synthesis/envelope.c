@@ -0,0 +1,194 @@
+#include "envelope.h"
+#include <math.h>
+
+/* Level an ADSR decay is taken to fall to, relative to where it starts above the sustain level*/
+#define ADSR_DECAY_FLOOR 0.001
+
+/* Value at position of segment, in closed form*/
+static double segment_value(const EnvelopeSegment *segment, int position) {
+    double fixed;
+
+    if (segment->mul == 1.0) {
+        return segment->start + segment->add * position;
+    }
+    /* The recurrence converges on fixed = add / (1 - mul), geometrically*/
+    fixed = segment->add / (1.0 - segment->mul);
+    return fixed + (segment->start - fixed) * pow(segment->mul, (double)position);
+}
+
+static void add_segment(Envelope *envelope, int length, double start, double mul, double add) {
+    EnvelopeSegment *segment;
+
+    if (length <= 0) return;
+    segment = &envelope->segments[envelope->num_segments++];
+    segment->length = length;
+    segment->start = start;
+    segment->mul = mul;
+    segment->add = add;
+}
+
+void envelope_init(Envelope *envelope, const EnvelopeParams *params, int total_samples) {
+    int attack, decay, release;
+    double sustain, mul;
+
+    envelope->num_segments = 0;
+    envelope->segment = 0;
+    envelope->position = 0;
+    envelope->value = 1.0;
+    switch (params->shape) {
+        case ENVELOPE_EXPONENTIAL:
+            if (params->start > 0.0f && params->end > 0.0f) {
+                mul = pow((double)params->end / params->start, 1.0 / total_samples);
+            } else {
+                mul = params->end > 0.0f ? 1.0 : 0.0;
+            }
+            add_segment(envelope, total_samples, params->start, mul, 0.0);
+            break;
+        case ENVELOPE_ADSR:
+            /* Rounded down to whole samples and cut to fit, release first*/
+            attack = (int)(params->attack * total_samples);
+            decay = (int)(params->decay * total_samples);
+            release = (int)(params->release * total_samples);
+            if (attack > total_samples) attack = total_samples;
+            if (decay > total_samples - attack) decay = total_samples - attack;
+            if (release > total_samples - attack - decay) release = total_samples - attack - decay;
+            sustain = params->end;
+            if (attack > 0) {
+                add_segment(envelope, attack, 0.0, 1.0, 1.0 / attack);
+            }
+            if (decay > 0) {
+                mul = pow(ADSR_DECAY_FLOOR, 1.0 / decay);
+                add_segment(envelope, decay, 1.0, mul, sustain * (1.0 - mul));
+            }
+            add_segment(envelope, total_samples - attack - decay - release, sustain, 1.0, 0.0);
+            if (release > 0) {
+                add_segment(envelope, release, sustain, 1.0, -sustain / release);
+            }
+            break;
+        default:
+            add_segment(envelope, total_samples, 1.0, 1.0, 0.0);
+            break;
+    }
+    if (envelope->num_segments > 0) {
+        envelope->value = envelope->segments[0].start;
+    }
+}
+
+void envelope_fill(Envelope *envelope, float *out, int count) {
+    const EnvelopeSegment *segment;
+    double value, mul, add;
+    int run;
+    int i;
+
+    while (count > 0) {
+        if (envelope->segment >= envelope->num_segments) {
+            for (i = 0; i < count; i++) {
+                out[i] = (float)envelope->value;
+            }
+            return;
+        }
+        segment = &envelope->segments[envelope->segment];
+        if (envelope->position % ENVELOPE_RESYNC == 0) {
+            envelope->value = segment_value(segment, envelope->position);
+        }
+        /* Up to the end of the segment or the next resync, whichever comes first*/
+        run = segment->length - envelope->position;
+        if (run > ENVELOPE_RESYNC - envelope->position % ENVELOPE_RESYNC) {
+            run = ENVELOPE_RESYNC - envelope->position % ENVELOPE_RESYNC;
+        }
+        if (run > count) run = count;
+
+        value = envelope->value;
+        mul = segment->mul;
+        add = segment->add;
+        for (i = 0; i < run; i++) {
+            out[i] = (float)value;
+            value = value * mul + add;
+        }
+        envelope->value = value;
+        envelope->position += run;
+        out += run;
+        count -= run;
+
+        if (envelope->position == segment->length) {
+            envelope->segment++;
+            envelope->position = 0;
+            if (envelope->segment >= envelope->num_segments) {
+                /* Hold the value the last segment ends on*/
+                envelope->value = segment_value(segment, segment->length);
+            }
+        }
+    }
+}
+
+/* value in fixed point with bits fractional bits, rounded to nearest and clamped to the range of int32_t*/
+static int32_t to_fixed(double value, int bits) {
+    value = floor(ldexp(value, bits) + 0.5);
+    if (value > 2147483647.0) return 2147483647;
+    if (value < -2147483648.0) return (-2147483647 - 1);
+    return (int32_t)value;
+}
+
+void envelope_fill_fixed(Envelope *envelope, int32_t *out, int count, int bits) {
+    const EnvelopeSegment *segment;
+    int64_t value;
+    int64_t mul;
+    int64_t add;
+    int run;
+    int i;
+
+    while (count > 0) {
+        if (envelope->segment >= envelope->num_segments) {
+            value = to_fixed(envelope->value, bits);
+            for (i = 0; i < count; i++) {
+                out[i] = (int32_t)value;
+            }
+            return;
+        }
+        segment = &envelope->segments[envelope->segment];
+        if (envelope->position % ENVELOPE_RESYNC == 0) {
+            envelope->value = segment_value(segment, envelope->position);
+        }
+        run = segment->length - envelope->position;
+        if (run > ENVELOPE_RESYNC - envelope->position % ENVELOPE_RESYNC) {
+            run = ENVELOPE_RESYNC - envelope->position % ENVELOPE_RESYNC;
+        }
+        if (run > count) run = count;
+
+        /* The run's start and coefficients are converted once; the recurrence itself is integer*/
+        value = to_fixed(envelope->value, bits);
+        mul = to_fixed(segment->mul, ENVELOPE_MUL_BITS);
+        add = to_fixed(segment->add, bits);
+        for (i = 0; i < run; i++) {
+            out[i] = (int32_t)value;
+            value = ((value * mul + ((int64_t)1 << (ENVELOPE_MUL_BITS - 1))) >> ENVELOPE_MUL_BITS) + add;
+        }
+        envelope->value = ldexp((double)value, -bits);
+        envelope->position += run;
+        out += run;
+        count -= run;
+
+        if (envelope->position == segment->length) {
+            envelope->segment++;
+            envelope->position = 0;
+            if (envelope->segment >= envelope->num_segments) {
+                envelope->value = segment_value(segment, segment->length);
+            }
+        }
+    }
+}
+
+float envelope_next(Envelope *envelope) {
+    float value;
+
+    envelope_fill(envelope, &value, 1);
+    return value;
+}
+
+float envelope_peak(const EnvelopeParams *params) {
+    switch (params->shape) {
+        case ENVELOPE_EXPONENTIAL: return params->start > params->end ? params->start : params->end;
+        case ENVELOPE_ADSR:        return params->end > 1.0f ? params->end : 1.0f;
+        default:                   return 1.0f;
+    }
+}
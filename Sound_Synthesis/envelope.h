@@ -0,0 +1,68 @@
+#ifndef ENVELOPE_H
+#define ENVELOPE_H
+
+#include <stdint.h>
+
+/* Envelopes: a value per sample that scales a sound's level (or, as a pitch envelope, its frequency).
+
+ Every shape is a chain of segments on which the next value is an affine function of the current one,
+ value * mul + add: a geometric segment has add = 0 (or approaches a target), a linear one has mul = 1.
+ So running an envelope costs one multiply-add per sample instead of a pow call. Rounding drift is bounded
+ by recomputing the value in closed form every ENVELOPE_RESYNC samples of a segment.*/
+
+#define ENVELOPE_RESYNC 4096
+
+/* Fractional bits of the multiplier of envelope_fill_fixed (Q2.30, so geometric steps up to 2 fit)*/
+#define ENVELOPE_MUL_BITS 30
+
+typedef enum {
+    ENVELOPE_FLAT = 0,     /* 1 throughout*/
+    ENVELOPE_EXPONENTIAL,  /* start at the first sample, falling (or rising) geometrically to end at the last*/
+    ENVELOPE_ADSR          /* Linear attack from 0 to 1, decay towards the sustain level end, then a linear release to 0*/
+} EnvelopeShape;
+
+/* Shape and levels of an envelope, in fractions of the sound's length so one description fits any length*/
+typedef struct {
+    EnvelopeShape shape;
+    float start;    /* EXPONENTIAL: value at the first sample*/
+    float end;      /* EXPONENTIAL: value reached at the end of the sound (> 0). ADSR: sustain level*/
+    float attack;   /* ADSR: fraction of the sound spent rising to 1*/
+    float decay;    /* ADSR: fraction spent falling to the sustain level (exponentially, to within 60 dB)*/
+    float release;  /* ADSR: fraction at the end spent falling to 0*/
+} EnvelopeParams;
+
+/* v[k] = v0 * mul^k + add * (mul^(k-1) + ... + 1) for 0 <= k < length*/
+typedef struct {
+    int length;
+    double start;
+    double mul;
+    double add;
+} EnvelopeSegment;
+
+/* A running envelope. The segments are set up by envelope_init; after the last one the value holds.*/
+typedef struct {
+    EnvelopeSegment segments[4];
+    int num_segments;
+    int segment;    /* Current segment*/
+    int position;   /* Samples produced in the current segment*/
+    double value;   /* Value of the next sample*/
+} Envelope;
+
+/* Starts envelope at the first of total_samples samples*/
+void envelope_init(Envelope *envelope, const EnvelopeParams *params, int total_samples);
+
+/* Writes the next count values of envelope to out[0 .. count)*/
+void envelope_fill(Envelope *envelope, float *out, int count);
+
+/* envelope_fill in fixed point: the values, with bits fractional bits (30 for a level, Q2.30), come from an integer
+ recurrence with a Q2.30 multiplier. Only the start of each run (a segment, or ENVELOPE_RESYNC samples of one) is
+ converted from the exact value, so the drift of a run stays well below one Q15 step.*/
+void envelope_fill_fixed(Envelope *envelope, int32_t *out, int count, int bits);
+
+/* The next value of envelope*/
+float envelope_next(Envelope *envelope);
+
+/* Highest value an envelope described by params reaches*/
+float envelope_peak(const EnvelopeParams *params);
+
+#endif /* ENVELOPE_H*/
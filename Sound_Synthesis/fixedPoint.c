@@ -0,0 +1,133 @@
+#define _POSIX_C_SOURCE 200112L /* For pthread_once with -ansi*/
+#include "fixedPoint.h"
+#include <math.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#define PI 3.14159265358979323846
+
+/* Bits of the phase below the table index, and the 16 of them the interpolation uses*/
+#define FX_FRACTION_BITS (32 - FX_SINE_BITS)
+#define FX_FRACTION_SHIFT (FX_FRACTION_BITS - 16)
+
+/* One period, and a guard sample so interpolation needs no index masking*/
+static int16_t sine_table[FX_SINE_SIZE + 1];
+
+#ifndef _WIN32
+static pthread_once_t sine_once = PTHREAD_ONCE_INIT;
+#else
+static int sine_built = 0; /* Windows builds render on one thread*/
+#endif
+
+static void build_sine(void) {
+    int j;
+
+    for (j = 0; j <= FX_SINE_SIZE; j++) {
+        sine_table[j] = (int16_t)floor(32767.0 * sin(2.0 * PI * j / FX_SINE_SIZE) + 0.5);
+    }
+}
+
+static const int16_t *sine_lookup(void) {
+#ifndef _WIN32
+    pthread_once(&sine_once, build_sine);
+#else
+    if (!sine_built) {
+        build_sine();
+        sine_built = 1;
+    }
+#endif
+    return sine_table;
+}
+
+uint32_t fx_increment(float frequency, float sample_rate) {
+    return (uint32_t)floor((double)frequency / sample_rate * 4294967296.0 + 0.5);
+}
+
+/* Q15 sine at phase, interpolated linearly between table samples (within 5e-6 of sin, below a Q15 step)*/
+static int32_t sine_at(const int16_t *table, uint32_t phase) {
+    const int16_t *p;
+    int32_t fraction;
+
+    p = table + (phase >> FX_FRACTION_BITS);
+    fraction = (int32_t)((phase >> FX_FRACTION_SHIFT) & 0xFFFF);
+    return p[0] + (((p[1] - p[0]) * fraction) >> 16);
+}
+
+/* Q15 triangle at phase, exact: -1 at phase 0, rising to 1 at half a period (like triangle_wave in voice.c)*/
+static int32_t triangle_at(uint32_t phase) {
+    uint32_t distance;
+
+    distance = phase < 0x80000000u ? phase : 0u - phase; /* From the nearest start of a period*/
+    return (int32_t)(distance >> 15) - FX_ONE;
+}
+
+void fx_shape(float *out, int count, FxVoice *voice) {
+    const int16_t *table;
+    uint32_t sine_phase;
+    uint32_t triangle_phase;
+    int32_t mix;
+    int32_t value;
+    int i;
+
+    table = sine_lookup();
+    sine_phase = voice->sine_phase;
+    triangle_phase = voice->triangle_phase;
+    for (i = 0; i < count; i++) {
+        /* Q30 sum of Q15 products; the weights add up to at most 1, so it cannot overflow*/
+        mix = 0;
+        if (voice->sine_weight != 0) mix += sine_at(table, sine_phase) * voice->sine_weight;
+        if (voice->triangle_weight != 0) mix += triangle_at(triangle_phase) * voice->triangle_weight;
+        if (voice->noise_weight != 0) mix += voice->noise[i] * voice->noise_weight;
+
+        /* Q30 times Q2.30 is Q60: back to Q15, then to the output scale*/
+        value = (int32_t)(((int64_t)mix * voice->level[i]) >> (FX_LEVEL_BITS + 15));
+        value = (value * voice->amplitude) >> 15;
+        out[i] = voice->accumulate ? out[i] + voice->mix_gain * (float)value : (float)value;
+
+        if (voice->ratio) {
+            sine_phase += (uint32_t)(((uint64_t)voice->sine_increment * (uint32_t)voice->ratio[i]) >> FX_RATIO_BITS);
+            triangle_phase += (uint32_t)(((uint64_t)voice->triangle_increment * (uint32_t)voice->ratio[i]) >>
+                                         FX_RATIO_BITS);
+        } else {
+            sine_phase += voice->sine_increment;
+            triangle_phase += voice->triangle_increment;
+        }
+    }
+    voice->sine_phase = sine_phase;
+    voice->triangle_phase = triangle_phase;
+}
+
+void fx_bank_init(FxBank *bank, const float *frequencies, const float *weights, int num_partials, float sample_rate) {
+    int n;
+    int k;
+
+    n = 0;
+    for (k = 0; k < num_partials && n < OSC_BANK_MAX_PARTIALS; k++) {
+        if (frequencies[k] <= 0.0f || frequencies[k] >= 0.5f * sample_rate) continue;
+        bank->phase[n] = 0;
+        bank->increment[n] = fx_increment(frequencies[k], sample_rate);
+        bank->weight[n] = (int32_t)floor(weights[k] * (double)FX_ONE + 0.5);
+        n++;
+    }
+    bank->num_partials = n;
+}
+
+void fx_bank_fill(FxBank *bank, int16_t *out, int count) {
+    const int16_t *table;
+    int32_t sum;
+    int i;
+    int k;
+
+    table = sine_lookup();
+    for (i = 0; i < count; i++) {
+        /* Q30, as in fx_shape*/
+        sum = 0;
+        for (k = 0; k < bank->num_partials; k++) {
+            sum += sine_at(table, bank->phase[k]) * bank->weight[k];
+            bank->phase[k] += bank->increment[k];
+        }
+        sum = (sum + (1 << 14)) >> 15;
+        out[i] = (int16_t)(sum > 32767 ? 32767 : sum < -32768 ? -32768 : sum);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <stdint.h>
+#include "oscBank.h" /* For OSC_BANK_MAX_PARTIALS*/
+
+/* Fixed-point synthesis (--osc fixed): the integer counterpart of the float kernels, for CPUs where float
+ transcendental math is what a render spends its time on.
+
+ Phases are 32-bit accumulators (a fraction of 2^32 of a period, so the pitch never drifts). The sine is read
+ from a Q15 table of FX_SINE_SIZE samples with linear interpolation, the triangle is computed exactly from the
+ phase, noise is Q15 (noise_fill_q15) and envelopes come from an integer recurrence (envelope_fill_fixed). The
+ only float operation left per sample is the store to the float mix bus.
+
+ Against the float reference (--osc direct --isa scalar) the output has a signal-to-noise ratio of at least
+ FX_MIN_SNR_DB on the drums and the noise sounds (56 to 72 dB measured) and FX_MIN_SNR_DRIFT_DB on the triangle
+ sounds (30 to 49 dB), Driver/bench_kernels.py checks both. The triangle's error is not fixed-point rounding but the
+ reference's own pitch drift: its float phase rounds at every sample, which at 900 Hz adds up over a beat, while
+ the integer phase is exact (the float wavetable engine, whose phase is also exact, measures the same 29 dB on DING).*/
+
+#define FX_SINE_BITS 10
+#define FX_SINE_SIZE (1 << FX_SINE_BITS)
+
+/* Fractional bits of levels (Q2.30) and pitch ratios (Q8.24)*/
+#define FX_LEVEL_BITS 30
+#define FX_RATIO_BITS 24
+
+/* Q15 weight of 1*/
+#define FX_ONE 32768
+
+/* Lowest signal-to-noise ratios, in dB, of a fixed-point render against the float reference*/
+#define FX_MIN_SNR_DB 50.0
+#define FX_MIN_SNR_DRIFT_DB 25.0
+
+/* The sources of one fixed-point sound. Sample i is
+   ((sine_weight * sin(sine_phase) + triangle_weight * triangle(triangle_phase) + noise_weight * noise[i])
+     * level[i]) * amplitude
+ in integers, the formula of the float kernels (see OscVoice). A weight of 0 leaves its source out.*/
+typedef struct {
+    uint32_t sine_phase;          /* Fractions of 2^32 of a period, advanced by fx_shape*/
+    uint32_t sine_increment;      /* Phase step per sample*/
+    uint32_t triangle_phase;
+    uint32_t triangle_increment;
+    int32_t sine_weight;          /* Q15*/
+    int32_t triangle_weight;
+    int32_t noise_weight;
+    const int16_t *noise;         /* Q15 white noise*/
+    const int32_t *level;         /* Q2.30 envelope*/
+    const int32_t *ratio;         /* Q8.24 pitch envelope, multiplying the increments, or NULL*/
+    int32_t amplitude;            /* Output of a full-scale sample (MAX_AMPLITUDE times the sound's gain)*/
+    int accumulate;               /* 0 stores the samples in out; 1 adds them to it, times mix_gain*/
+    float mix_gain;
+} FxVoice;
+
+/* The fixed-point oscBank: sines read from the table at their own phase, summed with Q15 weights (which add up
+ to at most 1)*/
+typedef struct {
+    uint32_t phase[OSC_BANK_MAX_PARTIALS];
+    uint32_t increment[OSC_BANK_MAX_PARTIALS];
+    int32_t weight[OSC_BANK_MAX_PARTIALS];
+    int num_partials;
+} FxBank;
+
+/* Phase step per sample of frequency*/
+uint32_t fx_increment(float frequency, float sample_rate);
+
+/* Writes samples 0 .. count - 1 of voice to out (or adds them) and advances its phases past them*/
+void fx_shape(float *out, int count, FxVoice *voice);
+
+/* Starts num_partials sines at phase 0, leaving out those at or above half the sample rate (as osc_bank_init does)*/
+void fx_bank_init(FxBank *bank, const float *frequencies, const float *weights, int num_partials, float sample_rate);
+
+/* Writes the next count samples of the sum to out in Q15, saturated, and advances the phases past them*/
+void fx_bank_fill(FxBank *bank, int16_t *out, int count);
+
+#endif /* FIXEDPOINT_H*/
@@ -0,0 +1,462 @@
+#include "mixBus.h"
+#include "oscillators.h" /* For osc_active_isa*/
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MIXBUS_X86 1
+#include <immintrin.h>
+#endif
+
+/* Distance from the threshold to full scale: a sample d above the threshold comes out
+ KNEE * d / (KNEE + d) above it, with slope 1 at the threshold and never reaching full scale*/
+#define KNEE (32767.0f - MIX_LIMIT_THRESHOLD)
+
+static MixOutput active_output = MIX_OUTPUT_CLIP;
+
+static float limit_sample(float sample) {
+    float magnitude;
+
+    magnitude = sample < 0.0f ? -sample : sample;
+    if (magnitude <= MIX_LIMIT_THRESHOLD) {
+        return sample;
+    }
+    magnitude -= MIX_LIMIT_THRESHOLD;
+    magnitude = MIX_LIMIT_THRESHOLD + KNEE * magnitude / (KNEE + magnitude);
+    return sample < 0.0f ? -magnitude : magnitude;
+}
+
+static void to_pcm_scalar(const float *bus, int16_t *out, size_t count, MixOutput output) {
+    float sample;
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        sample = bus[i];
+        if (output == MIX_OUTPUT_LIMIT) sample = limit_sample(sample);
+        if (sample > 32767.0f) sample = 32767.0f;
+        if (sample < -32768.0f) sample = -32768.0f;
+        out[i] = (int16_t)sample;
+    }
+}
+
+#ifdef MIXBUS_X86
+/* The SIMD versions clamp before converting (cvttps gives INT_MIN for anything out of the int32 range) and
+ saturate when packing, so they match the scalar loop exactly*/
+
+__attribute__((target("sse2")))
+static __m128 limit_sse2(__m128 sample) {
+    __m128 sign, magnitude, over;
+
+    sign = _mm_and_ps(sample, _mm_set1_ps(-0.0f));
+    magnitude = _mm_andnot_ps(_mm_set1_ps(-0.0f), sample);
+    over = _mm_sub_ps(magnitude, _mm_set1_ps(MIX_LIMIT_THRESHOLD));
+    over = _mm_div_ps(_mm_mul_ps(_mm_set1_ps(KNEE), over), _mm_add_ps(_mm_set1_ps(KNEE), over));
+    over = _mm_add_ps(_mm_set1_ps(MIX_LIMIT_THRESHOLD), over);
+    magnitude = _mm_or_ps(_mm_and_ps(_mm_cmpgt_ps(magnitude, _mm_set1_ps(MIX_LIMIT_THRESHOLD)), over),
+                          _mm_andnot_ps(_mm_cmpgt_ps(magnitude, _mm_set1_ps(MIX_LIMIT_THRESHOLD)), magnitude));
+    return _mm_or_ps(magnitude, sign);
+}
+
+__attribute__((target("sse2")))
+static __m128i convert_sse2(__m128 sample, MixOutput output) {
+    if (output == MIX_OUTPUT_LIMIT) sample = limit_sse2(sample);
+    sample = _mm_min_ps(_mm_max_ps(sample, _mm_set1_ps(-32768.0f)), _mm_set1_ps(32767.0f));
+    return _mm_cvttps_epi32(sample);
+}
+
+/* 8 samples per iteration; returns how many were converted*/
+__attribute__((target("sse2")))
+static size_t to_pcm_sse2(const float *bus, int16_t *out, size_t count, MixOutput output) {
+    __m128i low, high;
+    size_t i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        low = convert_sse2(_mm_loadu_ps(bus + i), output);
+        high = convert_sse2(_mm_loadu_ps(bus + i + 4), output);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(low, high));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static __m256 limit_avx2(__m256 sample) {
+    __m256 sign, magnitude, over;
+
+    sign = _mm256_and_ps(sample, _mm256_set1_ps(-0.0f));
+    magnitude = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), sample);
+    over = _mm256_sub_ps(magnitude, _mm256_set1_ps(MIX_LIMIT_THRESHOLD));
+    over = _mm256_div_ps(_mm256_mul_ps(_mm256_set1_ps(KNEE), over), _mm256_add_ps(_mm256_set1_ps(KNEE), over));
+    over = _mm256_add_ps(_mm256_set1_ps(MIX_LIMIT_THRESHOLD), over);
+    magnitude = _mm256_blendv_ps(magnitude, over,
+                                 _mm256_cmp_ps(magnitude, _mm256_set1_ps(MIX_LIMIT_THRESHOLD), _CMP_GT_OQ));
+    return _mm256_or_ps(magnitude, sign);
+}
+
+__attribute__((target("avx2")))
+static __m256i convert_avx2(__m256 sample, MixOutput output) {
+    if (output == MIX_OUTPUT_LIMIT) sample = limit_avx2(sample);
+    sample = _mm256_min_ps(_mm256_max_ps(sample, _mm256_set1_ps(-32768.0f)), _mm256_set1_ps(32767.0f));
+    return _mm256_cvttps_epi32(sample);
+}
+
+/* 16 samples per iteration*/
+__attribute__((target("avx2")))
+static size_t to_pcm_avx2(const float *bus, int16_t *out, size_t count, MixOutput output) {
+    __m256i packed;
+    size_t i;
+
+    for (i = 0; i + 16 <= count; i += 16) {
+        /* packs works within 128-bit lanes; the permute puts the 16 samples back in order*/
+        packed = _mm256_packs_epi32(convert_avx2(_mm256_loadu_ps(bus + i), output),
+                                    convert_avx2(_mm256_loadu_ps(bus + i + 8), output));
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    return i;
+}
+#endif
+
+void mix_set_output(MixOutput output) {
+    active_output = output;
+}
+
+MixOutput mix_active_output(void) {
+    return active_output;
+}
+
+const char *mix_output_name(MixOutput output) {
+    return output == MIX_OUTPUT_LIMIT ? "limit" : "clip";
+}
+
+void mix_bus_to_pcm(const float *bus, int16_t *out, size_t count, MixOutput output) {
+    size_t done;
+
+    done = 0;
+#ifdef MIXBUS_X86
+    switch (osc_active_isa()) {
+        case OSC_ISA_AVX512:
+        case OSC_ISA_AVX2: done = to_pcm_avx2(bus, out, count, output); break;
+        case OSC_ISA_SSE2: done = to_pcm_sse2(bus, out, count, output); break;
+        default:           break;
+    }
+#endif
+    to_pcm_scalar(bus + done, out + done, count - done, output);
+}
+
+/* The N-way mixer. Every set has a body kernel that sums up to MIX_GROUP sources over a whole number of its
+ vectors; mix_bus_sum and mix_pcm_sum run the body on the aligned middle of the destination, and the same kernel on
+ zero-padded copies of the unaligned head and the tail, so every sample goes through the same arithmetic.*/
+
+/* Sources summed per pass over the destination*/
+#define MIX_GROUP 16
+
+/* Samples in the widest vector: the most a head or tail can have*/
+#define MIX_WIDTH 32
+
+/* Q15 gain of a unity-gain PCM source: added without scaling*/
+#define Q15_UNITY 32768
+
+typedef void (*SumBlock)(float *dest, const float *const *samples, const float *gains, int n, size_t count);
+typedef void (*SumPcmBlock)(int16_t *dest, const int16_t *const *samples, const int *gains, int n, size_t count);
+
+static void sum_scalar(float *dest, const float *const *samples, const float *gains, int n, size_t count) {
+    float acc;
+    size_t i;
+    int k;
+
+    for (i = 0; i < count; i++) {
+        acc = dest[i];
+        for (k = 0; k < n; k++) {
+            acc = acc + gains[k] * samples[k][i];
+        }
+        dest[i] = acc;
+    }
+}
+
+/* (x * gain + 2^14) >> 15: what pmulhrsw computes*/
+static int32_t scale_q15(int32_t x, int gain) {
+    return (x * gain + 0x4000) >> 15;
+}
+
+static void sum_pcm_scalar(int16_t *dest, const int16_t *const *samples, const int *gains, int n, size_t count) {
+    int32_t acc;
+    size_t i;
+    int k;
+
+    for (i = 0; i < count; i++) {
+        acc = dest[i];
+        for (k = 0; k < n; k++) {
+            acc += gains[k] == Q15_UNITY ? samples[k][i] : scale_q15(samples[k][i], gains[k]);
+            if (acc > 32767) acc = 32767;
+            if (acc < -32768) acc = -32768;
+        }
+        dest[i] = (int16_t)acc;
+    }
+}
+
+#ifdef MIXBUS_X86
+__attribute__((target("sse2")))
+static void sum_sse2(float *dest, const float *const *samples, const float *gains, int n, size_t count) {
+    __m128 acc;
+    size_t i;
+    int k;
+
+    for (i = 0; i < count; i += 4) {
+        acc = _mm_loadu_ps(dest + i);
+        for (k = 0; k < n; k++) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(gains[k]), _mm_loadu_ps(samples[k] + i)));
+        }
+        _mm_storeu_ps(dest + i, acc);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void sum_avx2(float *dest, const float *const *samples, const float *gains, int n, size_t count) {
+    __m256 acc;
+    size_t i;
+    int k;
+
+    for (i = 0; i < count; i += 8) {
+        acc = _mm256_loadu_ps(dest + i);
+        for (k = 0; k < n; k++) {
+            acc = _mm256_fmadd_ps(_mm256_set1_ps(gains[k]), _mm256_loadu_ps(samples[k] + i), acc);
+        }
+        _mm256_storeu_ps(dest + i, acc);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void sum_avx512(float *dest, const float *const *samples, const float *gains, int n, size_t count) {
+    __m512 acc;
+    size_t i;
+    int k;
+
+    for (i = 0; i < count; i += 16) {
+        acc = _mm512_loadu_ps(dest + i);
+        for (k = 0; k < n; k++) {
+            acc = _mm512_fmadd_ps(_mm512_set1_ps(gains[k]), _mm512_loadu_ps(samples[k] + i), acc);
+        }
+        _mm512_storeu_ps(dest + i, acc);
+    }
+}
+
+/* SSE2 has no pmulhrsw: the 32-bit products are rounded and shifted by hand*/
+__attribute__((target("sse2")))
+static __m128i scale_q15_sse2(__m128i x, int gain) {
+    __m128i lo, hi, round;
+
+    lo = _mm_mullo_epi16(x, _mm_set1_epi16((short)gain));
+    hi = _mm_mulhi_epi16(x, _mm_set1_epi16((short)gain));
+    round = _mm_set1_epi32(0x4000);
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 15),
+                           _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 15));
+}
+
+__attribute__((target("sse2")))
+static void sum_pcm_sse2(int16_t *dest, const int16_t *const *samples, const int *gains, int n, size_t count) {
+    __m128i acc, source;
+    size_t i;
+    int k;
+
+    for (i = 0; i < count; i += 8) {
+        acc = _mm_loadu_si128((const __m128i *)(dest + i));
+        for (k = 0; k < n; k++) {
+            source = _mm_loadu_si128((const __m128i *)(samples[k] + i));
+            if (gains[k] != Q15_UNITY) source = scale_q15_sse2(source, gains[k]);
+            acc = _mm_adds_epi16(acc, source);
+        }
+        _mm_storeu_si128((__m128i *)(dest + i), acc);
+    }
+}
+
+__attribute__((target("avx2")))
+static void sum_pcm_avx2(int16_t *dest, const int16_t *const *samples, const int *gains, int n, size_t count) {
+    __m256i acc, source;
+    size_t i;
+    int k;
+
+    for (i = 0; i < count; i += 16) {
+        acc = _mm256_loadu_si256((const __m256i *)(dest + i));
+        for (k = 0; k < n; k++) {
+            source = _mm256_loadu_si256((const __m256i *)(samples[k] + i));
+            if (gains[k] != Q15_UNITY) source = _mm256_mulhrs_epi16(source, _mm256_set1_epi16((short)gains[k]));
+            acc = _mm256_adds_epi16(acc, source);
+        }
+        _mm256_storeu_si256((__m256i *)(dest + i), acc);
+    }
+}
+
+__attribute__((target("avx512bw")))
+static void sum_pcm_avx512(int16_t *dest, const int16_t *const *samples, const int *gains, int n, size_t count) {
+    __m512i acc, source;
+    size_t i;
+    int k;
+
+    for (i = 0; i < count; i += 32) {
+        acc = _mm512_loadu_si512((const void *)(dest + i));
+        for (k = 0; k < n; k++) {
+            source = _mm512_loadu_si512((const void *)(samples[k] + i));
+            if (gains[k] != Q15_UNITY) source = _mm512_mulhrs_epi16(source, _mm512_set1_epi16((short)gains[k]));
+            acc = _mm512_adds_epi16(acc, source);
+        }
+        _mm512_storeu_si512((void *)(dest + i), acc);
+    }
+}
+#endif
+
+/* The float kernel of the active set and its vector width in samples*/
+static SumBlock sum_block(size_t *width) {
+#ifdef MIXBUS_X86
+    switch (osc_active_isa()) {
+        case OSC_ISA_AVX512:
+            *width = 16;
+            return sum_avx512;
+        case OSC_ISA_AVX2:
+            if (__builtin_cpu_supports("fma")) {
+                *width = 8;
+                return sum_avx2;
+            }
+            *width = 4;
+            return sum_sse2;
+        case OSC_ISA_SSE2:
+            *width = 4;
+            return sum_sse2;
+        default:
+            break;
+    }
+#endif
+    *width = 1;
+    return sum_scalar;
+}
+
+static SumPcmBlock sum_pcm_block(size_t *width) {
+#ifdef MIXBUS_X86
+    switch (osc_active_isa()) {
+        case OSC_ISA_AVX512:
+            if (__builtin_cpu_supports("avx512bw")) {
+                *width = 32;
+                return sum_pcm_avx512;
+            }
+            *width = 16;
+            return sum_pcm_avx2;
+        case OSC_ISA_AVX2:
+            *width = 16;
+            return sum_pcm_avx2;
+        case OSC_ISA_SSE2:
+            *width = 8;
+            return sum_pcm_sse2;
+        default:
+            break;
+    }
+#endif
+    *width = 1;
+    return sum_pcm_scalar;
+}
+
+/* Samples before the first one whose address is a multiple of width samples (no more than count)*/
+static size_t head_length(const void *dest, size_t sample_size, size_t width, size_t count) {
+    size_t misalignment;
+    size_t head;
+
+    misalignment = (size_t)((uintptr_t)dest % (width * sample_size)) / sample_size;
+    head = misalignment ? width - misalignment : 0;
+    return head < count ? head : count;
+}
+
+/* Runs kernel on samples first .. first + length - 1 (length < width) through zero-padded copies of one vector*/
+static void sum_partial(SumBlock kernel, size_t width, float *dest, const float *const *samples, const float *gains,
+                        int n, size_t first, size_t length) {
+    float dest_copy[MIX_WIDTH];
+    float copies[MIX_GROUP][MIX_WIDTH];
+    const float *copy_of[MIX_GROUP];
+    int k;
+
+    memset(dest_copy, 0, sizeof(dest_copy));
+    memcpy(dest_copy, dest + first, length * sizeof(float));
+    for (k = 0; k < n; k++) {
+        memset(copies[k], 0, sizeof(copies[k]));
+        memcpy(copies[k], samples[k] + first, length * sizeof(float));
+        copy_of[k] = copies[k];
+    }
+    kernel(dest_copy, copy_of, gains, n, width);
+    memcpy(dest + first, dest_copy, length * sizeof(float));
+}
+
+static void sum_pcm_partial(SumPcmBlock kernel, size_t width, int16_t *dest, const int16_t *const *samples,
+                            const int *gains, int n, size_t first, size_t length) {
+    int16_t dest_copy[MIX_WIDTH];
+    int16_t copies[MIX_GROUP][MIX_WIDTH];
+    const int16_t *copy_of[MIX_GROUP];
+    int k;
+
+    memset(dest_copy, 0, sizeof(dest_copy));
+    memcpy(dest_copy, dest + first, length * sizeof(int16_t));
+    for (k = 0; k < n; k++) {
+        memset(copies[k], 0, sizeof(copies[k]));
+        memcpy(copies[k], samples[k] + first, length * sizeof(int16_t));
+        copy_of[k] = copies[k];
+    }
+    kernel(dest_copy, copy_of, gains, n, width);
+    memcpy(dest + first, dest_copy, length * sizeof(int16_t));
+}
+
+void mix_bus_sum(float *dest, const MixSource *sources, int num_sources, size_t count) {
+    const float *samples[MIX_GROUP];
+    const float *body[MIX_GROUP];
+    float gains[MIX_GROUP];
+    SumBlock kernel;
+    size_t width;
+    size_t head;
+    size_t middle;
+    int first;
+    int n;
+    int k;
+
+    kernel = sum_block(&width);
+    head = head_length(dest, sizeof(float), width, count);
+    middle = (count - head) / width * width;
+    for (first = 0; first < num_sources; first += MIX_GROUP) {
+        n = num_sources - first < MIX_GROUP ? num_sources - first : MIX_GROUP;
+        for (k = 0; k < n; k++) {
+            samples[k] = sources[first + k].samples;
+            body[k] = samples[k] + head;
+            gains[k] = sources[first + k].gain;
+        }
+        if (head > 0) sum_partial(kernel, width, dest, samples, gains, n, 0, head);
+        kernel(dest + head, body, gains, n, middle);
+        if (head + middle < count) {
+            sum_partial(kernel, width, dest, samples, gains, n, head + middle, count - head - middle);
+        }
+    }
+}
+
+void mix_pcm_sum(int16_t *dest, const MixSourcePcm *sources, int num_sources, size_t count) {
+    const int16_t *samples[MIX_GROUP];
+    const int16_t *body[MIX_GROUP];
+    int gains[MIX_GROUP];
+    SumPcmBlock kernel;
+    size_t width;
+    size_t head;
+    size_t middle;
+    int first;
+    int n;
+    int k;
+
+    kernel = sum_pcm_block(&width);
+    head = head_length(dest, sizeof(int16_t), width, count);
+    middle = (count - head) / width * width;
+    for (first = 0; first < num_sources; first += MIX_GROUP) {
+        n = num_sources - first < MIX_GROUP ? num_sources - first : MIX_GROUP;
+        for (k = 0; k < n; k++) {
+            samples[k] = sources[first + k].samples;
+            body[k] = samples[k] + head;
+            /* Rounded to Q15; 1 (and anything above) adds the samples unscaled*/
+            gains[k] = sources[first + k].gain >= 1.0f ? Q15_UNITY
+                     : sources[first + k].gain <= 0.0f ? 0 : (int)(sources[first + k].gain * 32768.0f + 0.5f);
+            if (gains[k] > 32767) gains[k] = Q15_UNITY;
+        }
+        if (head > 0) sum_pcm_partial(kernel, width, dest, samples, gains, n, 0, head);
+        kernel(dest + head, body, gains, n, middle);
+        if (head + middle < count) {
+            sum_pcm_partial(kernel, width, dest, samples, gains, n, head + middle, count - head - middle);
+        }
+    }
+}
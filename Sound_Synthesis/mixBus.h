@@ -0,0 +1,60 @@
+#ifndef MIXBUS_H
+#define MIXBUS_H
+
+#include <stdint.h>
+#include <stddef.h> /* For size_t*/
+
+/* The mix bus: the timeline a song is rendered into, in float samples on the 16-bit scale (MAX_AMPLITUDE is the
+ loudest a single sound gets). Kernels write float and hits are summed without rounding or clamping, so
+ overlapping sounds keep their headroom; the bus is converted to 16-bit PCM once, at the end, by mix_bus_to_pcm.*/
+
+/* How samples beyond the 16-bit range are brought back into it*/
+typedef enum {
+    MIX_OUTPUT_CLIP = 0,  /* Clamp to [-32768, 32767]: the bus is exact up to full scale (the default)*/
+    MIX_OUTPUT_LIMIT      /* Soft knee: linear up to MIX_LIMIT_THRESHOLD, then bending smoothly towards full scale*/
+} MixOutput;
+
+/* Level (on the 16-bit scale, about -2.5 dBFS) above which MIX_OUTPUT_LIMIT starts to compress*/
+#define MIX_LIMIT_THRESHOLD 24576.0f
+
+/* Selects the conversion of every later render (MIX_OUTPUT_CLIP until called)*/
+void mix_set_output(MixOutput output);
+
+MixOutput mix_active_output(void);
+
+/* "clip", "limit"*/
+const char *mix_output_name(MixOutput output);
+
+/* Converts count samples of bus to 16 bits with output, truncating towards zero as the kernels always have,
+ with the SIMD set osc_active_isa() names. out may be bus itself: sample i is read before it is overwritten,
+ so a bus can be turned into its PCM in place (its first half then holds the result).*/
+void mix_bus_to_pcm(const float *bus, int16_t *out, size_t count, MixOutput output);
+
+/* The N-way mixer: sums any number of sources, each scaled by its own gain, into a destination in one pass, so the
+ destination is loaded and stored once however many sources there are. Uses the SIMD set osc_active_isa() names;
+ destination and sources may have any alignment (the destination is brought to vector alignment by a scalar head,
+ and the end is finished by a scalar tail).*/
+
+/* One source of mix_bus_sum*/
+typedef struct {
+    const float *samples;
+    float gain;
+} MixSource;
+
+/* One source of mix_pcm_sum. gain is applied in Q15 with rounding, so it must be in [0, 1]; 1 adds the samples as
+ they are.*/
+typedef struct {
+    const int16_t *samples;
+    float gain;
+} MixSourcePcm;
+
+/* dest[i] = (dest[i] + sources[0].gain * sources[0].samples[i]) + sources[1].gain * ... for 0 <= i < count.
+ With FMA (AVX2 machines that have it, and AVX-512) each product is added unrounded; a gain of 1 is exact
+ either way, so unity-gain mixes come out the same on every set.*/
+void mix_bus_sum(float *dest, const MixSource *sources, int num_sources, size_t count);
+
+/* The same into 16-bit PCM: each scaled source is added to dest[i] in order with saturation (paddsw), so the result
+ is exactly that of mixing the sources in one at a time with clamping, and the same on every set.*/
+void mix_pcm_sum(int16_t *dest, const MixSourcePcm *sources, int num_sources, size_t count);
+
+#endif /* MIXBUS_H*/
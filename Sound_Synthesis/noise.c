@@ -0,0 +1,310 @@
+#include "noise.h"
+#include "oscillators.h" /* For osc_active_isa*/
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NOISE_X86 1
+#include <immintrin.h>
+#endif
+
+/* Philox4x32 multipliers and Weyl key increments*/
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+/* A word to [-1, 1): the top 24 bits, exactly*/
+#define TO_SAMPLE_SCALE (1.0f / 8388608.0f)
+
+static unsigned long song_seed = 0;
+
+/* The 4 words of block counter of event: Philox4x32-10 of (counter, beat, loop, play) under the event's key*/
+static void philox(const NoiseEvent *event, uint32_t counter, uint32_t words[4]) {
+    uint32_t c0, c1, c2, c3, k0, k1;
+    uint32_t lo0, hi0, lo1, hi1;
+    uint64_t product;
+    int round;
+
+    c0 = counter;
+    c1 = event->beat;
+    c2 = event->loop;
+    c3 = event->play;
+    k0 = event->key[0];
+    k1 = event->key[1];
+    for (round = 0; round < PHILOX_ROUNDS; round++) {
+        product = (uint64_t)PHILOX_M0 * c0;
+        lo0 = (uint32_t)product;
+        hi0 = (uint32_t)(product >> 32);
+        product = (uint64_t)PHILOX_M1 * c2;
+        lo1 = (uint32_t)product;
+        hi1 = (uint32_t)(product >> 32);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    words[0] = c0;
+    words[1] = c1;
+    words[2] = c2;
+    words[3] = c3;
+}
+
+/* Samples 4 * first .. 4 * (first + count) - 1 of event*/
+static void blocks_scalar(const NoiseEvent *event, uint32_t first, int count, float *out) {
+    uint32_t words[4];
+    int block;
+    int w;
+
+    for (block = 0; block < count; block++) {
+        philox(event, first + (uint32_t)block, words);
+        for (w = 0; w < 4; w++) {
+            out[4 * block + w] = (float)(words[w] >> 8) * TO_SAMPLE_SCALE - 1.0f;
+        }
+    }
+}
+
+/* The same in Q15: the top 16 bits of each word, which is the float sample rounded down to a multiple of 2^-15*/
+static void blocks_q15(const NoiseEvent *event, uint32_t first, int count, int16_t *out) {
+    uint32_t words[4];
+    int block;
+    int w;
+
+    for (block = 0; block < count; block++) {
+        philox(event, first + (uint32_t)block, words);
+        for (w = 0; w < 4; w++) {
+            out[4 * block + w] = (int16_t)((int32_t)(words[w] >> 16) - 32768);
+        }
+    }
+}
+
+#ifdef NOISE_X86
+/* SSE2: 4 blocks per iteration, one per lane. mul_epu32 multiplies the even lanes only, so the odd ones are
+ shifted down and multiplied separately.*/
+
+__attribute__((target("sse2")))
+static void mulhilo_sse2(__m128i x, uint32_t m, __m128i *lo, __m128i *hi) {
+    __m128i even, odd, low_lanes;
+
+    even = _mm_mul_epu32(x, _mm_set1_epi32((int)m));
+    odd = _mm_mul_epu32(_mm_srli_epi64(x, 32), _mm_set1_epi32((int)m));
+    low_lanes = _mm_set_epi32(0, -1, 0, -1);
+    *lo = _mm_or_si128(_mm_and_si128(even, low_lanes), _mm_slli_epi64(odd, 32));
+    *hi = _mm_or_si128(_mm_srli_epi64(even, 32), _mm_andnot_si128(low_lanes, odd));
+}
+
+__attribute__((target("sse2")))
+static __m128 to_sample_sse2(__m128i x) {
+    return _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)), _mm_set1_ps(TO_SAMPLE_SCALE)),
+                      _mm_set1_ps(1.0f));
+}
+
+__attribute__((target("sse2")))
+static int blocks_sse2(const NoiseEvent *event, uint32_t first, int count, float *out) {
+    __m128i c0, c1, c2, c3, lo0, hi0, lo1, hi1;
+    __m128 w0, w1, w2, w3, t0, t1, t2, t3;
+    uint32_t k0, k1;
+    int block, round;
+
+    for (block = 0; block + 4 <= count; block += 4) {
+        c0 = _mm_add_epi32(_mm_set1_epi32((int)(first + (uint32_t)block)), _mm_setr_epi32(0, 1, 2, 3));
+        c1 = _mm_set1_epi32((int)event->beat);
+        c2 = _mm_set1_epi32((int)event->loop);
+        c3 = _mm_set1_epi32((int)event->play);
+        k0 = event->key[0];
+        k1 = event->key[1];
+        for (round = 0; round < PHILOX_ROUNDS; round++) {
+            mulhilo_sse2(c0, PHILOX_M0, &lo0, &hi0);
+            mulhilo_sse2(c2, PHILOX_M1, &lo1, &hi1);
+            c0 = _mm_xor_si128(_mm_xor_si128(hi1, c1), _mm_set1_epi32((int)k0));
+            c1 = lo1;
+            c2 = _mm_xor_si128(_mm_xor_si128(hi0, c3), _mm_set1_epi32((int)k1));
+            c3 = lo0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        /* Lane b of word w goes to out[4 * b + w]: a 4x4 transpose*/
+        w0 = to_sample_sse2(c0);
+        w1 = to_sample_sse2(c1);
+        w2 = to_sample_sse2(c2);
+        w3 = to_sample_sse2(c3);
+        t0 = _mm_unpacklo_ps(w0, w1);
+        t1 = _mm_unpackhi_ps(w0, w1);
+        t2 = _mm_unpacklo_ps(w2, w3);
+        t3 = _mm_unpackhi_ps(w2, w3);
+        _mm_storeu_ps(out + 4 * block, _mm_movelh_ps(t0, t2));
+        _mm_storeu_ps(out + 4 * block + 4, _mm_movehl_ps(t2, t0));
+        _mm_storeu_ps(out + 4 * block + 8, _mm_movelh_ps(t1, t3));
+        _mm_storeu_ps(out + 4 * block + 12, _mm_movehl_ps(t3, t1));
+    }
+    return block;
+}
+
+/* AVX2: 8 blocks per iteration*/
+
+__attribute__((target("avx2")))
+static void mulhilo_avx2(__m256i x, uint32_t m, __m256i *lo, __m256i *hi) {
+    __m256i even, odd;
+
+    even = _mm256_mul_epu32(x, _mm256_set1_epi32((int)m));
+    odd = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), _mm256_set1_epi32((int)m));
+    *lo = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+    *hi = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+__attribute__((target("avx2")))
+static __m256 to_sample_avx2(__m256i x) {
+    return _mm256_sub_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), _mm256_set1_ps(TO_SAMPLE_SCALE)),
+                         _mm256_set1_ps(1.0f));
+}
+
+__attribute__((target("avx2")))
+static int blocks_avx2(const NoiseEvent *event, uint32_t first, int count, float *out) {
+    __m256i c0, c1, c2, c3, lo0, hi0, lo1, hi1;
+    __m256 w0, w1, w2, w3, t0, t1, t2, t3, u0, u1, u2, u3;
+    uint32_t k0, k1;
+    int block, round;
+
+    for (block = 0; block + 8 <= count; block += 8) {
+        c0 = _mm256_add_epi32(_mm256_set1_epi32((int)(first + (uint32_t)block)),
+                              _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        c1 = _mm256_set1_epi32((int)event->beat);
+        c2 = _mm256_set1_epi32((int)event->loop);
+        c3 = _mm256_set1_epi32((int)event->play);
+        k0 = event->key[0];
+        k1 = event->key[1];
+        for (round = 0; round < PHILOX_ROUNDS; round++) {
+            mulhilo_avx2(c0, PHILOX_M0, &lo0, &hi0);
+            mulhilo_avx2(c2, PHILOX_M1, &lo1, &hi1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(hi1, c1), _mm256_set1_epi32((int)k0));
+            c1 = lo1;
+            c2 = _mm256_xor_si256(_mm256_xor_si256(hi0, c3), _mm256_set1_epi32((int)k1));
+            c3 = lo0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        /* The 4x4 transpose of each 128-bit half, then the halves put in block order*/
+        w0 = to_sample_avx2(c0);
+        w1 = to_sample_avx2(c1);
+        w2 = to_sample_avx2(c2);
+        w3 = to_sample_avx2(c3);
+        t0 = _mm256_unpacklo_ps(w0, w1);
+        t1 = _mm256_unpackhi_ps(w0, w1);
+        t2 = _mm256_unpacklo_ps(w2, w3);
+        t3 = _mm256_unpackhi_ps(w2, w3);
+        u0 = _mm256_shuffle_ps(t0, t2, 0x44); /* Blocks 0 and 4*/
+        u1 = _mm256_shuffle_ps(t0, t2, 0xEE); /* 1 and 5*/
+        u2 = _mm256_shuffle_ps(t1, t3, 0x44); /* 2 and 6*/
+        u3 = _mm256_shuffle_ps(t1, t3, 0xEE); /* 3 and 7*/
+        _mm256_storeu_ps(out + 4 * block, _mm256_permute2f128_ps(u0, u1, 0x20));
+        _mm256_storeu_ps(out + 4 * block + 8, _mm256_permute2f128_ps(u2, u3, 0x20));
+        _mm256_storeu_ps(out + 4 * block + 16, _mm256_permute2f128_ps(u0, u1, 0x31));
+        _mm256_storeu_ps(out + 4 * block + 24, _mm256_permute2f128_ps(u2, u3, 0x31));
+    }
+    return block;
+}
+#endif
+
+/* Whole blocks, as many as the active SIMD set takes at once, then the rest one at a time*/
+static void fill_blocks(const NoiseEvent *event, uint32_t first, int count, float *out) {
+    int done;
+
+    done = 0;
+#ifdef NOISE_X86
+    switch (osc_active_isa()) {
+        case OSC_ISA_AVX512:
+        case OSC_ISA_AVX2: done = blocks_avx2(event, first, count, out); break;
+        case OSC_ISA_SSE2: done = blocks_sse2(event, first, count, out); break;
+        default:           break;
+    }
+#endif
+    blocks_scalar(event, first + (uint32_t)done, count - done, out + 4 * done);
+}
+
+void noise_event_init(NoiseEvent *event, unsigned long song_key, uint32_t play, uint32_t loop, uint32_t beat) {
+    event->key[0] = (uint32_t)(song_key & 0xFFFFFFFFUL);
+    event->key[1] = (uint32_t)((song_key >> 16) >> 16); /* Two shifts: unsigned long may have 32 bits*/
+    event->play = play;
+    event->loop = loop;
+    event->beat = beat;
+}
+
+void noise_set_song_seed(unsigned long seed) {
+    song_seed = seed;
+}
+
+unsigned long noise_song_seed(void) {
+    return song_seed;
+}
+
+unsigned long noise_song_key(unsigned long seed, uint32_t song_hash) {
+    uint32_t hash;
+
+    /* The murmur3 finalizer, so songs whose hashes differ in a bit differ in every bit of the key*/
+    hash = song_hash;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return seed ^ (unsigned long)hash;
+}
+
+void noise_stream_init(NoiseStream *stream, const NoiseEvent *event) {
+    stream->event = *event;
+    stream->block = 0;
+    stream->used = 4;
+}
+
+void noise_fill(NoiseStream *stream, float *out, int count) {
+    int blocks;
+
+    /* What is left of the pending block*/
+    while (count > 0 && stream->used < 4) {
+        *out++ = stream->pending[stream->used++];
+        count--;
+    }
+    blocks = count / 4;
+    if (blocks > 0) {
+        fill_blocks(&stream->event, stream->block, blocks, out);
+        stream->block += (uint32_t)blocks;
+        out += 4 * blocks;
+        count -= 4 * blocks;
+    }
+    if (count > 0) {
+        blocks_scalar(&stream->event, stream->block++, 1, stream->pending);
+        memcpy(out, stream->pending, (size_t)count * sizeof(float));
+        stream->used = count;
+    }
+}
+
+void noise_fill_q15(NoiseStream *stream, int16_t *out, int count) {
+    int blocks;
+
+    while (count > 0 && stream->used < 4) {
+        *out++ = stream->pending_q15[stream->used++];
+        count--;
+    }
+    blocks = count / 4;
+    if (blocks > 0) {
+        blocks_q15(&stream->event, stream->block, blocks, out);
+        stream->block += (uint32_t)blocks;
+        out += 4 * blocks;
+        count -= 4 * blocks;
+    }
+    if (count > 0) {
+        blocks_q15(&stream->event, stream->block++, 1, stream->pending_q15);
+        memcpy(out, stream->pending_q15, (size_t)count * sizeof(int16_t));
+        stream->used = count;
+    }
+}
+
+float noise_next(NoiseStream *stream) {
+    if (stream->used == 4) {
+        blocks_scalar(&stream->event, stream->block++, 1, stream->pending);
+        stream->used = 0;
+    }
+    return stream->pending[stream->used++];
+}
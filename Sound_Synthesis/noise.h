@@ -0,0 +1,56 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <stdint.h>
+
+/* Counter-based white noise (Philox4x32-10, Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3").
+
+ Noise is a pure function of the sound event it belongs to and the sample index within it: sample j of an event
+ is word j % 4 of Philox applied to the counter (j / 4, beat, loop, play) under the song's key, which mixes the
+ --seed with a hash of the song (noise_song_key), so two songs differ at the same play, loop and beat.
+ There is no shared state, so hits can be rendered in any order, on any thread, or reused from an earlier render,
+ and always come out the same. Samples are uniform on [-1, 1) in steps of 2^-23, converted exactly, so the
+ scalar and the SIMD fills give identical results.*/
+
+/* Identifies one sound event: the hit at beat of the loop-th repetition of the play-th PLAY command*/
+typedef struct {
+    uint32_t key[2];   /* The song's key*/
+    uint32_t play;
+    uint32_t loop;
+    uint32_t beat;
+} NoiseEvent;
+
+/* The noise of one event, read in order*/
+typedef struct {
+    NoiseEvent event;
+    uint32_t block;    /* Next block of 4 samples to generate*/
+    float pending[4];  /* The last block generated*/
+    int16_t pending_q15[4]; /* The same, for noise_fill_q15*/
+    int used;          /* Samples of pending already read*/
+} NoiseStream;
+
+void noise_event_init(NoiseEvent *event, unsigned long song_key, uint32_t play, uint32_t loop, uint32_t beat);
+
+/* Seed the renderer gives every song (0 until set)*/
+void noise_set_song_seed(unsigned long seed);
+unsigned long noise_song_seed(void);
+
+/* Key of the noise of the song of song_hash (song_ir_hash) with seed: a different one for every song and seed*/
+unsigned long noise_song_key(unsigned long seed, uint32_t song_hash);
+
+/* Starts at the first sample of event*/
+void noise_stream_init(NoiseStream *stream, const NoiseEvent *event);
+
+/* Writes the next count samples of stream to out[0 .. count), whole blocks at a time with the SIMD set
+ osc_active_isa() names*/
+void noise_fill(NoiseStream *stream, float *out, int count);
+
+/* Writes the next count samples of stream to out[0 .. count) in Q15, each the float sample rounded down to a
+ multiple of 2^-15, with integer arithmetic only. A stream is read either with this or with noise_fill and
+ noise_next, not both.*/
+void noise_fill_q15(NoiseStream *stream, int16_t *out, int count);
+
+/* The next sample of stream*/
+float noise_next(NoiseStream *stream);
+
+#endif /* NOISE_H*/
@@ -0,0 +1,303 @@
+#include "oscBank.h"
+#include "oscillators.h" /* For osc_active_isa*/
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OSC_BANK_X86 1
+#include <immintrin.h>
+#endif
+
+#define PI 3.14159265358979323846
+
+void osc_bank_init(OscBank *bank, const float *frequencies, const float *amplitudes, int num_partials,
+                   float sample_rate) {
+    double w;
+    int n;
+    int k;
+
+    n = 0;
+    for (k = 0; k < num_partials && n < OSC_BANK_MAX_PARTIALS; k++) {
+        if (frequencies[k] <= 0.0f || frequencies[k] >= 0.5f * sample_rate) continue;
+        w = 2.0 * PI * frequencies[k] / sample_rate;
+        bank->step[n] = w;
+        bank->coeff[n] = (float)(2.0 * cos(w * OSC_BANK_LANES));
+        bank->amplitude[n] = amplitudes[k];
+        bank->cos_step[n] = cos(w);
+        bank->sin_step[n] = sin(w);
+        bank->cos_run[n] = cos(w * OSC_BANK_RESYNC);
+        bank->sin_run[n] = sin(w * OSC_BANK_RESYNC);
+        bank->cos_phase[n] = 1.0;
+        bank->sin_phase[n] = 0.0;
+        n++;
+    }
+    bank->num_partials = n;
+    bank->chunk_used = OSC_BANK_CHUNK;
+    bank->position = 0;
+}
+
+/* Sets every partial to its exact samples around the current position (a multiple of OSC_BANK_RESYNC), then moves
+ the phases on to the next resync. The rotations go a sample at a time, every partial in each step, so the partials'
+ chains of dependent multiplies run side by side.*/
+static void resync(OscBank *bank) {
+    double c[OSC_BANK_MAX_PARTIALS];
+    double s[OSC_BANK_MAX_PARTIALS];
+    double t;
+    int j;
+    int k;
+
+    /* The phases OSC_BANK_LANES samples back*/
+    for (k = 0; k < bank->num_partials; k++) {
+        c[k] = bank->cos_phase[k];
+        s[k] = bank->sin_phase[k];
+    }
+    for (j = 0; j < OSC_BANK_LANES; j++) {
+        for (k = 0; k < bank->num_partials; k++) {
+            t = c[k] * bank->cos_step[k] + s[k] * bank->sin_step[k];
+            s[k] = s[k] * bank->cos_step[k] - c[k] * bank->sin_step[k];
+            c[k] = t;
+        }
+    }
+    /* Then rotated forward through the 2 OSC_BANK_LANES samples of the state*/
+    for (j = 0; j < 2 * OSC_BANK_LANES; j++) {
+        for (k = 0; k < bank->num_partials; k++) {
+            if (j < OSC_BANK_LANES) {
+                bank->y1[k][j] = (float)(bank->amplitude[k] * s[k]);
+            } else {
+                bank->y0[k][j - OSC_BANK_LANES] = (float)(bank->amplitude[k] * s[k]);
+            }
+            t = c[k] * bank->cos_step[k] - s[k] * bank->sin_step[k];
+            s[k] = s[k] * bank->cos_step[k] + c[k] * bank->sin_step[k];
+            c[k] = t;
+        }
+    }
+    for (k = 0; k < bank->num_partials; k++) {
+        t = bank->cos_phase[k] * bank->cos_run[k] - bank->sin_phase[k] * bank->sin_run[k];
+        bank->sin_phase[k] = bank->sin_phase[k] * bank->cos_run[k] + bank->cos_phase[k] * bank->sin_run[k];
+        bank->cos_phase[k] = t;
+    }
+}
+
+/* Adds every partial to out, OSC_BANK_LANES samples per step for steps steps: the reference the vector versions
+ match*/
+static void partials_scalar(OscBank *bank, float *out, int steps) {
+    float a, b, c, y;
+    int k, j, s;
+
+    for (k = 0; k < bank->num_partials; k++) {
+        c = bank->coeff[k];
+        for (j = 0; j < OSC_BANK_LANES; j++) {
+            a = bank->y0[k][j];
+            b = bank->y1[k][j];
+            for (s = 0; s < steps; s++) {
+                out[s * OSC_BANK_LANES + j] += a;
+                y = c * a - b;
+                b = a;
+                a = y;
+            }
+            bank->y0[k][j] = a;
+            bank->y1[k][j] = b;
+        }
+    }
+}
+
+#ifdef OSC_BANK_X86
+/* OSC_BANK_LANES samples as four vectors*/
+__attribute__((target("sse2")))
+static void partials_sse2(OscBank *bank, float *out, int steps) {
+    __m128 c, y;
+    __m128 a[OSC_BANK_LANES / 4];
+    __m128 b[OSC_BANK_LANES / 4];
+    float *o;
+    int k, j, s;
+
+    for (k = 0; k < bank->num_partials; k++) {
+        c = _mm_set1_ps(bank->coeff[k]);
+        for (j = 0; j < OSC_BANK_LANES / 4; j++) {
+            a[j] = _mm_loadu_ps(bank->y0[k] + 4 * j);
+            b[j] = _mm_loadu_ps(bank->y1[k] + 4 * j);
+        }
+        for (s = 0, o = out; s < steps; s++, o += OSC_BANK_LANES) {
+            for (j = 0; j < OSC_BANK_LANES / 4; j++) {
+                _mm_storeu_ps(o + 4 * j, _mm_add_ps(_mm_loadu_ps(o + 4 * j), a[j]));
+                y = _mm_sub_ps(_mm_mul_ps(c, a[j]), b[j]);
+                b[j] = a[j];
+                a[j] = y;
+            }
+        }
+        for (j = 0; j < OSC_BANK_LANES / 4; j++) {
+            _mm_storeu_ps(bank->y0[k] + 4 * j, a[j]);
+            _mm_storeu_ps(bank->y1[k] + 4 * j, b[j]);
+        }
+    }
+}
+
+/* OSC_BANK_LANES samples as two vectors. Two partials at a time are added to the output while it is in registers
+ (in partial order, as one at a time would).*/
+__attribute__((target("avx2")))
+static void partials_avx2(OscBank *bank, float *out, int steps) {
+    __m256 c, d, a0, a1, b0, b1, e0, e1, f0, f1, y0, y1, sum0, sum1;
+    float *o;
+    int k, s;
+
+    for (k = 0; k + 1 < bank->num_partials; k += 2) {
+        c = _mm256_set1_ps(bank->coeff[k]);
+        d = _mm256_set1_ps(bank->coeff[k + 1]);
+        a0 = _mm256_loadu_ps(bank->y0[k]);
+        a1 = _mm256_loadu_ps(bank->y0[k] + 8);
+        b0 = _mm256_loadu_ps(bank->y1[k]);
+        b1 = _mm256_loadu_ps(bank->y1[k] + 8);
+        e0 = _mm256_loadu_ps(bank->y0[k + 1]);
+        e1 = _mm256_loadu_ps(bank->y0[k + 1] + 8);
+        f0 = _mm256_loadu_ps(bank->y1[k + 1]);
+        f1 = _mm256_loadu_ps(bank->y1[k + 1] + 8);
+        for (s = 0, o = out; s < steps; s++, o += OSC_BANK_LANES) {
+            sum0 = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(o), a0), e0);
+            sum1 = _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(o + 8), a1), e1);
+            _mm256_storeu_ps(o, sum0);
+            _mm256_storeu_ps(o + 8, sum1);
+            y0 = _mm256_sub_ps(_mm256_mul_ps(c, a0), b0);
+            y1 = _mm256_sub_ps(_mm256_mul_ps(c, a1), b1);
+            b0 = a0;
+            b1 = a1;
+            a0 = y0;
+            a1 = y1;
+            y0 = _mm256_sub_ps(_mm256_mul_ps(d, e0), f0);
+            y1 = _mm256_sub_ps(_mm256_mul_ps(d, e1), f1);
+            f0 = e0;
+            f1 = e1;
+            e0 = y0;
+            e1 = y1;
+        }
+        _mm256_storeu_ps(bank->y0[k], a0);
+        _mm256_storeu_ps(bank->y0[k] + 8, a1);
+        _mm256_storeu_ps(bank->y1[k], b0);
+        _mm256_storeu_ps(bank->y1[k] + 8, b1);
+        _mm256_storeu_ps(bank->y0[k + 1], e0);
+        _mm256_storeu_ps(bank->y0[k + 1] + 8, e1);
+        _mm256_storeu_ps(bank->y1[k + 1], f0);
+        _mm256_storeu_ps(bank->y1[k + 1] + 8, f1);
+    }
+    for (; k < bank->num_partials; k++) {
+        c = _mm256_set1_ps(bank->coeff[k]);
+        a0 = _mm256_loadu_ps(bank->y0[k]);
+        a1 = _mm256_loadu_ps(bank->y0[k] + 8);
+        b0 = _mm256_loadu_ps(bank->y1[k]);
+        b1 = _mm256_loadu_ps(bank->y1[k] + 8);
+        for (s = 0, o = out; s < steps; s++, o += OSC_BANK_LANES) {
+            _mm256_storeu_ps(o, _mm256_add_ps(_mm256_loadu_ps(o), a0));
+            _mm256_storeu_ps(o + 8, _mm256_add_ps(_mm256_loadu_ps(o + 8), a1));
+            y0 = _mm256_sub_ps(_mm256_mul_ps(c, a0), b0);
+            y1 = _mm256_sub_ps(_mm256_mul_ps(c, a1), b1);
+            b0 = a0;
+            b1 = a1;
+            a0 = y0;
+            a1 = y1;
+        }
+        _mm256_storeu_ps(bank->y0[k], a0);
+        _mm256_storeu_ps(bank->y0[k] + 8, a1);
+        _mm256_storeu_ps(bank->y1[k], b0);
+        _mm256_storeu_ps(bank->y1[k] + 8, b1);
+    }
+}
+
+/* OSC_BANK_LANES samples as one vector, two partials at a time added to the output in registers*/
+__attribute__((target("avx512f")))
+static void partials_avx512(OscBank *bank, float *out, int steps) {
+    __m512 c, d, a, b, e, f, y;
+    float *o;
+    int k, s;
+
+    for (k = 0; k + 1 < bank->num_partials; k += 2) {
+        c = _mm512_set1_ps(bank->coeff[k]);
+        d = _mm512_set1_ps(bank->coeff[k + 1]);
+        a = _mm512_loadu_ps(bank->y0[k]);
+        b = _mm512_loadu_ps(bank->y1[k]);
+        e = _mm512_loadu_ps(bank->y0[k + 1]);
+        f = _mm512_loadu_ps(bank->y1[k + 1]);
+        for (s = 0, o = out; s < steps; s++, o += OSC_BANK_LANES) {
+            _mm512_storeu_ps(o, _mm512_add_ps(_mm512_add_ps(_mm512_loadu_ps(o), a), e));
+            y = _mm512_sub_ps(_mm512_mul_ps(c, a), b);
+            b = a;
+            a = y;
+            y = _mm512_sub_ps(_mm512_mul_ps(d, e), f);
+            f = e;
+            e = y;
+        }
+        _mm512_storeu_ps(bank->y0[k], a);
+        _mm512_storeu_ps(bank->y1[k], b);
+        _mm512_storeu_ps(bank->y0[k + 1], e);
+        _mm512_storeu_ps(bank->y1[k + 1], f);
+    }
+    for (; k < bank->num_partials; k++) {
+        c = _mm512_set1_ps(bank->coeff[k]);
+        a = _mm512_loadu_ps(bank->y0[k]);
+        b = _mm512_loadu_ps(bank->y1[k]);
+        for (s = 0, o = out; s < steps; s++, o += OSC_BANK_LANES) {
+            _mm512_storeu_ps(o, _mm512_add_ps(_mm512_loadu_ps(o), a));
+            y = _mm512_sub_ps(_mm512_mul_ps(c, a), b);
+            b = a;
+            a = y;
+        }
+        _mm512_storeu_ps(bank->y0[k], a);
+        _mm512_storeu_ps(bank->y1[k], b);
+    }
+}
+#endif
+
+/* Makes the next OSC_BANK_CHUNK samples of the sum in bank->chunk*/
+static void make_chunk(OscBank *bank) {
+    OscIsa isa;
+    int i;
+
+    if (bank->position % OSC_BANK_RESYNC == 0) resync(bank);
+    for (i = 0; i < OSC_BANK_CHUNK; i++) {
+        bank->chunk[i] = 0.0f;
+    }
+    isa = osc_active_isa();
+#ifdef OSC_BANK_X86
+    if (isa == OSC_ISA_AVX512) {
+        partials_avx512(bank, bank->chunk, OSC_BANK_CHUNK / OSC_BANK_LANES);
+    } else if (isa == OSC_ISA_AVX2) {
+        partials_avx2(bank, bank->chunk, OSC_BANK_CHUNK / OSC_BANK_LANES);
+    } else if (isa == OSC_ISA_SSE2) {
+        partials_sse2(bank, bank->chunk, OSC_BANK_CHUNK / OSC_BANK_LANES);
+    } else
+#endif
+    {
+        partials_scalar(bank, bank->chunk, OSC_BANK_CHUNK / OSC_BANK_LANES);
+    }
+    (void)isa;
+    bank->position += OSC_BANK_CHUNK;
+    bank->chunk_used = 0;
+}
+
+void osc_bank_fill(OscBank *bank, float *out, int count) {
+    int n;
+    int i;
+
+    while (count > 0) {
+        if (bank->chunk_used == OSC_BANK_CHUNK) make_chunk(bank);
+        n = OSC_BANK_CHUNK - bank->chunk_used;
+        if (n > count) n = count;
+        for (i = 0; i < n; i++) {
+            out[i] = bank->chunk[bank->chunk_used + i];
+        }
+        bank->chunk_used += n;
+        out += n;
+        count -= n;
+    }
+}
+
+void osc_bank_fill_sin(OscBank *bank, float *out, int count) {
+    float sample;
+    int i;
+    int k;
+
+    for (i = 0; i < count; i++, bank->position++) {
+        sample = 0.0f;
+        for (k = 0; k < bank->num_partials; k++) {
+            sample += (float)(bank->amplitude[k] * sin(bank->step[k] * bank->position));
+        }
+        out[i] = sample;
+    }
+}
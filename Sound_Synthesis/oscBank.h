@@ -0,0 +1,59 @@
+#ifndef OSCBANK_H
+#define OSCBANK_H
+
+/* Additive oscillator banks: up to OSC_BANK_MAX_PARTIALS sines of their own frequency and amplitude, summed (the
+ piano notes and chords of voice.c).
+
+ No sine is evaluated per sample. A sine of w radians per sample obeys the second-order recurrence
+   y[n + L] = 2 cos(L w) y[n] - y[n - L]
+ for any L, so each partial keeps its last 2 L samples and makes the next L with one multiply and one subtract each.
+ With L = OSC_BANK_LANES those L samples are one AVX-512 vector (two AVX2 ones, four SSE2 ones): a partial advances a
+ vector at a time, and the partials are summed into the output with plain vector adds, in partial order. Every set
+ does the same float operations in the same order (no fused multiply-add), so the output is bit-identical whatever
+ the set osc_active_isa() names.
+
+ The recurrence runs in float, where rounding makes it drift in amplitude and phase a little more every step, so
+ every OSC_BANK_RESYNC samples the state is set back from the exact phase, kept as a cos/sin pair in double and
+ advanced by a rotation of OSC_BANK_RESYNC steps. Against sin at every sample (osc_bank_fill_sin, the scalar
+ reference) the sum stays above OSC_BANK_MIN_SNR_DB.*/
+
+#define OSC_BANK_MAX_PARTIALS 32
+#define OSC_BANK_LANES 16
+
+/* Samples the bank makes at a time (a multiple of OSC_BANK_LANES), and between resyncs (a multiple of that)*/
+#define OSC_BANK_CHUNK 128
+#define OSC_BANK_RESYNC 1024
+
+/* Lowest signal-to-noise ratio, in dB, of osc_bank_fill against osc_bank_fill_sin*/
+#define OSC_BANK_MIN_SNR_DB 80.0
+
+typedef struct {
+    float coeff[OSC_BANK_MAX_PARTIALS];                   /* 2 cos(OSC_BANK_LANES w), w the radians per sample*/
+    float y0[OSC_BANK_MAX_PARTIALS][OSC_BANK_LANES];      /* The partial's next OSC_BANK_LANES samples*/
+    float y1[OSC_BANK_MAX_PARTIALS][OSC_BANK_LANES];      /* and the ones before them*/
+    float amplitude[OSC_BANK_MAX_PARTIALS];
+    double step[OSC_BANK_MAX_PARTIALS];                   /* w*/
+    double cos_step[OSC_BANK_MAX_PARTIALS];               /* Rotation by w*/
+    double sin_step[OSC_BANK_MAX_PARTIALS];
+    double cos_run[OSC_BANK_MAX_PARTIALS];                /* Rotation by OSC_BANK_RESYNC steps*/
+    double sin_run[OSC_BANK_MAX_PARTIALS];
+    double cos_phase[OSC_BANK_MAX_PARTIALS];              /* Exact phase at the next resync*/
+    double sin_phase[OSC_BANK_MAX_PARTIALS];
+    float chunk[OSC_BANK_CHUNK];                          /* The sum, OSC_BANK_CHUNK samples at a time*/
+    int chunk_used;                                       /* Samples of it handed out*/
+    int num_partials;
+    long position;                                        /* Samples made so far*/
+} OscBank;
+
+/* Starts num_partials sines at phase 0, partial k at frequencies[k] Hz with amplitude amplitudes[k]. Partials at or
+ above half the sample rate are left out (so the sum never aliases), as are those past OSC_BANK_MAX_PARTIALS.*/
+void osc_bank_init(OscBank *bank, const float *frequencies, const float *amplitudes, int num_partials,
+                   float sample_rate);
+
+/* Writes the next count samples of the sum to out and advances the bank past them*/
+void osc_bank_fill(OscBank *bank, float *out, int count);
+
+/* osc_bank_fill evaluating sin for every partial at every sample: the reference (--osc direct --isa scalar)*/
+void osc_bank_fill_sin(OscBank *bank, float *out, int count);
+
+#endif /* OSCBANK_H*/
@@ -0,0 +1,398 @@
+/* SIMD versions of the per-sample math of the oscillator kernels: sine and triangle, mixed and scaled by the
+ envelope. Each instruction set has its own copy of the two approximations, written with that set's intrinsics and
+ compiled with a target attribute, so the file builds with the default flags and the widest set the CPU has
+ is picked at run time.*/
+#define _POSIX_C_SOURCE 200112L /* For pthread_once with -ansi*/
+#include "oscillators.h"
+#include "soundwaves.h" /* For MAX_AMPLITUDE*/
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OSCILLATORS_X86 1
+#include <immintrin.h>
+#endif
+
+/* sin(r) = r + r^3 * (C3 + r^2 * (C5 + ...)) on [-pi/2, pi/2]: the Taylor series to r^13, which is within
+ 7e-10 of sin there, well below float rounding*/
+#define SIN_C3  -1.66666666666666666667e-1f
+#define SIN_C5   8.33333333333333333333e-3f
+#define SIN_C7  -1.98412698412698412698e-4f
+#define SIN_C9   2.75573192239858906526e-6f
+#define SIN_C11 -2.50521083854417187751e-8f
+#define SIN_C13  1.60590438368216145994e-10f
+
+/* pi = PI_A + PI_B + PI_C (Cody-Waite). PI_A and PI_B have 12 significant bits, so k * PI_A and k * PI_B
+ are exact for |k| < 4096 and the reduced argument only carries the rounding of the last step.*/
+#define PI_A  3.1416015625f
+#define PI_B -8.9071691036224365e-06f
+#define PI_C -1.7411031505432106e-09f
+#define INV_PI 0.318309886183790671538f
+#define INV_TWO_PI 0.159154943091895335769f
+
+typedef void (*ShapeBlock)(float *out, int count, const OscVoice *voice);
+
+#ifdef OSCILLATORS_X86
+/* SSE2: 4 samples per vector*/
+
+__attribute__((target("sse2")))
+static __m128 sin_sse2(__m128 x) {
+    __m128i k;
+    __m128 kf, r, r2, p;
+
+    k = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(INV_PI)));
+    kf = _mm_cvtepi32_ps(k);
+    r = _mm_sub_ps(x, _mm_mul_ps(kf, _mm_set1_ps(PI_A)));
+    r = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(PI_B)));
+    r = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(PI_C)));
+    r2 = _mm_mul_ps(r, r);
+    p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_C13), r2), _mm_set1_ps(SIN_C11));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(SIN_C9));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(SIN_C7));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(SIN_C5));
+    p = _mm_add_ps(_mm_mul_ps(p, r2), _mm_set1_ps(SIN_C3));
+    p = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), p));
+    /* sin(r + k pi) = (-1)^k sin(r): move the low bit of k into the sign*/
+    return _mm_xor_ps(p, _mm_castsi128_ps(_mm_slli_epi32(k, 31)));
+}
+
+__attribute__((target("sse2")))
+static __m128 triangle_sse2(__m128 x) {
+    __m128i k;
+    __m128 kf, r, f, sign;
+
+    k = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(INV_TWO_PI)));
+    kf = _mm_add_ps(_mm_cvtepi32_ps(k), _mm_cvtepi32_ps(k)); /* 2k: the period is 2 pi*/
+    r = _mm_sub_ps(x, _mm_mul_ps(kf, _mm_set1_ps(PI_A)));
+    r = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(PI_B)));
+    r = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(PI_C)));
+    sign = _mm_set1_ps(-0.0f);
+    f = _mm_andnot_ps(sign, _mm_mul_ps(r, _mm_set1_ps(INV_TWO_PI)));
+    f = _mm_sub_ps(_mm_mul_ps(f, _mm_set1_ps(4.0f)), _mm_set1_ps(2.0f));
+    return _mm_sub_ps(_mm_set1_ps(1.0f), _mm_andnot_ps(sign, f));
+}
+
+/* Samples i .. i + 3 of voice, scaled but not yet converted*/
+__attribute__((target("sse2")))
+static __m128 voice_sse2(const OscVoice *voice, int i) {
+    __m128 sample, term;
+    int have;
+
+    sample = _mm_setzero_ps();
+    have = 0;
+    if (voice->sine_phase) {
+        sample = _mm_mul_ps(sin_sse2(_mm_loadu_ps(voice->sine_phase + i)), _mm_set1_ps(voice->sine_weight));
+        have = 1;
+    }
+    if (voice->triangle_phase) {
+        term = _mm_mul_ps(triangle_sse2(_mm_loadu_ps(voice->triangle_phase + i)), _mm_set1_ps(voice->triangle_weight));
+        sample = have ? _mm_add_ps(sample, term) : term;
+        have = 1;
+    }
+    if (voice->noise) {
+        term = _mm_mul_ps(_mm_loadu_ps(voice->noise + i), _mm_set1_ps(voice->noise_weight));
+        sample = have ? _mm_add_ps(sample, term) : term;
+    }
+    sample = _mm_mul_ps(sample, _mm_loadu_ps(voice->envelope + i));
+    sample = _mm_mul_ps(sample, _mm_set1_ps((float)MAX_AMPLITUDE));
+    return _mm_mul_ps(sample, _mm_set1_ps(voice->gain));
+}
+
+__attribute__((target("sse2")))
+static void shape_sse2(float *out, int count, const OscVoice *voice) {
+    float tail[4];
+    __m128 sample;
+    int i;
+
+    for (i = 0; i < count; i += 4) {
+        sample = voice_sse2(voice, i);
+        if (i + 4 <= count) {
+            if (voice->accumulate) {
+                sample = _mm_add_ps(_mm_loadu_ps(out + i),
+                                    _mm_mul_ps(sample, _mm_set1_ps(voice->mix_gain)));
+            }
+            _mm_storeu_ps(out + i, sample);
+        } else {
+            memcpy(tail, out + i, (size_t)(count - i) * sizeof(float));
+            if (voice->accumulate) {
+                sample = _mm_add_ps(_mm_loadu_ps(tail),
+                                    _mm_mul_ps(sample, _mm_set1_ps(voice->mix_gain)));
+            }
+            _mm_storeu_ps(tail, sample);
+            memcpy(out + i, tail, (size_t)(count - i) * sizeof(float));
+        }
+    }
+}
+
+/* AVX2: 8 samples per vector. No FMA, so every step rounds like the SSE2 code.*/
+
+__attribute__((target("avx2")))
+static __m256 sin_avx2(__m256 x) {
+    __m256i k;
+    __m256 kf, r, r2, p;
+
+    k = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(INV_PI)));
+    kf = _mm256_cvtepi32_ps(k);
+    r = _mm256_sub_ps(x, _mm256_mul_ps(kf, _mm256_set1_ps(PI_A)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(kf, _mm256_set1_ps(PI_B)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(kf, _mm256_set1_ps(PI_C)));
+    r2 = _mm256_mul_ps(r, r);
+    p = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_C13), r2), _mm256_set1_ps(SIN_C11));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r2), _mm256_set1_ps(SIN_C9));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r2), _mm256_set1_ps(SIN_C7));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r2), _mm256_set1_ps(SIN_C5));
+    p = _mm256_add_ps(_mm256_mul_ps(p, r2), _mm256_set1_ps(SIN_C3));
+    p = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, r2), p));
+    return _mm256_xor_ps(p, _mm256_castsi256_ps(_mm256_slli_epi32(k, 31)));
+}
+
+__attribute__((target("avx2")))
+static __m256 triangle_avx2(__m256 x) {
+    __m256i k;
+    __m256 kf, r, f, sign;
+
+    k = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(INV_TWO_PI)));
+    kf = _mm256_add_ps(_mm256_cvtepi32_ps(k), _mm256_cvtepi32_ps(k));
+    r = _mm256_sub_ps(x, _mm256_mul_ps(kf, _mm256_set1_ps(PI_A)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(kf, _mm256_set1_ps(PI_B)));
+    r = _mm256_sub_ps(r, _mm256_mul_ps(kf, _mm256_set1_ps(PI_C)));
+    sign = _mm256_set1_ps(-0.0f);
+    f = _mm256_andnot_ps(sign, _mm256_mul_ps(r, _mm256_set1_ps(INV_TWO_PI)));
+    f = _mm256_sub_ps(_mm256_mul_ps(f, _mm256_set1_ps(4.0f)), _mm256_set1_ps(2.0f));
+    return _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_andnot_ps(sign, f));
+}
+
+__attribute__((target("avx2")))
+static __m256 voice_avx2(const OscVoice *voice, int i) {
+    __m256 sample, term;
+    int have;
+
+    sample = _mm256_setzero_ps();
+    have = 0;
+    if (voice->sine_phase) {
+        sample = _mm256_mul_ps(sin_avx2(_mm256_loadu_ps(voice->sine_phase + i)), _mm256_set1_ps(voice->sine_weight));
+        have = 1;
+    }
+    if (voice->triangle_phase) {
+        term = _mm256_mul_ps(triangle_avx2(_mm256_loadu_ps(voice->triangle_phase + i)),
+                             _mm256_set1_ps(voice->triangle_weight));
+        sample = have ? _mm256_add_ps(sample, term) : term;
+        have = 1;
+    }
+    if (voice->noise) {
+        term = _mm256_mul_ps(_mm256_loadu_ps(voice->noise + i), _mm256_set1_ps(voice->noise_weight));
+        sample = have ? _mm256_add_ps(sample, term) : term;
+    }
+    sample = _mm256_mul_ps(sample, _mm256_loadu_ps(voice->envelope + i));
+    sample = _mm256_mul_ps(sample, _mm256_set1_ps((float)MAX_AMPLITUDE));
+    return _mm256_mul_ps(sample, _mm256_set1_ps(voice->gain));
+}
+
+__attribute__((target("avx2")))
+static void shape_avx2(float *out, int count, const OscVoice *voice) {
+    float tail[8];
+    __m256 sample;
+    int i;
+
+    for (i = 0; i < count; i += 8) {
+        sample = voice_avx2(voice, i);
+        if (i + 8 <= count) {
+            if (voice->accumulate) {
+                sample = _mm256_add_ps(_mm256_loadu_ps(out + i),
+                                       _mm256_mul_ps(sample, _mm256_set1_ps(voice->mix_gain)));
+            }
+            _mm256_storeu_ps(out + i, sample);
+        } else {
+            memcpy(tail, out + i, (size_t)(count - i) * sizeof(float));
+            if (voice->accumulate) {
+                sample = _mm256_add_ps(_mm256_loadu_ps(tail),
+                                       _mm256_mul_ps(sample, _mm256_set1_ps(voice->mix_gain)));
+            }
+            _mm256_storeu_ps(tail, sample);
+            memcpy(out + i, tail, (size_t)(count - i) * sizeof(float));
+        }
+    }
+}
+
+/* AVX-512 (F only): 16 samples per vector*/
+
+__attribute__((target("avx512f")))
+static __m512 sin_avx512(__m512 x) {
+    __m512i k;
+    __m512 kf, r, r2, p;
+
+    k = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(INV_PI)));
+    kf = _mm512_cvtepi32_ps(k);
+    r = _mm512_sub_ps(x, _mm512_mul_ps(kf, _mm512_set1_ps(PI_A)));
+    r = _mm512_sub_ps(r, _mm512_mul_ps(kf, _mm512_set1_ps(PI_B)));
+    r = _mm512_sub_ps(r, _mm512_mul_ps(kf, _mm512_set1_ps(PI_C)));
+    r2 = _mm512_mul_ps(r, r);
+    p = _mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(SIN_C13), r2), _mm512_set1_ps(SIN_C11));
+    p = _mm512_add_ps(_mm512_mul_ps(p, r2), _mm512_set1_ps(SIN_C9));
+    p = _mm512_add_ps(_mm512_mul_ps(p, r2), _mm512_set1_ps(SIN_C7));
+    p = _mm512_add_ps(_mm512_mul_ps(p, r2), _mm512_set1_ps(SIN_C5));
+    p = _mm512_add_ps(_mm512_mul_ps(p, r2), _mm512_set1_ps(SIN_C3));
+    p = _mm512_add_ps(r, _mm512_mul_ps(_mm512_mul_ps(r, r2), p));
+    return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(p), _mm512_slli_epi32(k, 31)));
+}
+
+__attribute__((target("avx512f")))
+static __m512 triangle_avx512(__m512 x) {
+    __m512i k;
+    __m512 kf, r, f;
+
+    k = _mm512_cvtps_epi32(_mm512_mul_ps(x, _mm512_set1_ps(INV_TWO_PI)));
+    kf = _mm512_add_ps(_mm512_cvtepi32_ps(k), _mm512_cvtepi32_ps(k));
+    r = _mm512_sub_ps(x, _mm512_mul_ps(kf, _mm512_set1_ps(PI_A)));
+    r = _mm512_sub_ps(r, _mm512_mul_ps(kf, _mm512_set1_ps(PI_B)));
+    r = _mm512_sub_ps(r, _mm512_mul_ps(kf, _mm512_set1_ps(PI_C)));
+    f = _mm512_abs_ps(_mm512_mul_ps(r, _mm512_set1_ps(INV_TWO_PI)));
+    f = _mm512_sub_ps(_mm512_mul_ps(f, _mm512_set1_ps(4.0f)), _mm512_set1_ps(2.0f));
+    return _mm512_sub_ps(_mm512_set1_ps(1.0f), _mm512_abs_ps(f));
+}
+
+__attribute__((target("avx512f")))
+static __m512 voice_avx512(const OscVoice *voice, int i) {
+    __m512 sample, term;
+    int have;
+
+    sample = _mm512_setzero_ps();
+    have = 0;
+    if (voice->sine_phase) {
+        sample = _mm512_mul_ps(sin_avx512(_mm512_loadu_ps(voice->sine_phase + i)), _mm512_set1_ps(voice->sine_weight));
+        have = 1;
+    }
+    if (voice->triangle_phase) {
+        term = _mm512_mul_ps(triangle_avx512(_mm512_loadu_ps(voice->triangle_phase + i)),
+                             _mm512_set1_ps(voice->triangle_weight));
+        sample = have ? _mm512_add_ps(sample, term) : term;
+        have = 1;
+    }
+    if (voice->noise) {
+        term = _mm512_mul_ps(_mm512_loadu_ps(voice->noise + i), _mm512_set1_ps(voice->noise_weight));
+        sample = have ? _mm512_add_ps(sample, term) : term;
+    }
+    sample = _mm512_mul_ps(sample, _mm512_loadu_ps(voice->envelope + i));
+    sample = _mm512_mul_ps(sample, _mm512_set1_ps((float)MAX_AMPLITUDE));
+    return _mm512_mul_ps(sample, _mm512_set1_ps(voice->gain));
+}
+
+__attribute__((target("avx512f")))
+static void shape_avx512(float *out, int count, const OscVoice *voice) {
+    float tail[16];
+    __m512 sample;
+    int i;
+
+    for (i = 0; i < count; i += 16) {
+        sample = voice_avx512(voice, i);
+        if (i + 16 <= count) {
+            if (voice->accumulate) {
+                sample = _mm512_add_ps(_mm512_loadu_ps(out + i),
+                                       _mm512_mul_ps(sample, _mm512_set1_ps(voice->mix_gain)));
+            }
+            _mm512_storeu_ps(out + i, sample);
+        } else {
+            memcpy(tail, out + i, (size_t)(count - i) * sizeof(float));
+            if (voice->accumulate) {
+                sample = _mm512_add_ps(_mm512_loadu_ps(tail),
+                                       _mm512_mul_ps(sample, _mm512_set1_ps(voice->mix_gain)));
+            }
+            _mm512_storeu_ps(tail, sample);
+            memcpy(out + i, tail, (size_t)(count - i) * sizeof(float));
+        }
+    }
+}
+#endif
+
+/* -1 until osc_set_isa or the first osc_active_isa resolves it*/
+static int active_isa = -1;
+static ShapeBlock active_shape = NULL;
+#ifndef _WIN32
+static pthread_once_t isa_once = PTHREAD_ONCE_INIT;
+#endif
+#ifdef DJ_FIXED_POINT
+static OscEngine active_engine = OSC_ENGINE_FIXED; /* Built for CPUs without fast float math*/
+#else
+static OscEngine active_engine = OSC_ENGINE_WAVETABLE;
+#endif
+
+OscIsa osc_isa_resolve(OscIsa isa) {
+#ifdef OSCILLATORS_X86
+    if ((isa == OSC_ISA_AUTO || isa == OSC_ISA_AVX512) && __builtin_cpu_supports("avx512f")) {
+        return OSC_ISA_AVX512;
+    }
+    if ((isa == OSC_ISA_AUTO || isa == OSC_ISA_AVX512 || isa == OSC_ISA_AVX2) && __builtin_cpu_supports("avx2")) {
+        return OSC_ISA_AVX2;
+    }
+    if (isa != OSC_ISA_SCALAR && __builtin_cpu_supports("sse2")) {
+        return OSC_ISA_SSE2;
+    }
+#else
+    (void)isa;
+#endif
+    return OSC_ISA_SCALAR;
+}
+
+void osc_set_isa(OscIsa isa) {
+    isa = osc_isa_resolve(isa);
+    switch (isa) {
+#ifdef OSCILLATORS_X86
+        case OSC_ISA_AVX512: active_shape = shape_avx512; break;
+        case OSC_ISA_AVX2:   active_shape = shape_avx2; break;
+        case OSC_ISA_SSE2:   active_shape = shape_sse2; break;
+#endif
+        default:             active_shape = NULL; break;
+    }
+    active_isa = (int)isa;
+}
+
+/* Picks the widest set, unless osc_set_isa already chose one*/
+static void resolve_isa(void) {
+    if (active_isa < 0) {
+        osc_set_isa(OSC_ISA_AUTO);
+    }
+}
+
+OscIsa osc_active_isa(void) {
+    /* Render threads can be the first to ask (djc --batch --no-bank): pthread_once resolves the set once and
+     makes active_shape visible to every thread that returns from it*/
+#ifndef _WIN32
+    pthread_once(&isa_once, resolve_isa);
+#else
+    resolve_isa(); /* Windows builds render on one thread*/
+#endif
+    return (OscIsa)active_isa;
+}
+
+const char *osc_isa_name(OscIsa isa) {
+    switch (isa) {
+        case OSC_ISA_SCALAR: return "scalar";
+        case OSC_ISA_SSE2:   return "sse2";
+        case OSC_ISA_AVX2:   return "avx2";
+        case OSC_ISA_AVX512: return "avx512";
+        default:             return "auto";
+    }
+}
+
+void osc_set_engine(OscEngine engine) {
+    active_engine = engine;
+}
+
+OscEngine osc_active_engine(void) {
+    return active_engine;
+}
+
+const char *osc_engine_name(OscEngine engine) {
+    switch (engine) {
+        case OSC_ENGINE_WAVETABLE_CUBIC: return "wavetable-cubic";
+        case OSC_ENGINE_DIRECT:          return "direct";
+        case OSC_ENGINE_FIXED:           return "fixed";
+        default:                         return "wavetable";
+    }
+}
+
+void osc_shape(float *out, int count, const OscVoice *voice) {
+    active_shape(out, count, voice);
+}
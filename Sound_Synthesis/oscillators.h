@@ -0,0 +1,86 @@
+#ifndef OSCILLATORS_H
+#define OSCILLATORS_H
+
+#include <stdint.h>
+
+/* Vectorized sample shaping for the oscillator voices (boom, ding and floortom in voice.c).
+
+ The scalar loop of voice.c (process_reference) is the reference: it calls sin and fmod once per sample.
+ The SSE2, AVX2 and AVX-512 versions here replace those calls with polynomials, evaluated 4, 8 or 16
+ samples at a time, and are picked at startup from what cpuid reports. Error bounds against the double
+ precision functions, measured over 0 <= x < 12000 rad (the range reduction is exact up to 12867); voice.c wraps
+ a phase back into [0, 2 pi) when it reaches 12000, so hits of any length stay in that range:
+   sine      degree-13 odd polynomial after reduction to [-pi/2, pi/2]   |error| <= 1.3e-7
+   triangle  1 - |4|f| - 2| on the phase reduced to f in [-1/2, 1/2]    |error| <= 3.2e-7
+ so a sample, once the mix bus is converted to 16 bits, is at most 1 step away from the one the reference
+ computes (Driver/bench_kernels.py checks this on rendered songs). The envelope is computed by the caller
+ (envelope.h), the same for every set.*/
+
+/* Instruction sets of the shaping code. OSC_ISA_AUTO picks the widest one the CPU supports;
+ OSC_ISA_SCALAR runs the reference kernels.*/
+typedef enum {
+    OSC_ISA_AUTO = 0,
+    OSC_ISA_SCALAR,
+    OSC_ISA_SSE2,
+    OSC_ISA_AVX2,
+    OSC_ISA_AVX512
+} OscIsa;
+
+/* How the oscillator kernels make their waves. The wavetable engine (wavetable.h) is band-limited, so high
+ pitches do not alias; the direct engine evaluates sin and the naive triangle at every sample's phase.
+ The scalar direct engine is the reference the SIMD sets are tested against. The fixed engine renders every sound,
+ not just the oscillator ones, in integer arithmetic; it is the default of builds with -DDJ_FIXED_POINT.*/
+typedef enum {
+    OSC_ENGINE_WAVETABLE = 0,  /* Linear interpolation (the default)*/
+    OSC_ENGINE_WAVETABLE_CUBIC,
+    OSC_ENGINE_DIRECT,
+    OSC_ENGINE_FIXED           /* Integer phases, envelopes and noise for every sound (fixedPoint.h)*/
+} OscEngine;
+
+/* Phase, noise and envelope arrays passed to osc_shape are read in whole vectors: they need room for
+ count rounded up to a multiple of OSC_PAD*/
+#define OSC_PAD 16
+
+/* The sources of one oscillator sound. Sample i is
+   ((sine_weight * sin(sine_phase[i]) + triangle_weight * triangle(triangle_phase[i])) + noise_weight * noise[i])
+     * envelope[i] * MAX_AMPLITUDE * gain
+ the formula (and order of operations) of the reference kernels. A NULL source is left out.*/
+typedef struct {
+    const float *sine_phase;
+    const float *triangle_phase;
+    const float *noise;        /* Any samples the caller computed: white noise, or waves mixed by the wavetable engine*/
+    float sine_weight;
+    float triangle_weight;
+    float noise_weight;
+    const float *envelope;     /* Level of each sample*/
+    float gain;
+    int accumulate;            /* 0 stores the samples in out; 1 adds them to it, times mix_gain*/
+    float mix_gain;
+} OscVoice;
+
+/* Resolves isa to the one osc_shape would use: AUTO and unsupported sets fall back to the widest supported one*/
+OscIsa osc_isa_resolve(OscIsa isa);
+
+/* Selects the instruction set of every later kernel call (OSC_ISA_AUTO until called). Not synchronized: call it
+ before any render thread starts.*/
+void osc_set_isa(OscIsa isa);
+
+/* The instruction set in use, never OSC_ISA_AUTO. Safe from any thread, also when it is the first call.*/
+OscIsa osc_active_isa(void);
+
+/* "scalar", "sse2", "avx2", "avx512" ("auto" for OSC_ISA_AUTO)*/
+const char *osc_isa_name(OscIsa isa);
+
+/* Selects the engine of every later kernel call*/
+void osc_set_engine(OscEngine engine);
+
+OscEngine osc_active_engine(void);
+
+/* "wavetable", "wavetable-cubic", "direct", "fixed"*/
+const char *osc_engine_name(OscEngine engine);
+
+/* Writes samples 0 .. count - 1 of voice to out (or adds them, see OscVoice) with the active SIMD set.
+ Only valid while osc_active_isa() is not OSC_ISA_SCALAR.*/
+void osc_shape(float *out, int count, const OscVoice *voice);
+
+#endif /* OSCILLATORS_H*/
@@ -0,0 +1,229 @@
+#define _POSIX_C_SOURCE 200112L /* For pthreads with -ansi*/
+#include "sampleBank.h"
+#include "soundTable.h"
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#define SAMPLE_BANK_BUCKETS 256
+
+/* Play index of the noise events of variation slots, one no song reaches*/
+#define SLOT_PLAY 0xFFFFFFFFu
+
+struct SampleBankEntry {
+    int sound_id;
+    float frequency;
+    int length;
+    uint32_t slot;
+    SampleBankEntry *next;
+    float *samples;  /* length samples, allocated with the entry*/
+};
+
+static void bank_lock(SampleBank *bank) {
+#ifndef _WIN32
+    if (bank->lock) pthread_mutex_lock((pthread_mutex_t *)bank->lock);
+#else
+    (void)bank;
+#endif
+}
+
+static void bank_unlock(SampleBank *bank) {
+#ifndef _WIN32
+    if (bank->lock) pthread_mutex_unlock((pthread_mutex_t *)bank->lock);
+#else
+    (void)bank;
+#endif
+}
+
+/* Mixes the words of a key or event (the murmur3 finalizer after each one)*/
+static uint32_t mix(uint32_t hash, uint32_t word) {
+    hash ^= word;
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static uint32_t float_bits(float value) {
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static size_t bucket_of(int sound_id, float frequency, int length, uint32_t slot) {
+    uint32_t hash;
+
+    hash = mix(mix(mix(mix(0, (uint32_t)sound_id), float_bits(frequency)), (uint32_t)length), slot);
+    return hash % SAMPLE_BANK_BUCKETS;
+}
+
+/* The entry of the key, or NULL. Called with the lock held, or while no thread inserts.*/
+static SampleBankEntry *find(const SampleBank *bank, size_t bucket, int sound_id, float frequency, int length,
+                             uint32_t slot) {
+    SampleBankEntry *entry;
+
+    for (entry = bank->buckets[bucket]; entry; entry = entry->next) {
+        if (entry->sound_id == sound_id && entry->frequency == frequency && entry->length == length &&
+            entry->slot == slot) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+int sample_bank_init(SampleBank *bank, int variations) {
+    bank->buckets = (SampleBankEntry **)calloc(SAMPLE_BANK_BUCKETS, sizeof(SampleBankEntry *));
+    bank->lock = NULL;
+    bank->variations = variations > 0 ? variations : 0;
+    bank->num_entries = 0;
+    bank->bytes = 0;
+    bank->hits = 0;
+    bank->misses = 0;
+    bank->synthesized = 0;
+    if (!bank->buckets) {
+        return -1;
+    }
+#ifndef _WIN32
+    bank->lock = malloc(sizeof(pthread_mutex_t));
+    if (!bank->lock || pthread_mutex_init((pthread_mutex_t *)bank->lock, NULL) != 0) {
+        free(bank->lock);
+        free(bank->buckets);
+        bank->lock = NULL;
+        bank->buckets = NULL;
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+void sample_bank_release(SampleBank *bank) {
+    SampleBankEntry *entry;
+    SampleBankEntry *next;
+    size_t i;
+
+    if (bank->buckets) {
+        for (i = 0; i < SAMPLE_BANK_BUCKETS; i++) {
+            for (entry = bank->buckets[i]; entry; entry = next) {
+                next = entry->next;
+                free(entry);
+            }
+        }
+    }
+#ifndef _WIN32
+    if (bank->lock) pthread_mutex_destroy((pthread_mutex_t *)bank->lock);
+#endif
+    free(bank->lock);
+    free(bank->buckets);
+    bank->lock = NULL;
+    bank->buckets = NULL;
+}
+
+/* Slot of a hit of a noisy sound: its variations are spread over the song by a hash of the hit's place*/
+static uint32_t slot_of(const SampleBank *bank, const NoiseEvent *event) {
+    return mix(mix(mix(0, event->play), event->loop), event->beat) % (uint32_t)bank->variations;
+}
+
+/* Renders the entry of the key and inserts it, unless the bank holds it already. Returns -1 if out of memory.*/
+static int warm_entry(SampleBank *bank, int sound_id, const SoundParams *params, int length, uint32_t slot) {
+    SampleBankEntry *entry;
+    SampleBankEntry *found;
+    NoiseEvent event;
+    size_t bucket;
+
+    bucket = bucket_of(sound_id, params->frequency, length, slot);
+    bank_lock(bank);
+    found = find(bank, bucket, sound_id, params->frequency, length, slot);
+    bank_unlock(bank);
+    if (found) {
+        return 0;
+    }
+
+    /* Rendered outside the lock; if another thread got there first, its entry is kept*/
+    entry = (SampleBankEntry *)malloc(sizeof(SampleBankEntry) + (size_t)length * sizeof(float));
+    if (!entry) {
+        return -1;
+    }
+    entry->sound_id = sound_id;
+    entry->frequency = params->frequency;
+    entry->length = length;
+    entry->slot = slot;
+    entry->samples = (float *)(entry + 1);
+    /* The slot's own noise, the same whichever song renders it*/
+    noise_event_init(&event, noise_song_seed(), SLOT_PLAY, (uint32_t)sound_id, slot);
+    SOUND_TABLE[sound_id].kernel(entry->samples, length, params, &event);
+
+    bank_lock(bank);
+    found = find(bank, bucket, sound_id, params->frequency, length, slot);
+    if (!found) {
+        entry->next = bank->buckets[bucket];
+        bank->buckets[bucket] = entry;
+        bank->num_entries++;
+        bank->bytes += sizeof(SampleBankEntry) + (size_t)length * sizeof(float);
+        bank->misses++;
+    }
+    bank_unlock(bank);
+    if (found) {
+        free(entry);
+    }
+    return 0;
+}
+
+int sample_bank_warm_sound(SampleBank *bank, int sound_id, const SoundParams *params, int length) {
+    int slot;
+    int slots;
+
+    slots = SOUND_TABLE[sound_id].noisy ? bank->variations : 1;
+    for (slot = 0; slot < slots; slot++) {
+        if (warm_entry(bank, sound_id, params, length, (uint32_t)slot) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+const float *sample_bank_find(const SampleBank *bank, int sound_id, const SoundParams *params, int length,
+                              const NoiseEvent *event, SampleBankCounts *counts) {
+    const SampleBankEntry *entry;
+    uint32_t slot;
+
+    slot = 0;
+    if (SOUND_TABLE[sound_id].noisy) {
+        if (bank->variations == 0) {
+            counts->synthesized++;
+            return NULL;
+        }
+        slot = slot_of(bank, event);
+    }
+    entry = find(bank, bucket_of(sound_id, params->frequency, length, slot), sound_id, params->frequency, length,
+                 slot);
+    if (!entry) {
+        return NULL;
+    }
+    counts->hits++;
+    return entry->samples;
+}
+
+void sample_bank_add_counts(SampleBank *bank, const SampleBankCounts *counts) {
+    bank_lock(bank);
+    bank->hits += counts->hits;
+    bank->synthesized += counts->synthesized;
+    bank_unlock(bank);
+}
+
+int sample_bank_warm(SampleBank *bank) {
+    int id;
+
+    for (id = 0; id < NUM_SOUND_IDS; id++) {
+        if (sample_bank_warm_sound(bank, id, &SOUND_TABLE[id].params, SAMPLES_PER_BEAT) != 0) {
+            return -1;
+        }
+    }
+    /* Warm-up renders are not misses of any song*/
+    bank->misses = 0;
+    return 0;
+}
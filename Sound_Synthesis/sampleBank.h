@@ -0,0 +1,61 @@
+#ifndef SAMPLEBANK_H
+#define SAMPLEBANK_H
+
+#include <stdint.h>
+#include <stddef.h> /* For size_t*/
+#include "soundwaves.h" /* For SoundParams and NoiseEvent*/
+
+/* Rendered hits, so each distinct one is synthesized once per bank instead of once per beat.
+
+ An entry is keyed by (sound ID, frequency, length, variation slot). Deterministic sounds have one slot, so
+ every hit of BOOM at its frequency and a beat's length is the same entry. A noisy sound's hits all differ;
+ with variations > 0 they are spread over that many slots by a hash of the hit's place in the song, each slot
+ rendered with its own noise, so a song plays a fixed set of takes. With variations == 0 (the default) noisy
+ hits are not banked and the output is exactly the synthesized one.
+
+ Entries are rendered before a render starts, by sample_bank_warm_sound for the sounds of a song or sample_bank_warm
+ for all of them; the render then only looks them up, with sample_bank_find, which reads the bank without a lock and
+ counts into the caller's SampleBankCounts. Warming takes the bank's lock to insert, so renders on any number of
+ threads may share a bank as long as no thread warms it while another one looks up.*/
+
+typedef struct SampleBankEntry SampleBankEntry;
+
+typedef struct {
+    SampleBankEntry **buckets;
+    void *lock;          /* pthread_mutex_t, or NULL without pthreads*/
+    int variations;      /* Slots per noisy sound*/
+    size_t num_entries;
+    size_t bytes;        /* Samples and bookkeeping of all entries*/
+    unsigned long hits;
+    unsigned long misses;       /* Hits that rendered an entry*/
+    unsigned long synthesized;  /* Noisy hits rendered on their own (variations == 0)*/
+} SampleBank;
+
+/* return 0 on success, -1 on allocation error*/
+int sample_bank_init(SampleBank *bank, int variations);
+
+void sample_bank_release(SampleBank *bank);
+
+/* Lookups counted by one thread, added to the bank with sample_bank_add_counts once it is done*/
+typedef struct {
+    unsigned long hits;
+    unsigned long synthesized;
+} SampleBankCounts;
+
+/* Renders every slot of sound_id with params and length samples that the bank does not hold yet (none for a noisy
+ sound when the bank has no variations), counting each as a miss. return 0 on success, -1 on allocation error.*/
+int sample_bank_warm_sound(SampleBank *bank, int sound_id, const SoundParams *params, int length);
+
+/* The length samples of the hit of sound_id with params identified by event, if the bank holds them; NULL if the hit
+ must be synthesized on its own (noisy, with no variations, or never warmed). Takes no lock and writes only *counts.*/
+const float *sample_bank_find(const SampleBank *bank, int sound_id, const SoundParams *params, int length,
+                              const NoiseEvent *event, SampleBankCounts *counts);
+
+/* Adds the counts of one thread's lookups to the bank's*/
+void sample_bank_add_counts(SampleBank *bank, const SampleBankCounts *counts);
+
+/* Renders every sound of SOUND_TABLE at its default parameters and a beat's length, every slot of each,
+ so the renders sharing it find every hit there. return 0 on success, -1 on allocation error.*/
+int sample_bank_warm(SampleBank *bank);
+
+#endif /* SAMPLEBANK_H*/
@@ -0,0 +1,249 @@
+#include "songCodegen.h"
+#include "soundTable.h" /* For the kernel names and parameters*/
+#include "mixBus.h" /* For mix_active_output*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Writes text inside a C comment, breaking up any closing delimiter*/
+static void put_comment_text(FILE *fp, const char *text) {
+    for (; *text; text++) {
+        fputc(*text, fp);
+        if (*text == '*' && text[1] == '/') fputc(' ', fp);
+    }
+}
+
+/* Writes a float literal that reads back as exactly value. %#g keeps the point, so the f suffix is valid.*/
+static void put_float(FILE *fp, float value) {
+    fprintf(fp, "%#.9gf", (double)value);
+}
+
+static void emit_prologue(FILE *fp, const SongIR *ir, const char *source_name, unsigned long total_beats) {
+    fprintf(fp, "/* Generated by djc from ");
+    put_comment_text(fp, source_name ? source_name : "a compiled song");
+    fprintf(fp, ": %lu patterns, %lu play commands, %lu beats. Do not edit.\n",
+            (unsigned long)ir->header->num_patterns, (unsigned long)ir->header->num_plays, total_beats);
+    fprintf(fp, " Standalone renderer: gcc -O3 -ansi -DDJ_SONG_MAIN -I Sound_Synthesis song.c -o song -lm\n");
+    fprintf(fp, " Shared object:       gcc -O3 -ansi -fPIC -shared -I Sound_Synthesis song.c -o song.so -lm*/\n");
+    fprintf(fp, "#include <stdio.h>\n");
+    fprintf(fp, "#include <stdlib.h>\n");
+    fprintf(fp, "#include \"soundwaves.c\" /* The kernels, in this translation unit so they can be inlined*/\n");
+    fprintf(fp, "#include \"voice.c\"\n");
+    fprintf(fp, "#include \"fixedPoint.c\"\n");
+    fprintf(fp, "#include \"biquad.c\"\n");
+    fprintf(fp, "#include \"oscBank.c\"\n");
+    fprintf(fp, "#include \"oscillators.c\"\n");
+    fprintf(fp, "#include \"wavetable.c\"\n");
+    fprintf(fp, "#include \"envelope.c\"\n");
+    fprintf(fp, "#include \"noise.c\"\n");
+    fprintf(fp, "#include \"mixBus.c\"\n");
+    fprintf(fp, "#include \"soundTable.c\" /* For the parameters play() and the chords start from*/\n\n");
+    fprintf(fp, "#define DJ_SONG_SAMPLES ((size_t)%luUL * SAMPLES_PER_BEAT)\n", total_beats);
+    fprintf(fp, "#define DJ_SONG_KEY %luUL /* Noise key: djc --seed and the song's hash*/\n",
+            noise_song_key(noise_song_seed(), song_ir_hash(ir)));
+    fprintf(fp, "#define DJ_SONG_OUTPUT %s /* Conversion to PCM (djc --pcm)*/\n\n",
+            mix_active_output() == MIX_OUTPUT_LIMIT ? "MIX_OUTPUT_LIMIT" : "MIX_OUTPUT_CLIP");
+}
+
+/* An EnvelopeParams initializer*/
+static void put_envelope(FILE *fp, const EnvelopeParams *envelope) {
+    static const char *const shape_names[] = { "ENVELOPE_FLAT", "ENVELOPE_EXPONENTIAL", "ENVELOPE_ADSR" };
+
+    fprintf(fp, "{ %s, ", shape_names[envelope->shape]);
+    put_float(fp, envelope->start);
+    fprintf(fp, ", ");
+    put_float(fp, envelope->end);
+    fprintf(fp, ", ");
+    put_float(fp, envelope->attack);
+    fprintf(fp, ", ");
+    put_float(fp, envelope->decay);
+    fprintf(fp, ", ");
+    put_float(fp, envelope->release);
+    fprintf(fp, " }");
+}
+
+/* One constant SoundParams per sound the song uses, named after the sound*/
+static void emit_params(FILE *fp, const unsigned char *sound_used) {
+    const SoundEntry *sound;
+    int id;
+
+    for (id = 0; id < NUM_SOUND_IDS; id++) {
+        if (!sound_used[id] || id == SOUND_REST) continue;
+        sound = &SOUND_TABLE[id];
+        fprintf(fp, "static const SoundParams %s_PARAMS = { ", sound->name);
+        put_float(fp, sound->params.frequency);
+        fprintf(fp, ", ");
+        put_envelope(fp, &sound->params.pitch);
+        fprintf(fp, ", ");
+        put_envelope(fp, &sound->params.envelope);
+        fprintf(fp, ", ");
+        put_float(fp, sound->params.gain);
+        fprintf(fp, " };\n");
+    }
+    fprintf(fp, "\n");
+}
+
+/* static void pattern_<id>(float *out): one pass of the pattern, a direct kernel call per beat*/
+static void emit_pattern(FILE *fp, const SongIR *ir, uint32_t pattern_id) {
+    const SongIRPattern *pattern;
+    const SoundEntry *sound;
+    uint32_t i;
+    int id;
+
+    pattern = &ir->patterns[pattern_id];
+    fprintf(fp, "/* ");
+    put_comment_text(fp, song_ir_pattern_name(ir, pattern_id));
+    fprintf(fp, "*/\n");
+    fprintf(fp, "static void pattern_%lu(float *out, uint32_t play, uint32_t loop) {\n", (unsigned long)pattern_id);
+    fprintf(fp, "    NoiseEvent event;\n\n");
+    fprintf(fp, "    noise_event_init(&event, DJ_SONG_KEY, play, loop, 0);\n");
+    for (i = 0; i < pattern->num_sounds; i++) {
+        id = ir->sounds[pattern->first_sound + i];
+        if (id == SOUND_REST) {
+            fprintf(fp, "    /* Beat %lu: REST, the buffer is already silent*/\n", (unsigned long)i);
+            continue;
+        }
+        sound = &SOUND_TABLE[id];
+        fprintf(fp, "    event.beat = %luU;\n", (unsigned long)i);
+        fprintf(fp, "    %s(out + %luUL * SAMPLES_PER_BEAT, SAMPLES_PER_BEAT, &%s_PARAMS, &event);\n",
+                sound->kernel_name, (unsigned long)i, sound->name);
+    }
+    fprintf(fp, "    (void)out;\n");
+    fprintf(fp, "}\n\n");
+}
+
+/* dj_song_render: the play sequence, one statement per PLAY command*/
+static void emit_render(FILE *fp, const SongIR *ir) {
+    const SongIRPlay *play;
+    uint32_t num_sounds;
+    uint32_t i;
+
+    fprintf(fp, "size_t dj_song_num_samples(void) {\n");
+    fprintf(fp, "    return DJ_SONG_SAMPLES;\n");
+    fprintf(fp, "}\n\n");
+    fprintf(fp, "/* Renders the song into the mix bus out, which holds dj_song_num_samples() zeroed samples*/\n");
+    fprintf(fp, "void dj_song_render(float *out) {\n");
+    fprintf(fp, "    unsigned long loop;\n\n");
+    for (i = 0; i < ir->header->num_plays; i++) {
+        play = &ir->plays[i];
+        num_sounds = ir->patterns[play->pattern_id].num_sounds;
+        if (play->loop_count == 0 || num_sounds == 0) continue;
+        if (play->loop_count == 1) {
+            fprintf(fp, "    pattern_%lu(out, %luU, 0);\n", (unsigned long)play->pattern_id, (unsigned long)i);
+        } else {
+            fprintf(fp, "    for (loop = 0; loop < %luUL; loop++, out += %luUL * SAMPLES_PER_BEAT) "
+                    "pattern_%lu(out, %luU, (uint32_t)loop);\n", (unsigned long)play->loop_count,
+                    (unsigned long)num_sounds, (unsigned long)play->pattern_id, (unsigned long)i);
+            continue;
+        }
+        fprintf(fp, "    out += %luUL * SAMPLES_PER_BEAT;\n", (unsigned long)num_sounds);
+    }
+    fprintf(fp, "    (void)out;\n");
+    fprintf(fp, "    (void)loop;\n");
+    fprintf(fp, "}\n\n");
+}
+
+/* main for -DDJ_SONG_MAIN: renders the song once, converts the bus in place and writes it as 16-bit mono PCM,
+ like djc does*/
+static void emit_main(FILE *fp) {
+    fprintf(fp, "#ifdef DJ_SONG_MAIN\n");
+    fprintf(fp, "/* Little-endian field of the WAV header*/\n");
+    fprintf(fp, "static void put_le(FILE *fp, unsigned long value, int bytes) {\n");
+    fprintf(fp, "    for (; bytes > 0; bytes--, value >>= 8) fputc((int)(value & 0xff), fp);\n");
+    fprintf(fp, "}\n\n");
+    fprintf(fp, "int main(int argc, char *argv[]) {\n");
+    fprintf(fp, "    const char *output;\n");
+    fprintf(fp, "    float *bus;\n");
+    fprintf(fp, "    int16_t *buffer;\n");
+    fprintf(fp, "    unsigned long data_bytes;\n");
+    fprintf(fp, "    FILE *fp;\n");
+    fprintf(fp, "    int result;\n\n");
+    fprintf(fp, "    output = argc > 1 ? argv[1] : \"output.wav\";\n");
+    fprintf(fp, "    if (DJ_SONG_SAMPLES == 0) {\n");
+    fprintf(fp, "        fprintf(stderr, \"No beats to generate.\\n\");\n");
+    fprintf(fp, "        return 0;\n");
+    fprintf(fp, "    }\n");
+    fprintf(fp, "    bus = (float *)calloc(DJ_SONG_SAMPLES, sizeof(float));\n");
+    fprintf(fp, "    if (!bus) {\n");
+    fprintf(fp, "        fprintf(stderr, \"Buffer allocation failed.\\n\");\n");
+    fprintf(fp, "        return 1;\n");
+    fprintf(fp, "    }\n");
+    fprintf(fp, "    dj_song_render(bus);\n");
+    fprintf(fp, "    buffer = (int16_t *)bus;\n");
+    fprintf(fp, "    mix_bus_to_pcm(bus, buffer, DJ_SONG_SAMPLES, DJ_SONG_OUTPUT);\n\n");
+    fprintf(fp, "    fp = fopen(output, \"wb\");\n");
+    fprintf(fp, "    if (!fp) {\n");
+    fprintf(fp, "        perror(\"Error opening WAV file for writing\");\n");
+    fprintf(fp, "        free(buffer);\n");
+    fprintf(fp, "        return 1;\n");
+    fprintf(fp, "    }\n");
+    fprintf(fp, "    data_bytes = (unsigned long)DJ_SONG_SAMPLES * 2;\n");
+    fprintf(fp, "    fwrite(\"RIFF\", 1, 4, fp);\n");
+    fprintf(fp, "    put_le(fp, 36 + data_bytes, 4);\n");
+    fprintf(fp, "    fwrite(\"WAVEfmt \", 1, 8, fp);\n");
+    fprintf(fp, "    put_le(fp, 16, 4); /* PCM chunk size*/\n");
+    fprintf(fp, "    put_le(fp, 1, 2);  /* PCM*/\n");
+    fprintf(fp, "    put_le(fp, 1, 2);  /* Mono*/\n");
+    fprintf(fp, "    put_le(fp, SAMPLE_RATE, 4);\n");
+    fprintf(fp, "    put_le(fp, SAMPLE_RATE * 2, 4);\n");
+    fprintf(fp, "    put_le(fp, 2, 2);\n");
+    fprintf(fp, "    put_le(fp, BIT_DEPTH, 2);\n");
+    fprintf(fp, "    fwrite(\"data\", 1, 4, fp);\n");
+    fprintf(fp, "    put_le(fp, data_bytes, 4);\n");
+    fprintf(fp, "    result = fwrite(buffer, sizeof(int16_t), DJ_SONG_SAMPLES, fp) == DJ_SONG_SAMPLES ? 0 : 1;\n");
+    fprintf(fp, "    if (fclose(fp) != 0) result = 1;\n");
+    fprintf(fp, "    free(buffer);\n");
+    fprintf(fp, "    if (result != 0) fprintf(stderr, \"Error writing WAV data.\\n\");\n");
+    fprintf(fp, "    return result;\n");
+    fprintf(fp, "}\n");
+    fprintf(fp, "#endif /* DJ_SONG_MAIN*/\n");
+}
+
+int song_ir_emit_c(const SongIR *ir, const char *source_name, const char *filename) {
+    unsigned char *pattern_used;
+    unsigned char sound_used[NUM_SOUND_IDS];
+    const SongIRPattern *pattern;
+    unsigned long total_beats;
+    FILE *fp;
+    uint32_t i, j;
+    int result;
+
+    /* Only patterns that are played, and only the sounds they use, are emitted*/
+    pattern_used = (unsigned char *)calloc(ir->header->num_patterns + 1, 1);
+    if (!pattern_used) {
+        return -1;
+    }
+    memset(sound_used, 0, sizeof(sound_used));
+    total_beats = 0;
+    for (i = 0; i < ir->header->num_plays; i++) {
+        pattern = &ir->patterns[ir->plays[i].pattern_id];
+        total_beats += (unsigned long)ir->plays[i].loop_count * pattern->num_sounds;
+        if (ir->plays[i].loop_count == 0 || pattern_used[ir->plays[i].pattern_id]) continue;
+        pattern_used[ir->plays[i].pattern_id] = 1;
+        for (j = 0; j < pattern->num_sounds; j++) {
+            sound_used[ir->sounds[pattern->first_sound + j]] = 1;
+        }
+    }
+
+    fp = fopen(filename, "w");
+    if (!fp) {
+        perror("Error opening C output file");
+        free(pattern_used);
+        return -1;
+    }
+    emit_prologue(fp, ir, source_name, total_beats);
+    emit_params(fp, sound_used);
+    for (i = 0; i < ir->header->num_patterns; i++) {
+        if (pattern_used[i]) emit_pattern(fp, ir, i);
+    }
+    emit_render(fp, ir);
+    emit_main(fp);
+    free(pattern_used);
+
+    result = ferror(fp) ? -1 : 0;
+    if (fclose(fp) != 0) result = -1;
+    if (result != 0) {
+        fprintf(stderr, "Error writing C output file %s.\n", filename);
+    }
+    return result;
+}
@@ -0,0 +1,28 @@
+#ifndef SONGCODEGEN_H
+#define SONGCODEGEN_H
+
+#include "songIR.h" /* For SongIR*/
+
+/* Ahead-of-time backend: writes a song as a C translation unit that renders it with direct calls to the
+ generate_* kernels, so nothing is looked up or dispatched at render time.
+
+ Every used pattern becomes a static function calling its kernels on constant offsets with constant
+ SoundParams, and the play sequence is unrolled into one call (or one counted loop, for xN) per PLAY
+ command. The file includes soundwaves.c, so the kernels sit in the same translation unit and can be
+ inlined and vectorized. It exports
+
+   size_t dj_song_num_samples(void);
+   void dj_song_render(float *out);     out is a mix bus of dj_song_num_samples() zeroed samples
+
+ (mix_bus_to_pcm, also in the file, converts it to 16 bits) and, built with -DDJ_SONG_MAIN, a main that writes
+ the song to a WAV file. Compile it with -ansi (or
+ -ffp-contract=off) so the samples match the ones djc renders:
+
+   gcc -O3 -ansi -DDJ_SONG_MAIN -I Sound_Synthesis song.c -o song -lm && ./song out.wav
+   gcc -O3 -ansi -fPIC -shared -I Sound_Synthesis song.c -o song.so -lm*/
+
+/* Writes the C code of ir to filename. source_name (may be NULL) is only quoted in the header comment.
+ Returns 0 on success, -1 on file error.*/
+int song_ir_emit_c(const SongIR *ir, const char *source_name, const char *filename);
+
+#endif /* SONGCODEGEN_H*/
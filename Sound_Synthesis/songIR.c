@@ -0,0 +1,353 @@
+#define _POSIX_C_SOURCE 200112L /* For mmap with -ansi*/
+#include "songIR.h"
+#include "soundTable.h" /* For NUM_SOUND_IDS*/
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define ALIGN4(n) (((n) + 3u) & ~(size_t)3u)
+
+/* Checks that count elements of elem_size bytes at offset fit inside an image of size bytes*/
+static int section_fits(uint32_t offset, uint32_t count, size_t elem_size, size_t size) {
+    if (offset % 4 != 0 || offset > size) return 0;
+    return count <= (size - offset) / elem_size;
+}
+
+/* Validates an image and points the section views into it. Nothing is copied.*/
+static int song_ir_attach(SongIR *ir, void *image, size_t size) {
+    const SongIRHeader *header;
+    const SongIRPattern *pattern;
+    uint32_t i;
+
+    if (size < sizeof(SongIRHeader) || memcmp(image, SONG_IR_MAGIC, 4) != 0) {
+        return -3;
+    }
+    header = (const SongIRHeader *)image;
+    if (header->version != SONG_IR_VERSION) {
+        fprintf(stderr, "Error: IR version %lu is not supported (expected %d).\n",
+                (unsigned long)header->version, SONG_IR_VERSION);
+        return -2;
+    }
+    if (header->total_size != size) {
+        fprintf(stderr, "Error: IR file is truncated or has trailing data.\n");
+        return -2;
+    }
+    if (!section_fits(header->patterns_offset, header->num_patterns, sizeof(SongIRPattern), size) ||
+        !section_fits(header->plays_offset, header->num_plays, sizeof(SongIRPlay), size) ||
+        !section_fits(header->sounds_offset, header->num_sounds, 1, size) ||
+        !section_fits(header->strings_offset, header->strings_size, 1, size)) {
+        fprintf(stderr, "Error: IR section out of bounds.\n");
+        return -2;
+    }
+
+    ir->header = header;
+    ir->patterns = (const SongIRPattern *)((const char *)image + header->patterns_offset);
+    ir->plays = (const SongIRPlay *)((const char *)image + header->plays_offset);
+    ir->sounds = (const uint8_t *)image + header->sounds_offset;
+    ir->strings = (const char *)image + header->strings_offset;
+
+    /* Bounds of every index, so the renderer can use the tables without further checks*/
+    if (header->strings_size > 0 && ir->strings[header->strings_size - 1] != '\0') {
+        fprintf(stderr, "Error: IR string table is not terminated.\n");
+        return -2;
+    }
+    for (i = 0; i < header->num_patterns; i++) {
+        pattern = &ir->patterns[i];
+        if (pattern->name >= header->strings_size ||
+            pattern->first_sound > header->num_sounds ||
+            pattern->num_sounds > header->num_sounds - pattern->first_sound) {
+            fprintf(stderr, "Error: IR pattern %lu is corrupt.\n", (unsigned long)i);
+            return -2;
+        }
+    }
+    for (i = 0; i < header->num_plays; i++) {
+        if (ir->plays[i].pattern_id >= header->num_patterns) {
+            fprintf(stderr, "Error: IR play command %lu names an unknown pattern.\n", (unsigned long)i);
+            return -2;
+        }
+    }
+    for (i = 0; i < header->num_sounds; i++) {
+        if (ir->sounds[i] >= NUM_SOUND_IDS) {
+            fprintf(stderr, "Error: IR sound ID %u is unknown.\n", (unsigned)ir->sounds[i]);
+            return -2;
+        }
+    }
+
+    ir->image = image;
+    ir->image_size = size;
+    return 0;
+}
+
+/* Places a section of count elements of elem_size bytes at *end, aligned to 4 bytes, and moves *end past it.
+ Returns 0 if the section would reach past UINT32_MAX bytes, the largest image the 32-bit offsets can address.*/
+static int place_section(size_t *end, size_t count, size_t elem_size, uint32_t *offset) {
+    size_t start;
+
+    if (*end > UINT32_MAX - 3) return 0;
+    start = ALIGN4(*end);
+    if (count > (UINT32_MAX - start) / elem_size) return 0;
+    *offset = (uint32_t)start;
+    *end = start + count * elem_size;
+    return 1;
+}
+
+/* Returns the offset of name in the string table, appending it if it is not there yet*/
+static int intern_string(NameTable *offsets, char *strings, uint32_t *strings_size, const char *name, uint32_t *offset) {
+    NameTableEntry *entry;
+    size_t length;
+    int inserted;
+
+    length = strlen(name);
+    entry = name_table_insert(offsets, name, length, *strings_size, &inserted);
+    if (!entry) return -1;
+    if (inserted) {
+        memcpy(strings + *strings_size, name, length + 1);
+        *strings_size += (uint32_t)(length + 1);
+    }
+    *offset = entry->value;
+    return 0;
+}
+
+int song_ir_build(const Song *song, SongIR *ir) {
+    SongIRHeader header;
+    SongIRPattern *ir_patterns;
+    SongIRPlay *ir_plays;
+    uint8_t *ir_sounds;
+    char *ir_strings;
+    char *image;
+    const Pattern *patterns;
+    const PlayCommand *play_sequence;
+    NameTable offsets;       /* Name -> offset in the string table*/
+    size_t num_patterns, num_play_commands;
+    size_t total_sounds;
+    size_t strings_capacity;
+    size_t size;
+    size_t i;
+    uint32_t num_sounds;
+    int result;
+
+    memset(ir, 0, sizeof(*ir));
+    memset(&header, 0, sizeof(header));
+    patterns = song->patterns;
+    play_sequence = song->play_sequence;
+    num_patterns = song->num_patterns;
+    num_play_commands = song->num_play_commands;
+
+    /* Every count and offset of the image is 32-bit: a song whose image would not fit is rejected, not truncated*/
+    total_sounds = 0;
+    strings_capacity = 0;
+    for (i = 0; i < num_patterns && total_sounds <= UINT32_MAX && strings_capacity <= UINT32_MAX; i++) {
+        total_sounds += (size_t)patterns[i].num_sounds;
+        strings_capacity += strlen(patterns[i].name) + 1;
+    }
+    size = sizeof(SongIRHeader);
+    if (total_sounds > UINT32_MAX || strings_capacity > UINT32_MAX ||
+        !place_section(&size, num_patterns, sizeof(SongIRPattern), &header.patterns_offset) ||
+        !place_section(&size, num_play_commands, sizeof(SongIRPlay), &header.plays_offset) ||
+        !place_section(&size, total_sounds, 1, &header.sounds_offset) ||
+        !place_section(&size, strings_capacity, 1, &header.strings_offset) || size > UINT32_MAX - 3) {
+        fprintf(stderr, "Error: song is too large for an IR image (over %lu bytes).\n", (unsigned long)UINT32_MAX);
+        return -3;
+    }
+    size = ALIGN4(size);
+
+    memcpy(header.magic, SONG_IR_MAGIC, 4);
+    header.version = SONG_IR_VERSION;
+    header.num_patterns = (uint32_t)num_patterns;
+    header.num_plays = (uint32_t)num_play_commands;
+    header.num_sounds = (uint32_t)total_sounds;
+
+    image = (char *)calloc(1, size);
+    if (!image) {
+        return -1;
+    }
+    ir_patterns = (SongIRPattern *)(image + header.patterns_offset);
+    ir_plays = (SongIRPlay *)(image + header.plays_offset);
+    ir_sounds = (uint8_t *)image + header.sounds_offset;
+    ir_strings = image + header.strings_offset;
+
+    name_table_init(&offsets);
+    num_sounds = 0;
+    result = 0;
+    for (i = 0; i < num_patterns; i++) {
+        if (intern_string(&offsets, ir_strings, &header.strings_size, patterns[i].name, &ir_patterns[i].name) != 0) {
+            result = -1;
+            break;
+        }
+        ir_patterns[i].first_sound = num_sounds;
+        ir_patterns[i].num_sounds = (uint32_t)patterns[i].num_sounds;
+        if (patterns[i].num_sounds > 0) {
+            memcpy(ir_sounds + num_sounds, patterns[i].sounds, (size_t)patterns[i].num_sounds);
+        }
+        num_sounds += (uint32_t)patterns[i].num_sounds;
+    }
+
+    /* Play commands were bound to pattern indices when the song was loaded (song_bind_plays)*/
+    for (i = 0; result == 0 && i < num_play_commands; i++) {
+        if (play_sequence[i].pattern_index == PATTERN_UNBOUND || play_sequence[i].pattern_index >= num_patterns) {
+            fprintf(stderr, "Error: Pattern '%s' specified in PLAY command not found.\n", play_sequence[i].pattern_name);
+            result = -2;
+            break;
+        }
+        ir_plays[i].pattern_id = play_sequence[i].pattern_index;
+        ir_plays[i].loop_count = (uint32_t)play_sequence[i].loop_count;
+    }
+    name_table_free(&offsets);
+    if (result != 0) {
+        free(image);
+        return result;
+    }
+
+    /* Interning may have left the string table shorter than reserved*/
+    size = ALIGN4(header.strings_offset + header.strings_size);
+    header.total_size = (uint32_t)size;
+    memcpy(image, &header, sizeof(header));
+
+    if (song_ir_attach(ir, image, size) != 0) {
+        free(image);
+        return -1;
+    }
+    ir->is_mapped = 0;
+    return 0;
+}
+
+int song_ir_write(const SongIR *ir, const char *filename) {
+    FILE *fp;
+    size_t written;
+
+    fp = fopen(filename, "wb");
+    if (!fp) {
+        perror("Error opening IR file for writing");
+        return -1;
+    }
+    written = fwrite(ir->image, 1, ir->image_size, fp);
+    if (fclose(fp) != 0 || written != ir->image_size) {
+        fprintf(stderr, "Error writing IR file '%s'.\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+#ifndef _WIN32
+int song_ir_map(const char *filename, SongIR *ir) {
+    int fd;
+    struct stat st;
+    void *image;
+    int result;
+
+    memset(ir, 0, sizeof(*ir));
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        /* Not knowing yet whether it is an IR file or .dj source, name the file as given*/
+        fprintf(stderr, "Error opening '%s': %s\n", filename, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(SongIRHeader)) {
+        close(fd);
+        return -3;
+    }
+    image = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        fprintf(stderr, "Error mapping '%s': %s\n", filename, strerror(errno));
+        return -1;
+    }
+
+    result = song_ir_attach(ir, image, (size_t)st.st_size);
+    if (result != 0) {
+        munmap(image, (size_t)st.st_size);
+        memset(ir, 0, sizeof(*ir));
+        return result;
+    }
+    ir->is_mapped = 1;
+    return 0;
+}
+#else
+/* No mmap on Windows builds: read the image into memory instead*/
+int song_ir_map(const char *filename, SongIR *ir) {
+    FILE *fp;
+    long size;
+    void *image;
+    int result;
+
+    memset(ir, 0, sizeof(*ir));
+    fp = fopen(filename, "rb");
+    if (!fp) {
+        /* Not knowing yet whether it is an IR file or .dj source, name the file as given*/
+        fprintf(stderr, "Error opening '%s': %s\n", filename, strerror(errno));
+        return -1;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < (long)sizeof(SongIRHeader)) {
+        fclose(fp);
+        return -3;
+    }
+    rewind(fp);
+    image = malloc((size_t)size);
+    if (!image || fread(image, 1, (size_t)size, fp) != (size_t)size) {
+        free(image);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    result = song_ir_attach(ir, image, (size_t)size);
+    if (result != 0) {
+        free(image);
+        memset(ir, 0, sizeof(*ir));
+        return result;
+    }
+    return 0;
+}
+#endif
+
+/* FNV-1a of size bytes*/
+static uint32_t hash_bytes(uint32_t hash, const void *data, size_t size) {
+    const unsigned char *bytes;
+    size_t i;
+
+    bytes = (const unsigned char *)data;
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+uint32_t song_ir_hash(const SongIR *ir) {
+    uint32_t hash;
+    uint32_t i;
+
+    hash = 2166136261u;
+    for (i = 0; i < ir->header->num_plays; i++) {
+        hash = hash_bytes(hash, &ir->plays[i], sizeof(SongIRPlay));
+    }
+    for (i = 0; i < ir->header->num_patterns; i++) {
+        hash = hash_bytes(hash, &ir->patterns[i].num_sounds, sizeof(uint32_t));
+        hash = hash_bytes(hash, ir->sounds + ir->patterns[i].first_sound, ir->patterns[i].num_sounds);
+    }
+    return hash;
+}
+
+const char *song_ir_pattern_name(const SongIR *ir, uint32_t pattern_id) {
+    return ir->strings + ir->patterns[pattern_id].name;
+}
+
+void song_ir_release(SongIR *ir) {
+    if (!ir->image) return;
+#ifndef _WIN32
+    if (ir->is_mapped) {
+        munmap(ir->image, ir->image_size);
+    } else {
+        free(ir->image);
+    }
+#else
+    free(ir->image);
+#endif
+    memset(ir, 0, sizeof(*ir));
+}
@@ -0,0 +1,86 @@
+#ifndef SONGIR_H
+#define SONGIR_H
+
+#include <stdint.h>
+#include <stddef.h> /* For size_t*/
+#include "tokensParser.h" /* For Song*/
+
+/* Binary song IR: a compact replacement for transformed_tokens.txt that the renderer uses in place.
+
+ File layout (host byte order, every section 4-byte aligned):
+   SongIRHeader
+   SongIRPattern[num_patterns]   pattern table
+   SongIRPlay[num_plays]         play commands as (pattern_id, loop_count)
+   uint8_t[num_sounds]           sound IDs (SoundId) of all patterns, back to back
+   char[strings_size]            interned, NUL-terminated names; SongIRPattern.name is an offset in here
+
+ The version is bumped whenever the layout or the meaning of sound IDs changes, so a file written with a
+ different byte order or by an incompatible compiler is rejected rather than misread.*/
+
+#define SONG_IR_MAGIC "DJIR"
+#define SONG_IR_VERSION 1
+
+typedef struct {
+    char magic[4];            /* "DJIR"*/
+    uint32_t version;         /* SONG_IR_VERSION*/
+    uint32_t total_size;      /* Size of the whole file in bytes*/
+    uint32_t num_patterns;
+    uint32_t num_plays;
+    uint32_t num_sounds;
+    uint32_t strings_size;
+    uint32_t patterns_offset; /* Section offsets from the start of the file*/
+    uint32_t plays_offset;
+    uint32_t sounds_offset;
+    uint32_t strings_offset;
+    uint32_t reserved;        /* 0*/
+} SongIRHeader;
+
+typedef struct {
+    uint32_t name;            /* Offset of the pattern name in the string table*/
+    uint32_t first_sound;     /* Index of the pattern's first sound ID*/
+    uint32_t num_sounds;
+} SongIRPattern;
+
+typedef struct {
+    uint32_t pattern_id;      /* Index into the pattern table, bound when the IR is built*/
+    uint32_t loop_count;
+} SongIRPlay;
+
+/* A validated IR image and views of its sections. The image is either heap memory or a read-only mapping.*/
+typedef struct {
+    const SongIRHeader *header;
+    const SongIRPattern *patterns;
+    const SongIRPlay *plays;
+    const uint8_t *sounds;
+    const char *strings;
+
+    void *image;              /* Owned memory or mapping; released by song_ir_release*/
+    size_t image_size;
+    int is_mapped;
+} SongIR;
+
+/* Builds an IR image in memory from a parsed song: interns names and copies the sound IDs and pattern indices
+ resolved by the parser (see song_bind_plays).
+ Returns 0 on success, -1 on allocation error, -2 if a PLAY command names an undefined pattern,
+ -3 if the image would pass UINT32_MAX bytes, past what its 32-bit offsets and counts can hold.*/
+int song_ir_build(const Song *song, SongIR *ir);
+
+/* Writes the IR image to a file. Returns 0 on success, -1 on file error.*/
+int song_ir_write(const SongIR *ir, const char *filename);
+
+/* Maps an IR file read-only (mmap where available) and validates it; nothing is parsed or copied.
+ Returns 0 on success, -1 on file error (reported under filename, which may turn out to be .dj source), -2 if
+ the file is corrupt or has another version, -3 if the file is not an IR file at all (no magic).*/
+int song_ir_map(const char *filename, SongIR *ir);
+
+/* Hash of what the song plays: its patterns' sounds and its play commands, not the names. It keys the song's noise
+ (see noise_song_key), so a source and its compiled IR, built or mapped, hash the same.*/
+uint32_t song_ir_hash(const SongIR *ir);
+
+/* Name of pattern pattern_id*/
+const char *song_ir_pattern_name(const SongIR *ir, uint32_t pattern_id);
+
+/* Frees or unmaps the image*/
+void song_ir_release(SongIR *ir);
+
+#endif /* SONGIR_H*/
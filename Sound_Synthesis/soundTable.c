@@ -0,0 +1,59 @@
+#include "soundTable.h"
+#include <string.h>
+
+/* The kernel of a sound, its name, which must match, and its accumulating variant*/
+#define KERNEL(sound) generate_##sound, "generate_" #sound, accumulate_##sound
+
+/* Envelopes of the table: constant, and exponential decay from 1 to level*/
+#define FLAT { ENVELOPE_FLAT, 1.0f, 1.0f, 0.0f, 0.0f, 0.0f }
+#define DECAY(level) { ENVELOPE_EXPONENTIAL, 1.0f, level, 0.0f, 0.0f, 0.0f }
+/* A pitch envelope falling geometrically from ratio times the frequency to the frequency itself: a kick's sweep*/
+#define SWEEP(ratio) { ENVELOPE_EXPONENTIAL, ratio, 1.0f, 0.0f, 0.0f, 0.0f }
+/* A struck string: a quick attack, a decay to a quieter sustain, and a release at the end of the beat*/
+#define PIANO { ENVELOPE_ADSR, 1.0f, 0.35f, 0.01f, 0.4f, 0.1f }
+
+/* Frequencies and levels are the ones the generators always used. Feel free to change by ear.*/
+const SoundEntry SOUND_TABLE[NUM_SOUND_IDS] = {
+    /* name        kernels                    frequency  pitch  envelope        gain    noisy*/
+    { "REST",      KERNEL(rest),              { 0.0f,      FLAT,  FLAT,           0.0f }, 0 },
+    { "BOOM",      KERNEL(boom),              { BOOM_FREQ, SWEEP(2.0f), DECAY(0.001f), 1.0f }, 0 }, /* Kick drum: falls an octave, fast decay*/
+    { "TSST",      KERNEL(tsst),              { TSST_FREQ, FLAT,  DECAY(0.0001f), 0.7f }, 1 }, /* Very fast decay, reduced level for high frequencies*/
+    { "CLAP",      KERNEL(clap),              { CLAP_FREQ, FLAT,  DECAY(0.01f),   0.8f }, 1 }, /* Slower decay for clap reverb*/
+    { "DUN",       KERNEL(floortom),          { BOOM_FREQ, FLAT,  DECAY(0.002f),  1.0f }, 1 },
+    { "DING",      KERNEL(ding),              { DING_FREQ, FLAT,  DECAY(0.01f),   1.0f }, 0 },
+    { "DIDING",    KERNEL(diding),            { DING_FREQ, FLAT,  DECAY(0.01f),   1.0f }, 0 },
+    { "DIDIDING",  KERNEL(dididing),          { DING_FREQ, FLAT,  DECAY(0.01f),   1.0f }, 0 },
+    { "CRASH",     KERNEL(crash),             { CRASH_FREQ, FLAT, DECAY(0.05f),   0.6f }, 1 }, /* Slow decay for crash*/
+    { "D2",        KERNEL(note),              { D2,        FLAT,  PIANO,          0.6f }, 0 },
+    { "G2",        KERNEL(note),              { G2,        FLAT,  PIANO,          0.6f }, 0 },
+    { "A2",        KERNEL(note),              { A2,        FLAT,  PIANO,          0.6f }, 0 },
+    { "B2",        KERNEL(note),              { B2,        FLAT,  PIANO,          0.6f }, 0 },
+    { "D3",        KERNEL(note),              { D3,        FLAT,  PIANO,          0.6f }, 0 },
+    { "G3",        KERNEL(note),              { G3,        FLAT,  PIANO,          0.6f }, 0 },
+    { "A3",        KERNEL(note),              { A3,        FLAT,  PIANO,          0.6f }, 0 },
+    { "B3",        KERNEL(note),              { B3,        FLAT,  PIANO,          0.6f }, 0 },
+    { "CS4",       KERNEL(note),              { Cs4,       FLAT,  PIANO,          0.6f }, 0 },
+    { "D4",        KERNEL(note),              { D4,        FLAT,  PIANO,          0.6f }, 0 },
+    { "E4",        KERNEL(note),              { E4,        FLAT,  PIANO,          0.6f }, 0 },
+    { "FS4",       KERNEL(note),              { Fs4,       FLAT,  PIANO,          0.6f }, 0 },
+    { "G4",        KERNEL(note),              { G4,        FLAT,  PIANO,          0.6f }, 0 },
+    { "A4",        KERNEL(note),              { A4,        FLAT,  PIANO,          0.6f }, 0 },
+    { "B4",        KERNEL(note),              { B4,        FLAT,  PIANO,          0.6f }, 0 },
+    { "DM",        KERNEL(dm),                { D4,        FLAT,  PIANO,          0.9f }, 0 }, /* Chords: the frequency is the root's*/
+    { "AM1ST",     KERNEL(am1st),             { A4,        FLAT,  PIANO,          0.9f }, 0 },
+    { "BM1ST",     KERNEL(bm1st),             { B4,        FLAT,  PIANO,          0.9f }, 0 },
+    { "GM2ND",     KERNEL(gm2nd),             { G4,        FLAT,  PIANO,          0.9f }, 0 }
+};
+
+int sound_id_from_name(const char *sound_name) {
+    int id;
+    for (id = 0; id < NUM_SOUND_IDS; id++) {
+        if (strcmp(sound_name, SOUND_TABLE[id].name) == 0) return id;
+    }
+    return -1;
+}
+
+const char *sound_id_name(int sound_id) {
+    if (sound_id < 0 || sound_id >= NUM_SOUND_IDS) return "?";
+    return SOUND_TABLE[sound_id].name;
+}
@@ -0,0 +1,60 @@
+#ifndef SOUNDTABLE_H
+#define SOUNDTABLE_H
+
+#include "soundwaves.h" /* For SoundKernel and SoundParams*/
+
+/* Numeric sound IDs, as stored in Pattern and in the binary song IR. REST is 0 so unknown sounds fall back to silence.
+ Sound names are resolved to IDs once, when a song is parsed; rendering only indexes SOUND_TABLE.*/
+typedef enum {
+    SOUND_REST = 0,
+    SOUND_BOOM,
+    SOUND_TSST,
+    SOUND_CLAP,
+    SOUND_DUN,
+    SOUND_DING,
+    SOUND_DIDING,
+    SOUND_DIDIDING,
+    SOUND_CRASH,
+    /* Piano notes (all one voice, at the frequency of their entry) and chords*/
+    SOUND_D2,
+    SOUND_G2,
+    SOUND_A2,
+    SOUND_B2,
+    SOUND_D3,
+    SOUND_G3,
+    SOUND_A3,
+    SOUND_B3,
+    SOUND_CS4,
+    SOUND_D4,
+    SOUND_E4,
+    SOUND_FS4,
+    SOUND_G4,
+    SOUND_A4,
+    SOUND_B4,
+    SOUND_DM,
+    SOUND_AM1ST,
+    SOUND_BM1ST,
+    SOUND_GM2ND,
+    NUM_SOUND_IDS
+} SoundId;
+
+/* Everything needed to render one sound: its kernels and the parameters it is called with by default*/
+typedef struct {
+    const char *name;    /* Upper-case name used in the token file ("BOOM", ...)*/
+    SoundKernel kernel;
+    const char *kernel_name; /* C name of kernel, for code generated ahead of time (see songCodegen.h)*/
+    SoundMixKernel accumulate; /* The accumulating variant of kernel, which the renderer mixes hits with*/
+    SoundParams params;  /* params.frequency is the default frequency*/
+    int noisy;           /* 1 if the kernel draws white noise, so every hit sounds different and cannot be cached*/
+} SoundEntry;
+
+/* Indexed by SoundId*/
+extern const SoundEntry SOUND_TABLE[NUM_SOUND_IDS];
+
+/* Maps an upper-case sound name ("BOOM", ...) to its ID. Returns -1 for unknown names.*/
+int sound_id_from_name(const char *sound_name);
+
+/* Upper-case name of a sound ID, or "?" if out of range*/
+const char *sound_id_name(int sound_id);
+
+#endif /* SOUNDTABLE_H*/
@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "envelope.h"
+#include "noise.h"
 
 /* Audio configuration constants*/
 #define SAMPLE_RATE 44100
@@ -36,25 +38,85 @@
 #define TSST_FREQ 7000.0f    /* High-hat frequency center*/
 #define CLAP_FREQ 2500.0f    /* Hand clap frequency center*/
 #define DING_FREQ 900.0f     /* Triangle bell frequency*/
+#define CRASH_FREQ 5000.0f   /* Cymbal ring center*/
+
+/* Per-sound parameters passed to every sound kernel. Kernels ignore what they do not use (e.g. noise ignores frequency
+ and pitch).*/
+typedef struct {
+    float frequency;          /* Base frequency in Hz*/
+    EnvelopeParams pitch;     /* Multiplies frequency over the sound (a falling one makes a kick sweep)*/
+    EnvelopeParams envelope;  /* Level over the sound*/
+    float gain;               /* Output level as a fraction of MAX_AMPLITUDE*/
+} SoundParams;
+
+/* Uniform signature of all sound kernels: fill num_samples samples of buffer with the hit identified by event,
+ as float on the 16-bit scale (see mixBus.h). Kernels with noise draw it from the event's stream, so the output
+ depends on nothing else. Each kernel is a voice (voice.h) rendering the whole hit in one block.*/
+typedef void (*SoundKernel)(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+
+/* Accumulating signature: add gain times the hit of num_samples samples to dest[offset .. offset + num_samples),
+ in the pass that synthesizes it. With gain 1 the result is exactly that of the SoundKernel followed by mix_in.*/
+typedef void (*SoundMixKernel)(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                               const NoiseEvent *event);
 
 /* Function declarations for drum sounds*/
-void generate_boom(int16_t *buffer, int num_samples, float frequency);
-void generate_tsst(int16_t *buffer, int num_samples, float frequency);
-void generate_clap(int16_t *buffer, int num_samples, float frequency);
-void generate_crash(int16_t *buffer, int num_samples);
-void generate_rest(int16_t *buffer, int num_samples);
-void generate_floortom(int16_t *buffer, int num_samples, float base_freq);
+void generate_boom(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_tsst(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_clap(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_crash(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_rest(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_floortom(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
 
 /* Function declarations for triangle sounds*/
-void generate_ding(int16_t *buffer, int num_samples, float frequency);
-void generate_diding(int16_t *buffer, int num_samples, float frequency);
-void generate_dididing(int16_t *buffer, int num_samples, float frequency);
-
-/* Function declarations for musical chord progression. Added these so we can play around with sounds other than drum and triangle. See if we want to use/mix these.*/
-void play(int16_t *buffer, size_t buffer_size, float freq, float duration, int measure, float beat);
-void DM(int16_t *buffer, size_t buffer_size, float duration, int measure, float beat);
-void AM1st(int16_t *buffer, size_t buffer_size, float duration, int measure, float beat);
-void Bm1st(int16_t *buffer, size_t buffer_size, float duration, int measure, float beat);
-void GM2nd(int16_t *buffer, size_t buffer_size, float duration, int measure, float beat);
+void generate_ding(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_diding(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_dididing(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+
+/* Piano sounds: any note (at params->frequency) and the chords of the progression*/
+void generate_note(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_dm(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_am1st(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_bm1st(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+void generate_gm2nd(float *buffer, int num_samples, const SoundParams *params, const NoiseEvent *event);
+
+/* Accumulating variants of the drum, triangle and piano sounds*/
+void accumulate_boom(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                     const NoiseEvent *event);
+void accumulate_tsst(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                     const NoiseEvent *event);
+void accumulate_clap(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                     const NoiseEvent *event);
+void accumulate_crash(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                      const NoiseEvent *event);
+void accumulate_rest(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                     const NoiseEvent *event);
+void accumulate_floortom(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                         const NoiseEvent *event);
+void accumulate_ding(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                     const NoiseEvent *event);
+void accumulate_diding(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                       const NoiseEvent *event);
+void accumulate_dididing(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                         const NoiseEvent *event);
+void accumulate_note(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                     const NoiseEvent *event);
+void accumulate_dm(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                   const NoiseEvent *event);
+void accumulate_am1st(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                      const NoiseEvent *event);
+void accumulate_bm1st(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                      const NoiseEvent *event);
+void accumulate_gm2nd(float *dest, size_t offset, int num_samples, float gain, const SoundParams *params,
+                      const NoiseEvent *event);
+
+/* Musical chord progression: each adds a piano note (at freq) or chord lasting duration beats, from beat (which can
+ be fractional) of measure, both counted from 0, to buffer, a mix bus of buffer_size samples (see mixBus.h). What
+ would fall past its end is left out. Each hit's noise depends on --seed and where and what it is, never on the
+ order of the calls. In a .dj song the same sounds play a beat each on the Piano instrument.*/
+void play(float *buffer, size_t buffer_size, float freq, float duration, int measure, float beat);
+void DM(float *buffer, size_t buffer_size, float duration, int measure, float beat);
+void AM1st(float *buffer, size_t buffer_size, float duration, int measure, float beat);
+void Bm1st(float *buffer, size_t buffer_size, float duration, int measure, float beat);
+void GM2nd(float *buffer, size_t buffer_size, float duration, int measure, float beat);
 
 #endif /* SOUNDWAVES_H*/
@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 200112L /* For pthreads and sysconf with -ansi*/
+#include "threadPool.h"
+#include <stdlib.h>
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+/* Indices [begin, end) still to run for one worker. The owner takes from begin, thieves from end.*/
+typedef struct {
+    size_t begin;
+    size_t end;
+    pthread_mutex_t lock;
+} WorkRange;
+
+typedef struct {
+    WorkRange *ranges;
+    int num_workers;
+    ThreadPoolTask task;
+    void *context;
+} WorkPool;
+
+typedef struct {
+    WorkPool *pool;
+    int worker;
+} WorkerArg;
+
+/* Next index of the worker's own range, or 0 if it is empty*/
+static int take_own(WorkRange *range, size_t *index) {
+    int found;
+
+    pthread_mutex_lock(&range->lock);
+    found = range->begin < range->end;
+    if (found) {
+        *index = range->begin++;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return found;
+}
+
+/* Moves the back half of the largest other range into the worker's own. Returns 0 if there was nothing to steal.*/
+static int steal(WorkPool *pool, int worker) {
+    WorkRange *victim;
+    WorkRange *own;
+    size_t left, best_left;
+    size_t begin, end;
+    int best;
+    int i;
+
+    /* Pick the victim with the most work left; the sizes are a snapshot, rechecked under the lock below*/
+    best = -1;
+    best_left = 0;
+    for (i = 0; i < pool->num_workers; i++) {
+        if (i == worker) continue;
+        victim = &pool->ranges[i];
+        pthread_mutex_lock(&victim->lock);
+        left = victim->end - victim->begin;
+        pthread_mutex_unlock(&victim->lock);
+        if (left > best_left) {
+            best_left = left;
+            best = i;
+        }
+    }
+    if (best < 0) {
+        return 0;
+    }
+
+    victim = &pool->ranges[best];
+    pthread_mutex_lock(&victim->lock);
+    left = victim->end - victim->begin;
+    end = victim->end;
+    begin = end - (left + 1) / 2;
+    victim->end = begin;
+    pthread_mutex_unlock(&victim->lock);
+    if (begin == end) {
+        return steal(pool, worker); /* Emptied in the meantime: look again*/
+    }
+
+    own = &pool->ranges[worker];
+    pthread_mutex_lock(&own->lock);
+    own->begin = begin;
+    own->end = end;
+    pthread_mutex_unlock(&own->lock);
+    return 1;
+}
+
+static void *work(void *arg) {
+    WorkPool *pool;
+    int worker;
+    size_t index;
+
+    pool = ((WorkerArg *)arg)->pool;
+    worker = ((WorkerArg *)arg)->worker;
+    for (;;) {
+        if (take_own(&pool->ranges[worker], &index)) {
+            pool->task(pool->context, index, worker);
+        } else if (!steal(pool, worker)) {
+            break; /* No new work is ever added, so none left anywhere means done*/
+        }
+    }
+    return NULL;
+}
+
+int thread_pool_run(int num_threads, size_t count, ThreadPoolTask task, void *context) {
+    WorkPool pool;
+    WorkerArg *args;
+    pthread_t *threads;
+    int started;
+    int i;
+
+    if (num_threads < 1) num_threads = 1;
+    if ((size_t)num_threads > count) num_threads = count > 0 ? (int)count : 1;
+
+    pool.ranges = (WorkRange *)malloc((size_t)num_threads * sizeof(WorkRange));
+    args = (WorkerArg *)malloc((size_t)num_threads * sizeof(WorkerArg));
+    threads = (pthread_t *)malloc((size_t)num_threads * sizeof(pthread_t));
+    if (!pool.ranges || !args || !threads) {
+        free(pool.ranges);
+        free(args);
+        free(threads);
+        return -1;
+    }
+    pool.num_workers = num_threads;
+    pool.task = task;
+    pool.context = context;
+    for (i = 0; i < num_threads; i++) {
+        pool.ranges[i].begin = count * (size_t)i / (size_t)num_threads;
+        pool.ranges[i].end = count * (size_t)(i + 1) / (size_t)num_threads;
+        pthread_mutex_init(&pool.ranges[i].lock, NULL);
+        args[i].pool = &pool;
+        args[i].worker = i;
+    }
+
+    /* Worker 0 is the calling thread. If a thread cannot be started, its share is stolen by the others.*/
+    started = 0;
+    for (i = 1; i < num_threads; i++) {
+        if (pthread_create(&threads[i], NULL, work, &args[i]) != 0) break;
+        started = i;
+    }
+    work(&args[0]);
+    for (i = 1; i <= started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    for (i = 0; i < num_threads; i++) {
+        pthread_mutex_destroy(&pool.ranges[i].lock);
+    }
+    free(pool.ranges);
+    free(args);
+    free(threads);
+    return 0;
+}
+
+int thread_pool_cpu_count(void) {
+    long count;
+
+    count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+#else
+int thread_pool_run(int num_threads, size_t count, ThreadPoolTask task, void *context) {
+    size_t i;
+
+    (void)num_threads;
+    for (i = 0; i < count; i++) {
+        task(context, i, 0);
+    }
+    return 0;
+}
+
+int thread_pool_cpu_count(void) {
+    return 1;
+}
+#endif
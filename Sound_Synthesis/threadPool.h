@@ -0,0 +1,20 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <stddef.h> /* For size_t*/
+
+/* Runs one task: index is in [0, count), worker in [0, num_threads)*/
+typedef void (*ThreadPoolTask)(void *context, size_t index, int worker);
+
+/* Runs task for every index in [0, count) on num_threads threads (the calling one included) and returns
+ when all are done. Work stealing: each worker starts with an equal contiguous share of the indices and
+ takes them from the front; a worker that runs out steals the back half of the largest share left, so
+ uneven tasks (short and long songs) still keep every thread busy. Tasks run concurrently and must not
+ share mutable state. Without pthreads (Windows builds) the tasks run one after the other.
+ Returns 0, or -1 if out of memory (then no task has run).*/
+int thread_pool_run(int num_threads, size_t count, ThreadPoolTask task, void *context);
+
+/* Number of online CPUs, at least 1*/
+int thread_pool_cpu_count(void);
+
+#endif /* THREADPOOL_H*/
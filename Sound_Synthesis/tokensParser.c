@@ -1,34 +1,233 @@
 #include "tokensParser.h"
+#include "soundTable.h"
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define MAX_LINE_LEN 256 /* Maximum length of a line in the tokens file*/
 
+#define SONG_ARENA_BLOCK_SIZE (256 * 1024)
+
+void song_init(Song *song) {
+    arena_init(&song->arena, SONG_ARENA_BLOCK_SIZE);
+    name_table_init(&song->names);
+    song->patterns = NULL;
+    song->num_patterns = 0;
+    song->patterns_capacity = 0;
+    song->play_sequence = NULL;
+    song->num_play_commands = 0;
+    song->play_capacity = 0;
+}
+
+void song_release(Song *song) {
+    name_table_free(&song->names);
+    arena_release(&song->arena);
+    song_init(song);
+}
+
+/* Returns the name table entry of text[0 .. length), interning a copy if needed*/
+static NameTableEntry *intern_entry(Song *song, const char *text, size_t length) {
+    NameTableEntry *entry;
+    char *copy;
+    int inserted;
+
+    entry = name_table_find(&song->names, text, length);
+    if (entry) {
+        return entry;
+    }
+    copy = arena_strndup(&song->arena, text, length);
+    if (!copy) {
+        return NULL;
+    }
+    return name_table_insert(&song->names, copy, length, 0, &inserted);
+}
+
+const char *song_intern(Song *song, const char *text, size_t length) {
+    NameTableEntry *entry;
+
+    entry = intern_entry(song, text, length);
+    return entry ? entry->key : NULL;
+}
+
+/* Grows an arena-backed array to hold at least one more element, doubling its capacity*/
+static void *grow_array(Arena *arena, void *items, size_t *capacity, size_t count, size_t item_size) {
+    size_t new_capacity;
+    void *grown;
+
+    if (count < *capacity) {
+        return items;
+    }
+    new_capacity = *capacity ? *capacity * 2 : 8;
+    grown = arena_grow(arena, items, *capacity * item_size, new_capacity * item_size);
+    if (grown) {
+        *capacity = new_capacity;
+    }
+    return grown;
+}
+
+int song_add_pattern(Song *song, const char *name, size_t length) {
+    Pattern *patterns;
+    Pattern *pattern;
+    NameTableEntry *entry;
+
+    patterns = (Pattern *)grow_array(&song->arena, song->patterns, &song->patterns_capacity,
+                                     song->num_patterns, sizeof(Pattern));
+    if (!patterns) return -1;
+    song->patterns = patterns;
+
+    pattern = &song->patterns[song->num_patterns];
+    entry = intern_entry(song, name, length);
+    if (!entry) return -1;
+    if (entry->value == 0) {
+        entry->value = (uint32_t)song->num_patterns + 1;
+    }
+    pattern->name = entry->key;
+    pattern->sounds = NULL;
+    pattern->num_sounds = 0;
+    pattern->sounds_capacity = 0;
+    song->num_patterns++;
+    return 0;
+}
+
+int song_add_sound(Song *song, int sound_id) {
+    Pattern *pattern;
+    uint8_t *sounds;
+    size_t capacity;
+
+    pattern = &song->patterns[song->num_patterns - 1];
+    capacity = (size_t)pattern->sounds_capacity;
+    sounds = (uint8_t *)grow_array(&song->arena, pattern->sounds, &capacity,
+                                   (size_t)pattern->num_sounds, sizeof(uint8_t));
+    if (!sounds) return -1;
+    pattern->sounds = sounds;
+    pattern->sounds_capacity = (int)capacity;
+    pattern->sounds[pattern->num_sounds++] = (uint8_t)sound_id;
+    return 0;
+}
+
+int song_add_play(Song *song, const char *pattern_name, size_t length, int loop_count) {
+    PlayCommand *plays;
+    PlayCommand *command;
+
+    plays = (PlayCommand *)grow_array(&song->arena, song->play_sequence, &song->play_capacity,
+                                      song->num_play_commands, sizeof(PlayCommand));
+    if (!plays) return -1;
+    song->play_sequence = plays;
+
+    command = &song->play_sequence[song->num_play_commands];
+    command->pattern_name = song_intern(song, pattern_name, length);
+    if (!command->pattern_name) return -1;
+    command->pattern_index = PATTERN_UNBOUND;
+    command->loop_count = loop_count;
+    song->num_play_commands++;
+    return 0;
+}
+
+int song_append(Song *song, Song *other) {
+    Pattern *patterns;
+    PlayCommand *plays;
+    const PlayCommand *command;
+    NameTableEntry *entry;
+    size_t capacity;
+    size_t i;
+    int inserted;
+
+    /* Adopt first: the names and sounds of other are used in place from now on*/
+    arena_adopt(&song->arena, &other->arena);
+
+    if (song->num_patterns + other->num_patterns > song->patterns_capacity) {
+        capacity = song->num_patterns + other->num_patterns;
+        patterns = (Pattern *)arena_grow(&song->arena, song->patterns, song->patterns_capacity * sizeof(Pattern),
+                                         capacity * sizeof(Pattern));
+        if (!patterns) return -1;
+        song->patterns = patterns;
+        song->patterns_capacity = capacity;
+    }
+    for (i = 0; i < other->num_patterns; i++) {
+        entry = name_table_insert(&song->names, other->patterns[i].name, strlen(other->patterns[i].name), 0, &inserted);
+        if (!entry) return -1;
+        if (entry->value == 0) {
+            entry->value = (uint32_t)song->num_patterns + 1;
+        }
+        song->patterns[song->num_patterns] = other->patterns[i];
+        song->patterns[song->num_patterns].name = entry->key;
+        song->num_patterns++;
+    }
+
+    if (song->num_play_commands + other->num_play_commands > song->play_capacity) {
+        capacity = song->num_play_commands + other->num_play_commands;
+        plays = (PlayCommand *)arena_grow(&song->arena, song->play_sequence, song->play_capacity * sizeof(PlayCommand),
+                                          capacity * sizeof(PlayCommand));
+        if (!plays) return -1;
+        song->play_sequence = plays;
+        song->play_capacity = capacity;
+    }
+    for (i = 0; i < other->num_play_commands; i++) {
+        command = &other->play_sequence[i];
+        entry = name_table_insert(&song->names, command->pattern_name, strlen(command->pattern_name), 0, &inserted);
+        if (!entry) return -1;
+        song->play_sequence[song->num_play_commands] = *command;
+        song->play_sequence[song->num_play_commands].pattern_name = entry->key;
+        song->play_sequence[song->num_play_commands].pattern_index = PATTERN_UNBOUND;
+        song->num_play_commands++;
+    }
+
+    song_release(other); /* Only its name table is left to free*/
+    return 0;
+}
+
+int song_bind_plays(Song *song) {
+    PlayCommand *command;
+    const NameTableEntry *entry;
+    size_t i;
+
+    for (i = 0; i < song->num_play_commands; i++) {
+        command = &song->play_sequence[i];
+        entry = name_table_find(&song->names, command->pattern_name, strlen(command->pattern_name));
+        if (!entry || entry->value == 0) {
+            fprintf(stderr, "Error: Pattern '%s' specified in PLAY command not found.\n", command->pattern_name);
+            return -2;
+        }
+        command->pattern_index = entry->value - 1;
+    }
+    return 0;
+}
+
+/* Splits off the next space-separated word of *cursor. Returns its length (0 if none) and sets *word.*/
+static size_t next_word(const char** cursor, const char** word) {
+    const char* p;
+    size_t length;
+
+    p = *cursor + strspn(*cursor, " \t");
+    length = strcspn(p, " \t");
+    *word = p;
+    *cursor = p + length;
+    return length;
+}
+
 /* Function implementation for the parser*/
-int parse_tokens_file(const char* filename,
-                      Pattern patterns[MAX_PATTERNS],
-                      int* num_patterns,
-                      PlayCommand play_sequence[MAX_PLAY_COMMANDS],
-                      int* num_play_commands)
+int parse_tokens_file(const char* filename, Song* song)
 {
     FILE *fp;
     char line[MAX_LINE_LEN];
-    int current_pattern_index;
-    char loop_keyword[5]; /* To read "LOOP"*/
-    int scan_result;
-    Pattern* current_p;
+    int in_pattern;
+    const char* cursor;
+    const char* name;
+    const char* keyword;
+    const char* count;
+    size_t name_length;
+    long loop_count;
+    char* end;
+    int sound_id;
 
-    
     fp = fopen(filename, "r");
     if (!fp) {
         perror("Error opening tokens file");
         return -1; /* File error*/
     }
 
-    *num_patterns = 0;
-    *num_play_commands = 0;
-    current_pattern_index = -1; /* Index of the pattern currently being defined, -1 if none*/
+    in_pattern = 0; /* 1 while between PATTERN and END*/
 
     while (fgets(line, sizeof(line), fp)) {
         /* Remove trailing newline character and skip empty lines*/
@@ -39,99 +238,89 @@ int parse_tokens_file(const char* filename,
 
         /*Check for keywords manually. We are only looking for PATTERN and END and PLAY*/
         if (strncmp(line, "PATTERN ", 8) == 0) {
-            if (current_pattern_index != -1) { /* This is triggered if there is another PATTERN keyword vefore an END*/
+            if (in_pattern) { /* This is triggered if there is another PATTERN keyword vefore an END*/
                 fprintf(stderr, "Error: Nested PATTERN definition or missing END.\n");
                 fclose(fp);
                 return -2; /* Parsing error*/
             }
-            if (*num_patterns >= MAX_PATTERNS) {
-                fprintf(stderr, "Error: Maximum number of patterns (%d) exceeded.\n", MAX_PATTERNS);
-                fclose(fp);
-                return -2;
-            }
-
-            current_pattern_index = *num_patterns;
-            patterns[current_pattern_index].num_sounds = 0;
 
             /* Extract pattern name*/
-            if (sscanf(line, "PATTERN %31s", patterns[current_pattern_index].name) != 1) {
-                 fprintf(stderr, "Error: Could not parse pattern name in line: %s\n", line); /* MAX pattern name length is 16 bytes. */
+            cursor = line + 8;
+            name_length = next_word(&cursor, &name);
+            if (name_length == 0) {
+                 fprintf(stderr, "Error: Could not parse pattern name in line: %s\n", line);
                  fclose(fp);
                  return -2;
             }
-            (*num_patterns)++;
+            if (song_add_pattern(song, name, name_length) != 0) {
+                fclose(fp);
+                return -1;
+            }
+            in_pattern = 1;
 
         } else if (strcmp(line, "END") == 0) {
-            if (current_pattern_index == -1) { /* Only expecting an END if there is a PATTERN before*/
+            if (!in_pattern) { /* Only expecting an END if there is a PATTERN before*/
                 fprintf(stderr, "Error: Found END outside of PATTERN definition.\n");
                 fclose(fp);
                 return -2;
             }
-            current_pattern_index = -1; /* End of current pattern definition*/
+            in_pattern = 0; /* End of current pattern definition*/
 
         } else if (strncmp(line, "PLAY ", 5) == 0) { /* IF THE LINE STARTS WITH PLAY, IT SHOULD LOOK FOR PATTERN NAME AND LOOP*/
-             if (current_pattern_index != -1) { /* Must END first before doing a PLAY*/
+             if (in_pattern) { /* Must END first before doing a PLAY*/
                 fprintf(stderr, "Error: PLAY command inside PATTERN definition.\n");
                 fclose(fp);
                 return -2;
             }
-            if (*num_play_commands >= MAX_PLAY_COMMANDS) { /* No more than 10 play commaands*/
-                fprintf(stderr, "Error: Maximum number of play commands (%d) exceeded.\n", MAX_PLAY_COMMANDS);
-                fclose(fp);
-                return -2; 
-            }
-            
-            scan_result = sscanf(line, "PLAY %15s %4s %d",
-                               play_sequence[*num_play_commands].pattern_name,
-                               loop_keyword,
-                               &play_sequence[*num_play_commands].loop_count);
-            
-            if (scan_result != 3 || strcmp(loop_keyword, "LOOP") != 0) {
+
+            cursor = line + 5;
+            name_length = next_word(&cursor, &name);
+            if (name_length == 0 || next_word(&cursor, &keyword) != 4 || strncmp(keyword, "LOOP", 4) != 0 ||
+                next_word(&cursor, &count) == 0) {
                 fprintf(stderr, "Error: Could not parse PLAY command in line: %s\n", line);
                 fclose(fp);
                 return -2;
             }
-            if (play_sequence[*num_play_commands].loop_count <= 0) {
-                fprintf(stderr, "Error: Loop count must be positive in line: %s\n", line);
+            loop_count = strtol(count, &end, 10);
+            /* Positive as before; the upper bound is only that of PlayCommand.loop_count (strtol saturates)*/
+            if (loop_count <= 0 || loop_count > INT_MAX || (*end != '\0' && *end != ' ' && *end != '\t')) {
+                fprintf(stderr, "Error: Loop count must be a positive number up to %d in line: %s\n", INT_MAX, line);
                 fclose(fp);
                 return -2;
             }
-
-            (*num_play_commands)++;
+            if (song_add_play(song, name, name_length, (int)loop_count) != 0) {
+                fclose(fp);
+                return -1;
+            }
 
         } else { /* Assume it's a sound name within a pattern if its not starting with PLAY, PATTERN or END*/
-            if (current_pattern_index == -1) { /* can only define between PATTERN and END*/
+            if (!in_pattern) { /* can only define between PATTERN and END*/
                 fprintf(stderr, "Error: Found sound name '%s' outside of PATTERN definition.\n", line);
                 fclose(fp);
                 return -2; 
             }
 
-            current_p = &patterns[current_pattern_index];
-            if (current_p->num_sounds >= MAX_SOUNDS_PER_PATTERN) {
-                fprintf(stderr, "Error: Maximum sounds per pattern (%d) exceeded for pattern '%s'.\n",
-                        MAX_SOUNDS_PER_PATTERN, current_p->name);
-                fclose(fp);
-                return -2; 
+            /* Resolve the name once here, so rendering never compares strings*/
+            sound_id = sound_id_from_name(line);
+            if (sound_id < 0) {
+                fprintf(stderr, "Warning: Unknown sound name '%s'\n", line);
+                sound_id = SOUND_REST; /* Default to rest if unknown*/
             }
-
-            /* Copy sound name (ensure it's not empty and fits)*/
-            if (strlen(line) == 0 || strlen(line) >= MAX_NAME_LEN) {
-                 fprintf(stderr, "Error: Invalid or too long sound name '%s' in pattern '%s'.\n", line, current_p->name);
-                 fclose(fp);
-                 return -2;
+            if (song_add_sound(song, sound_id) != 0) {
+                fclose(fp);
+                return -1;
             }
-            strcpy(current_p->sounds[current_p->num_sounds], line);
-            current_p->num_sounds++;
         }
     }
 
-    if (current_pattern_index != -1) {
-         fprintf(stderr, "Error: Reached end of file while still defining pattern '%s' (missing END?).\n", patterns[current_pattern_index].name);
+    if (in_pattern) {
+         fprintf(stderr, "Error: Reached end of file while still defining pattern '%s' (missing END?).\n",
+                 song->patterns[song->num_patterns - 1].name);
          fclose(fp);
          return -2; 
     }
 
 
     fclose(fp);
-    return 0; /* Success*/
+    return song_bind_plays(song); /* 0 on success*/
 }
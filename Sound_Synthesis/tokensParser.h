@@ -1,32 +1,73 @@
 #ifndef TOKENSPARSER_H
 #define TOKENSPARSER_H
 
-#include <stdint.h> /* For int16_t if needed, though not directly used here*/
-
-#define MAX_PATTERNS 4        /* Allow up to 4 pattern definitions only for now*/
-#define MAX_SOUNDS_PER_PATTERN 8  /* Allow max 8 sounds per pattern*/
-#define MAX_PLAY_COMMANDS 10 /* Allow up to 10 play commands*/
-#define MAX_NAME_LEN 16       /* Max length for pattern and sound names*/
+#include <stdint.h> /* For uint8_t*/
+#include <stddef.h> /* For size_t*/
+#include "arena.h"
+#include "nameTable.h"
 
 /* Struct to hold a single pattern definition*/
 typedef struct {
-    char name[MAX_NAME_LEN];
-    char sounds[MAX_SOUNDS_PER_PATTERN][MAX_NAME_LEN];
+    const char *name;       /* Interned in the song*/
+    uint8_t *sounds;        /* SoundId of every beat, resolved at parse time; arena-backed array that grows as sounds are added*/
     int num_sounds;
+    int sounds_capacity;
 } Pattern;
 
+#define PATTERN_UNBOUND 0xFFFFFFFFu /* PlayCommand.pattern_index before song_bind_plays*/
+
 /* Struct to hold a single play command*/
 typedef struct {
-    char pattern_name[MAX_NAME_LEN];
+    const char *pattern_name; /* Interned in the song*/
+    uint32_t pattern_index;   /* Index into Song.patterns, set by song_bind_plays*/
     int loop_count;
 } PlayCommand;
 
-/* Reads the token file and populates the patterns and play sequence arrays.*/
-/* Returns 0 on success, -1 on file error, -2 on parsing error (e.g., limits exceeded).*/
-int parse_tokens_file(const char* filename,
-                      Pattern patterns[MAX_PATTERNS],
-                      int* num_patterns,
-                      PlayCommand play_sequence[MAX_PLAY_COMMANDS],
-                      int* num_play_commands);
+/* A parsed song: pattern definitions and the play sequence. There are no fixed limits on the number of patterns,
+ sounds per pattern, play commands or name lengths. Everything, names included, lives in the song's arena and is
+ freed by song_release. Elements are stored in arrays, so patterns[i] and play_sequence[i] are O(1).*/
+typedef struct {
+    Arena arena;
+    NameTable names;          /* Interned strings, so every distinct name is stored once. For a pattern name
+                                 the value is 1 + the index of its first definition, otherwise 0.*/
+    Pattern *patterns;
+    size_t num_patterns;
+    size_t patterns_capacity;
+    PlayCommand *play_sequence;
+    size_t num_play_commands;
+    size_t play_capacity;
+} Song;
+
+void song_init(Song *song);
+void song_release(Song *song);
+
+/* Returns the song's single copy of text[0 .. length), or NULL if out of memory*/
+const char *song_intern(Song *song, const char *text, size_t length);
+
+/* Appends a pattern definition. Returns 0 on success, -1 if out of memory.*/
+int song_add_pattern(Song *song, const char *name, size_t length);
+
+/* Appends a sound (a SoundId) to the most recently added pattern. Returns 0 on success, -1 if out of memory.*/
+int song_add_sound(Song *song, int sound_id);
+
+/* Appends a play command. Returns 0 on success, -1 if out of memory.*/
+int song_add_play(Song *song, const char *pattern_name, size_t length, int loop_count);
+
+/* Moves the patterns and play commands of other to the end of song and leaves other empty (it still needs
+ song_release). Names are re-interned in song, so a name defined in both keeps song's first definition.
+ Nothing else is copied: song adopts other's arena. Play commands are left unbound for song_bind_plays.
+ Returns 0 on success, -1 if out of memory (song then holds part of other, and both must still be released).*/
+int song_append(Song *song, Song *other);
+
+/* Binds every play command to the index of its pattern with one hash lookup each, so nothing after loading
+ compares names. A name defined twice binds to its first definition. Called by the parsers once a song is loaded,
+ which also reports undefined patterns before any audio is produced.
+ Returns 0 on success, -2 if a PLAY command names an undefined pattern.*/
+int song_bind_plays(Song *song);
+
+/* Reads the token file and appends its patterns and play sequence to song (initialised by the caller),
+ then binds the play commands.*/
+/* Returns 0 on success, -1 on file error or out of memory, -2 on parsing error.*/
+int parse_tokens_file(const char* filename, Song* song);
 
 #endif
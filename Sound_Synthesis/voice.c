@@ -0,0 +1,551 @@
+#include "voice.h"
+#include "soundTable.h" /* For the sound IDs*/
+#include "oscillators.h" /* For the SIMD versions of boom, ding and floortom*/
+#include <math.h>
+
+#define sinf(x) ((float)sin((double)(x)))
+#define fmodf(x,y) ((float)fmod((double)(x),(double)(y)))
+#define fabsf(x) ((float)fabs((double)(x)))
+#define floorf(x) ((float)floor((double)(x)))
+
+/* Math constants*/
+#define PI 3.14159265358979323846
+#define TWO_PI (2.0 * PI)
+
+/* Samples per block of the oscillator kernels; the phase, wave, noise and envelope arrays of a block live on the stack*/
+#define OSC_BLOCK 1024
+
+/* Phase in radians at which the direct engine wraps a phase back into [0, 2 pi). It is past the phases one beat
+ reaches, so hits of a beat are not touched, and below the 12867 up to which osc_shape reduces phases exactly
+ (oscillators.h), so longer hits (play() durations) stay inside its error bounds.*/
+#define PHASE_WRAP 12000.0f
+
+/* How a voice makes its samples*/
+enum {
+    VOICE_SILENT = 0,
+    VOICE_OSCILLATORS,  /* A sine, a triangle and white noise (boom, ding and its repeats, floortom)*/
+    VOICE_NOISE,        /* Filtered white noise (tsst, clap and crash)*/
+    VOICE_ADDITIVE,     /* A bank of sines: the harmonics of piano notes and chords*/
+    VOICE_FIXED         /* Any of them with the fixed-point engine (only as a dispatch case)*/
+};
+
+/* Weights of the harmonics of a piano note (before they are scaled to add up to 1), and the stiffness of its string,
+ which stretches harmonic h to h f sqrt(1 + PIANO_STRETCH h^2)*/
+#define PIANO_HARMONICS 8
+#define PIANO_STRETCH 0.0002
+static const float PIANO_WEIGHTS[PIANO_HARMONICS] = { 1.0f, 0.6f, 0.35f, 0.2f, 0.12f, 0.07f, 0.04f, 0.02f };
+
+/* Notes of the chords, as ratios to the sound's frequency (the root): the root two octaves down in the left hand
+ and the triad, inverted so the chords of D - A - Bm - G move little, in the right*/
+static const float NOTE[] = { 1.0f };
+static const float CHORD_DM[] = { D2 / D4, 1.0f, Fs4 / D4, A4 / D4 };           /* D F# A*/
+static const float CHORD_AM1ST[] = { A2 / A4, Cs4 / A4, E4 / A4, 1.0f };        /* C# E A*/
+static const float CHORD_BM1ST[] = { B2 / B4, D4 / B4, Fs4 / B4, 1.0f };        /* D F# B*/
+static const float CHORD_GM2ND[] = { G2 / G4, D4 / G4, 1.0f, B4 / G4 };         /* D G B*/
+
+static int block_frames = VOICE_BLOCK_DEFAULT;
+
+/* Helper function to generate a sine wave sample*/
+static float sine_wave(float phase) {
+    return sinf(phase);
+}
+
+/* Helper function to generate a triangle wave sample*/
+static float triangle_wave(float phase) {
+    float normalized_phase;
+    normalized_phase = fmodf(phase, TWO_PI) / TWO_PI;
+    return 2.0f * fabsf(2.0f * (normalized_phase - floorf(normalized_phase + 0.5f))) - 1.0f;
+}
+
+/* Stores a sample, or adds it to what is there times the mix gain (voice_mix)*/
+static void put_sample(const Voice *voice, float *out, float sample) {
+    *out = voice->accumulate ? *out + voice->mix_gain * sample : sample;
+}
+
+/* Q15 of a weight*/
+static int32_t to_q15(float weight) {
+    return (int32_t)floor(weight * (double)FX_ONE + 0.5);
+}
+
+/* Sets up the fixed-point sources of a part at frequency*/
+static void start_fixed(Voice *voice, float frequency) {
+    FxVoice *fx;
+
+    fx = &voice->fx;
+    fx->sine_phase = 0;
+    fx->triangle_phase = 0;
+    fx->sine_increment = fx_increment(frequency, SAMPLE_RATE);
+    fx->triangle_increment = fx_increment(frequency * voice->triangle_ratio, SAMPLE_RATE);
+    fx->sine_weight = to_q15(voice->sine_weight);
+    fx->triangle_weight = to_q15(voice->triangle_weight);
+    fx->noise_weight = to_q15(voice->noise_weight);
+    fx->amplitude = (int32_t)floor((double)MAX_AMPLITUDE * voice->params.gain + 0.5);
+    if (voice->engine == VOICE_ADDITIVE) {
+        /* The sum of the bank takes the place of the noise*/
+        fx->noise_weight = FX_ONE;
+    }
+    if (voice->engine == VOICE_NOISE) {
+        /* The filtered noise comes out in Q(BIQUAD_FIXED_OUT_BITS), which the amplitude makes up for*/
+        fx->noise_weight = FX_ONE;
+        fx->amplitude <<= 15 - BIQUAD_FIXED_OUT_BITS;
+    }
+}
+
+/* Starts the filters of a noise voice at rest, in the form its engine runs them*/
+static void start_filters(Voice *voice) {
+    if (voice->fixed) {
+        biquad_fixed_init(voice->fixed_filters, voice->filters, voice->num_filters);
+    } else if (voice->parallel) {
+        biquad_lanes_init(&voice->bank, voice->filters, voice->num_filters);
+    } else {
+        biquad_cascade_init(&voice->cascade, voice->filters, voice->num_filters);
+    }
+}
+
+/* Makes voice a piano voice playing num_notes notes at ratios of its frequency, each with every harmonic*/
+static void set_piano(Voice *voice, const float *notes, int num_notes) {
+    double total;
+    double frequency;
+    int n;
+    int h;
+
+    total = 0.0;
+    for (h = 0; h < PIANO_HARMONICS; h++) {
+        total += PIANO_WEIGHTS[h];
+    }
+    voice->engine = VOICE_ADDITIVE;
+    voice->num_partials = 0;
+    for (n = 0; n < num_notes; n++) {
+        frequency = (double)voice->params.frequency * notes[n];
+        for (h = 1; h <= PIANO_HARMONICS; h++) {
+            voice->partial_frequency[voice->num_partials] = (float)(frequency * h * sqrt(1.0 + PIANO_STRETCH * h * h));
+            voice->partial_weight[voice->num_partials] = (float)(PIANO_WEIGHTS[h - 1] / total / num_notes);
+            voice->num_partials++;
+        }
+    }
+}
+
+/* Starts the sines of a piano voice at phase 0, in the form its engine runs them*/
+static void start_partials(Voice *voice) {
+    if (voice->fixed) {
+        fx_bank_init(&voice->fixed_partials, voice->partial_frequency, voice->partial_weight, voice->num_partials,
+                     SAMPLE_RATE);
+    } else {
+        osc_bank_init(&voice->partials, voice->partial_frequency, voice->partial_weight, voice->num_partials,
+                      SAMPLE_RATE);
+    }
+    voice->reference = osc_active_engine() == OSC_ENGINE_DIRECT && osc_active_isa() == OSC_ISA_SCALAR;
+}
+
+/* phase, wrapped into [0, 2 pi) once it reaches PHASE_WRAP*/
+static float wrap_phase(float phase) {
+    return phase < PHASE_WRAP ? phase : fmodf(phase, TWO_PI);
+}
+
+/* Sets up the state of the part voice->part, from its first sample*/
+static void start_part(Voice *voice) {
+    const SoundParams *params;
+    WtInterpolation interpolation;
+    float frequency;
+    float top;
+    int length;
+
+    params = &voice->params;
+    length = voice->part_end[voice->part] - (voice->part > 0 ? voice->part_end[voice->part - 1] : 0);
+    frequency = voice->part_frequency[voice->part];
+    voice->part_position = 0;
+    envelope_init(&voice->envelope, &params->envelope, length);
+    envelope_init(&voice->pitch, &params->pitch, length);
+    noise_stream_init(&voice->noise, &voice->event);
+    voice->swept = params->pitch.shape != ENVELOPE_FLAT;
+    voice->sine_phase = 0.0f;
+    voice->triangle_phase = 0.0f;
+    voice->fixed = osc_active_engine() == OSC_ENGINE_FIXED;
+    if (voice->engine == VOICE_NOISE) {
+        start_filters(voice);
+    }
+    if (voice->engine == VOICE_ADDITIVE) {
+        start_partials(voice);
+    }
+    if (voice->fixed) {
+        start_fixed(voice, frequency);
+        return;
+    }
+    if (voice->engine != VOICE_OSCILLATORS) {
+        return;
+    }
+
+    voice->sine_step = TWO_PI * frequency / SAMPLE_RATE;
+    voice->triangle_step = TWO_PI * frequency * voice->triangle_ratio / SAMPLE_RATE;
+    voice->wavetable = osc_active_engine() == OSC_ENGINE_WAVETABLE ||
+                       osc_active_engine() == OSC_ENGINE_WAVETABLE_CUBIC;
+    voice->reference = !voice->wavetable && osc_active_isa() == OSC_ISA_SCALAR;
+    if (voice->wavetable) {
+        /* The steps are in radians per sample, as the direct engine uses them. A sweep reads the tables of its
+         highest pitch, so it never aliases.*/
+        interpolation = osc_active_engine() == OSC_ENGINE_WAVETABLE_CUBIC ? WT_CUBIC : WT_LINEAR;
+        top = envelope_peak(&params->pitch);
+        wt_oscillator_init(&voice->sine, WT_SINE, (float)(voice->sine_step * SAMPLE_RATE / TWO_PI), SAMPLE_RATE,
+                           interpolation);
+        voice->sine.table = wt_table(WT_SINE, wt_level((float)(top * voice->sine_step * SAMPLE_RATE / TWO_PI),
+                                                       SAMPLE_RATE));
+        wt_oscillator_init(&voice->triangle, WT_TRIANGLE, (float)(voice->triangle_step * SAMPLE_RATE / TWO_PI),
+                           SAMPLE_RATE, interpolation);
+        voice->triangle.table = wt_table(WT_TRIANGLE, wt_level((float)(top * voice->triangle_step * SAMPLE_RATE /
+                                                                       TWO_PI), SAMPLE_RATE));
+    }
+}
+
+/* The scalar reference of the oscillator voices: sin and fmod at every sample*/
+static void process_reference(Voice *voice, float *out, int count) {
+    float ratio;
+    float sample;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        sample = 0.0f;
+        if (voice->sine_weight != 0.0f) sample = voice->sine_weight * sine_wave(voice->sine_phase);
+        if (voice->triangle_weight != 0.0f) sample += voice->triangle_weight * triangle_wave(voice->triangle_phase);
+        if (voice->noise_weight != 0.0f) sample += voice->noise_weight * noise_next(&voice->noise);
+        sample *= envelope_next(&voice->envelope);
+
+        put_sample(voice, out + i, sample * MAX_AMPLITUDE * voice->params.gain);
+
+        ratio = envelope_next(&voice->pitch);
+        voice->sine_phase = wrap_phase(voice->sine_phase + voice->sine_step * ratio);
+        voice->triangle_phase = wrap_phase(voice->triangle_phase + voice->triangle_step * ratio);
+    }
+}
+
+/* The oscillator voices: a sine and a triangle, stepping by their radians per sample (times the pitch envelope),
+ and white noise, mixed with their weights and shaped by the envelope, OSC_BLOCK samples at a time.
+
+ With the wavetable engine the waves come from band-limited tables (see wavetable.h) and are mixed here; only the
+ envelope and the gain are left, applied by osc_shape or, with --isa scalar, by a plain loop. With the direct
+ engine phases are accumulated in float, exactly as the reference loop does,
+ so only the sine and triangle math differs: osc_shape does it.*/
+static void process_oscillators(Voice *voice, float *out, int num_samples) {
+    float sine_phase[OSC_BLOCK + OSC_PAD];
+    float triangle_phase[OSC_BLOCK + OSC_PAD];
+    float noise[OSC_BLOCK + OSC_PAD];
+    float level[OSC_BLOCK + OSC_PAD];
+    float ratio[OSC_BLOCK + OSC_PAD];
+    float white[OSC_BLOCK];
+    OscVoice shape;
+    int swept;
+    int first;
+    int count;
+    int i;
+
+    if (voice->reference) {
+        process_reference(voice, out, num_samples);
+        return;
+    }
+    swept = voice->swept;
+    shape.envelope = level;
+    shape.gain = voice->params.gain;
+    shape.accumulate = voice->accumulate;
+    shape.mix_gain = voice->mix_gain;
+    if (voice->wavetable) {
+        shape.sine_phase = NULL;
+        shape.triangle_phase = NULL;
+        shape.noise = noise;
+        shape.noise_weight = 1.0f;
+    } else {
+        shape.sine_phase = voice->sine_weight != 0.0f ? sine_phase : NULL;
+        shape.triangle_phase = voice->triangle_weight != 0.0f ? triangle_phase : NULL;
+        shape.noise = voice->noise_weight != 0.0f ? noise : NULL;
+        shape.sine_weight = voice->sine_weight;
+        shape.triangle_weight = voice->triangle_weight;
+        shape.noise_weight = voice->noise_weight;
+    }
+
+    for (first = 0; first < num_samples; first += count) {
+        count = num_samples - first < OSC_BLOCK ? num_samples - first : OSC_BLOCK;
+        envelope_fill(&voice->envelope, level, count);
+        if (swept) envelope_fill(&voice->pitch, ratio, count);
+
+        if (voice->wavetable) {
+            /* noise holds the whole mix*/
+            for (i = 0; i < count; i++) {
+                noise[i] = 0.0f;
+            }
+            if (voice->sine_weight != 0.0f) {
+                wt_oscillator_mix(&voice->sine, noise, count, voice->sine_weight, swept ? ratio : NULL);
+            }
+            if (voice->triangle_weight != 0.0f) {
+                wt_oscillator_mix(&voice->triangle, noise, count, voice->triangle_weight, swept ? ratio : NULL);
+            }
+            if (voice->noise_weight != 0.0f) {
+                noise_fill(&voice->noise, white, count);
+                for (i = 0; i < count; i++) {
+                    noise[i] += white[i] * voice->noise_weight;
+                }
+            }
+            if (osc_active_isa() == OSC_ISA_SCALAR) {
+                for (i = 0; i < count; i++) {
+                    put_sample(voice, out + first + i, noise[i] * level[i] * MAX_AMPLITUDE * voice->params.gain);
+                }
+                continue;
+            }
+        } else {
+            for (i = 0; i < count; i++) {
+                sine_phase[i] = voice->sine_phase;
+                triangle_phase[i] = voice->triangle_phase;
+                voice->sine_phase = wrap_phase(voice->sine_phase + (swept ? voice->sine_step * ratio[i] :
+                                                                                voice->sine_step));
+                voice->triangle_phase = wrap_phase(voice->triangle_phase + (swept ? voice->triangle_step * ratio[i] :
+                                                                                        voice->triangle_step));
+            }
+            if (shape.noise) {
+                noise_fill(&voice->noise, noise, count);
+            }
+        }
+        osc_shape(out + first, count, &shape);
+    }
+}
+
+/* Any voice with the fixed-point engine (fixedPoint.h): envelopes, pitch and noise made in integers a block at a
+ time, then mixed by fx_shape*/
+static void process_fixed(Voice *voice, float *out, int num_samples) {
+    int32_t level[OSC_BLOCK];
+    int32_t ratio[OSC_BLOCK];
+    int16_t noise[OSC_BLOCK];
+    FxVoice *fx;
+    int first;
+    int count;
+
+    fx = &voice->fx;
+    fx->level = level;
+    fx->ratio = voice->swept ? ratio : NULL;
+    fx->noise = noise;
+    fx->accumulate = voice->accumulate;
+    fx->mix_gain = voice->mix_gain;
+    for (first = 0; first < num_samples; first += count) {
+        count = num_samples - first < OSC_BLOCK ? num_samples - first : OSC_BLOCK;
+        envelope_fill_fixed(&voice->envelope, level, count, FX_LEVEL_BITS);
+        if (voice->swept) envelope_fill_fixed(&voice->pitch, ratio, count, FX_RATIO_BITS);
+        if (voice->engine == VOICE_ADDITIVE) {
+            fx_bank_fill(&voice->fixed_partials, noise, count);
+        } else if (fx->noise_weight != 0) {
+            noise_fill_q15(&voice->noise, noise, count);
+        }
+        if (voice->parallel) {
+            biquad_fixed_sum(voice->fixed_filters, voice->num_filters, noise, noise, count);
+        } else if (voice->num_filters > 0) {
+            biquad_fixed_cascade(voice->fixed_filters, voice->num_filters, noise, noise, count);
+        }
+        fx_shape(out + first, count, fx);
+    }
+}
+
+/* Noise voices: white noise through their filters (a cascade, or a bank of SIMD lanes), shaped by the envelope*/
+static void process_noise(Voice *voice, float *out, int num_samples) {
+    float noise[OSC_BLOCK];
+    float level[OSC_BLOCK];
+    int first;
+    int count;
+    int i;
+
+    for (first = 0; first < num_samples; first += count) {
+        count = num_samples - first < OSC_BLOCK ? num_samples - first : OSC_BLOCK;
+        noise_fill(&voice->noise, noise, count);
+        if (voice->parallel) {
+            biquad_lanes_sum(&voice->bank, noise, noise, count);
+        } else {
+            biquad_cascade_process(&voice->cascade, noise, count);
+        }
+        envelope_fill(&voice->envelope, level, count);
+        for (i = 0; i < count; i++) {
+            put_sample(voice, out + first + i, noise[i] * level[i] * MAX_AMPLITUDE * voice->params.gain);
+        }
+    }
+}
+
+/* Piano voices: the sines of their notes from the oscillator bank (sin at every sample for the reference), shaped by
+ the envelope*/
+static void process_additive(Voice *voice, float *out, int num_samples) {
+    float wave[OSC_BLOCK];
+    float level[OSC_BLOCK];
+    int first;
+    int count;
+    int i;
+
+    for (first = 0; first < num_samples; first += count) {
+        count = num_samples - first < OSC_BLOCK ? num_samples - first : OSC_BLOCK;
+        if (voice->reference) {
+            osc_bank_fill_sin(&voice->partials, wave, count);
+        } else {
+            osc_bank_fill(&voice->partials, wave, count);
+        }
+        envelope_fill(&voice->envelope, level, count);
+        for (i = 0; i < count; i++) {
+            put_sample(voice, out + first + i, wave[i] * level[i] * MAX_AMPLITUDE * voice->params.gain);
+        }
+    }
+}
+
+void voice_init(Voice *voice, int sound_id, const SoundParams *params, int length, const NoiseEvent *event) {
+    voice->engine = VOICE_SILENT;
+    voice->params = *params;
+    voice->event = *event;
+    voice->length = length > 0 ? length : 0;
+    voice->position = 0;
+    voice->num_parts = 1;
+    voice->part = 0;
+    voice->part_end[0] = voice->length;
+    voice->part_frequency[0] = params->frequency;
+    voice->sine_weight = 0.0f;
+    voice->triangle_weight = 0.0f;
+    voice->noise_weight = 0.0f;
+    voice->triangle_ratio = 1.0f;
+    voice->num_filters = 0;
+    voice->parallel = 0;
+    voice->num_partials = 0;
+
+    switch (sound_id) {
+        case SOUND_BOOM:
+            voice->engine = VOICE_OSCILLATORS;
+            voice->sine_weight = 1.0f;
+            break;
+        case SOUND_DUN:
+            voice->engine = VOICE_OSCILLATORS;
+            voice->sine_weight = 0.7f;
+            voice->triangle_weight = 0.2f;
+            voice->noise_weight = 0.1f;
+            voice->triangle_ratio = 1.5f;
+            break;
+        case SOUND_DING:
+            voice->engine = VOICE_OSCILLATORS;
+            voice->triangle_weight = 1.0f;
+            break;
+        case SOUND_DIDING:
+            /* 'di', then 'ding' slightly higher*/
+            voice->engine = VOICE_OSCILLATORS;
+            voice->triangle_weight = 1.0f;
+            voice->num_parts = 2;
+            voice->part_end[0] = voice->length / 2;
+            voice->part_end[1] = voice->length;
+            voice->part_frequency[1] = params->frequency * 1.1f;
+            break;
+        case SOUND_DIDIDING:
+            /* The beat split into 3: 'di', 'di' slightly higher, and 'ding' back at the original pitch*/
+            voice->engine = VOICE_OSCILLATORS;
+            voice->triangle_weight = 1.0f;
+            voice->num_parts = 3;
+            voice->part_end[0] = voice->length / 3;
+            voice->part_end[1] = 2 * (voice->length / 3);
+            voice->part_end[2] = voice->length;
+            voice->part_frequency[1] = params->frequency * 1.1f;
+            voice->part_frequency[2] = params->frequency;
+            break;
+        case SOUND_TSST:
+            /* A 4th-order Butterworth high-pass at the sound's frequency*/
+            voice->engine = VOICE_NOISE;
+            voice->num_filters = biquad_butterworth(voice->filters, BIQUAD_HIGHPASS, params->frequency, 4,
+                                                    SAMPLE_RATE);
+            break;
+        case SOUND_CLAP:
+            /* Two band-passes in series around the sound's frequency; the gain puts back the level the band leaves
+             out of the noise*/
+            voice->engine = VOICE_NOISE;
+            biquad_design(&voice->filters[0], BIQUAD_BANDPASS, params->frequency, 1.0f, 1.0f, SAMPLE_RATE);
+            biquad_design(&voice->filters[1], BIQUAD_BANDPASS, params->frequency, 1.0f, 2.0f, SAMPLE_RATE);
+            voice->num_filters = 2;
+            break;
+        case SOUND_CRASH:
+            /* A bank: a high-pass for the wash and narrow bands at inharmonic ratios of the sound's frequency for the
+             ring of the cymbal*/
+            voice->engine = VOICE_NOISE;
+            voice->parallel = 1;
+            biquad_design(&voice->filters[0], BIQUAD_HIGHPASS, 0.6f * params->frequency, 0.707f, 0.3f, SAMPLE_RATE);
+            biquad_design(&voice->filters[1], BIQUAD_BANDPASS, 0.8f * params->frequency, 3.0f, 1.0f, SAMPLE_RATE);
+            biquad_design(&voice->filters[2], BIQUAD_BANDPASS, 1.37f * params->frequency, 3.0f, 1.0f, SAMPLE_RATE);
+            biquad_design(&voice->filters[3], BIQUAD_BANDPASS, 2.11f * params->frequency, 3.0f, 1.0f, SAMPLE_RATE);
+            voice->num_filters = 4;
+            break;
+        case SOUND_D2: case SOUND_G2: case SOUND_A2: case SOUND_B2:
+        case SOUND_D3: case SOUND_G3: case SOUND_A3: case SOUND_B3:
+        case SOUND_CS4: case SOUND_D4: case SOUND_E4: case SOUND_FS4: case SOUND_G4: case SOUND_A4: case SOUND_B4:
+            set_piano(voice, NOTE, 1);
+            break;
+        case SOUND_DM:
+            set_piano(voice, CHORD_DM, 4);
+            break;
+        case SOUND_AM1ST:
+            set_piano(voice, CHORD_AM1ST, 4);
+            break;
+        case SOUND_BM1ST:
+            set_piano(voice, CHORD_BM1ST, 4);
+            break;
+        case SOUND_GM2ND:
+            set_piano(voice, CHORD_GM2ND, 4);
+            break;
+        default:
+            break;
+    }
+    start_part(voice);
+}
+
+/* Writes (or, if voice->accumulate, adds) the next samples of the hit to out, up to num_frames of them.
+ Returns how many there were.*/
+static int render(Voice *voice, float *out, int num_frames) {
+    int written;
+    int run;
+    int i;
+
+    written = 0;
+    while (written < num_frames && voice->position < voice->length) {
+        if (voice->position == voice->part_end[voice->part]) {
+            voice->part++;
+            start_part(voice);
+            continue;
+        }
+        run = voice->part_end[voice->part] - voice->position;
+        if (run > num_frames - written) run = num_frames - written;
+        switch (voice->fixed && voice->engine != VOICE_SILENT ? VOICE_FIXED : voice->engine) {
+            case VOICE_FIXED:       process_fixed(voice, out + written, run); break;
+            case VOICE_OSCILLATORS: process_oscillators(voice, out + written, run); break;
+            case VOICE_NOISE:       process_noise(voice, out + written, run); break;
+            case VOICE_ADDITIVE:    process_additive(voice, out + written, run); break;
+            default:
+                if (voice->accumulate) break;
+                for (i = 0; i < run; i++) {
+                    out[written + i] = 0.0f;
+                }
+                break;
+        }
+        voice->position += run;
+        voice->part_position += run;
+        written += run;
+    }
+    return written;
+}
+
+int voice_process(Voice *voice, float *out, int num_frames) {
+    int written;
+    int i;
+
+    voice->accumulate = 0;
+    written = render(voice, out, num_frames);
+    for (i = written; i < num_frames; i++) {
+        out[i] = 0.0f;
+    }
+    return written;
+}
+
+int voice_mix(Voice *voice, float *dest, int num_frames, float gain) {
+    voice->accumulate = 1;
+    voice->mix_gain = gain;
+    return render(voice, dest, num_frames);
+}
+
+void voice_set_block_frames(int frames) {
+    if (frames < VOICE_BLOCK_MIN) frames = VOICE_BLOCK_MIN;
+    if (frames > VOICE_BLOCK_MAX) frames = VOICE_BLOCK_MAX;
+    block_frames = frames;
+}
+
+int voice_block_frames(void) {
+    return block_frames;
+}
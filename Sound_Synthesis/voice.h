@@ -0,0 +1,90 @@
+#ifndef VOICE_H
+#define VOICE_H
+
+#include "soundwaves.h" /* For SoundParams, Envelope and NoiseStream*/
+#include "wavetable.h" /* For WtOscillator*/
+#include "fixedPoint.h" /* For FxVoice*/
+#include "biquad.h" /* For the filters of the noise voices*/
+#include "oscBank.h" /* For the partials of the piano voices*/
+
+/* Voices: one hit of a sound, rendered a block at a time.
+
+ voice_init sets a hit up; every voice_process (or voice_mix) call then writes its next samples, carrying the
+ phases, the envelopes and the noise stream over from the last call. Blocks can be any size, so a hit can be streamed,
+ spread over several beats or rendered in pieces that stay in L1: the samples are exactly those of rendering
+ the whole hit in one call (which is what the generate_* kernels of soundwaves.h do).*/
+
+/* Frames per block the renderers use: any number from VOICE_BLOCK_MIN to VOICE_BLOCK_MAX*/
+#define VOICE_BLOCK_MIN 64
+#define VOICE_BLOCK_MAX 1024
+#define VOICE_BLOCK_DEFAULT 256
+
+/* Most parts a hit is made of (DIDIDING plays three dings in a row)*/
+#define VOICE_MAX_PARTS 3
+
+typedef struct {
+    int engine;            /* How the samples are made; set by voice_init*/
+    SoundParams params;
+    NoiseEvent event;
+    int length;            /* Samples of the whole hit*/
+    int position;          /* Samples written so far*/
+    int num_parts;
+    int part;              /* Part being played*/
+    int part_end[VOICE_MAX_PARTS];         /* Position at which each part ends*/
+    float part_frequency[VOICE_MAX_PARTS];
+    int accumulate;        /* The call in progress adds to its output (voice_mix) instead of storing*/
+    float mix_gain;
+    int num_filters;       /* Filters of the noise of a noise voice, in series or, if parallel, summed*/
+    int parallel;
+    BiquadCoeffs filters[BIQUAD_MAX_LANES];
+    int num_partials;      /* Sines of a piano voice (every harmonic of every note of it)*/
+    float partial_frequency[OSC_BANK_MAX_PARTIALS];
+    float partial_weight[OSC_BANK_MAX_PARTIALS];
+
+    /* State of the current part*/
+    int part_position;     /* Samples of it written so far*/
+    Envelope envelope;
+    Envelope pitch;
+    NoiseStream noise;
+    int swept;             /* The pitch envelope is not flat*/
+    int wavetable;         /* Waves from the band-limited tables (OSC_ENGINE_WAVETABLE and _CUBIC)*/
+    int reference;         /* Run the scalar reference loop (direct engine with --isa scalar)*/
+    float sine_step;       /* Radians per sample*/
+    float triangle_step;
+    float triangle_ratio;  /* Frequency of the triangle over the sine's*/
+    float sine_weight;
+    float triangle_weight;
+    float noise_weight;
+    float sine_phase;      /* Direct engine*/
+    float triangle_phase;
+    WtOscillator sine;     /* Wavetable engine*/
+    WtOscillator triangle;
+    BiquadCascade cascade; /* The filters running, in series*/
+    BiquadLanes bank;      /* or in parallel*/
+    OscBank partials;      /* The sines running*/
+    int fixed;             /* Fixed-point engine, for every sound*/
+    FxVoice fx;
+    BiquadFixed fixed_filters[BIQUAD_MAX_LANES];
+    FxBank fixed_partials;
+} Voice;
+
+/* Starts voice at the first of length samples of the hit of sound_id (a SoundId) with params, identified by event.
+ The oscillator engine is the one active now.*/
+void voice_init(Voice *voice, int sound_id, const SoundParams *params, int length, const NoiseEvent *event);
+
+/* Writes the next num_frames samples of voice to out, as float on the 16-bit scale. Samples past the end of the
+ hit are 0. Returns the number of samples that were part of the hit.*/
+int voice_process(Voice *voice, float *out, int num_frames);
+
+/* The accumulating variant of voice_process: adds gain times the next num_frames samples of voice to dest, in the
+ same pass that makes them, so a hit needs no buffer of its own. Nothing is added past the end of the hit.
+ With gain 1 the sum is exactly that of voice_process followed by mix_in. Returns the number of samples of the hit.*/
+int voice_mix(Voice *voice, float *dest, int num_frames, float gain);
+
+/* Selects the block size of every later render, clamped to [VOICE_BLOCK_MIN, VOICE_BLOCK_MAX]
+ (VOICE_BLOCK_DEFAULT until called). It changes nothing in the output.*/
+void voice_set_block_frames(int frames);
+
+int voice_block_frames(void);
+
+#endif /* VOICE_H*/
@@ -0,0 +1,162 @@
+#define _POSIX_C_SOURCE 200112L /* For pthread_once with -ansi*/
+#include "wavetable.h"
+#include <math.h>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+
+#define PI 3.14159265358979323846
+
+/* One guard sample before each period and two after it, for the cubic interpolation*/
+#define WT_STRIDE (WT_SIZE + 3)
+
+static float tables[WT_NUM_SHAPES][WT_LEVELS][WT_STRIDE];
+
+#ifndef _WIN32
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+#else
+static int tables_built = 0; /* Windows builds render on one thread*/
+#endif
+
+/* Harmonic n of shape as (sine amplitude, cosine amplitude) of its Fourier series*/
+static void harmonic(WtShape shape, int n, double *sine, double *cosine) {
+    *sine = 0.0;
+    *cosine = 0.0;
+    switch (shape) {
+        case WT_SINE:
+            if (n == 1) *sine = 1.0;
+            break;
+        case WT_TRIANGLE:
+            if (n % 2 == 1) *cosine = -8.0 / (PI * PI) / ((double)n * n);
+            break;
+        case WT_SAW:
+            *sine = -2.0 / PI / n;
+            break;
+        case WT_SQUARE:
+            if (n % 2 == 1) *sine = 4.0 / PI / n;
+            break;
+        default:
+            break;
+    }
+}
+
+/* Level k has the harmonics up to WT_SIZE / 2 >> k. Built from the top level down, each level adding the harmonics
+ the one above it left out, so every harmonic is summed once per sample.*/
+static void build_tables(void) {
+    static double sum[WT_SIZE];
+    static double sin_base[WT_SIZE];
+    double sine, cosine;
+    float *table;
+    int shape, level;
+    int n, top, previous_top;
+    int j;
+
+    for (j = 0; j < WT_SIZE; j++) {
+        sin_base[j] = sin(2.0 * PI * j / WT_SIZE);
+    }
+    for (shape = 0; shape < WT_NUM_SHAPES; shape++) {
+        for (j = 0; j < WT_SIZE; j++) {
+            sum[j] = 0.0;
+        }
+        previous_top = 0;
+        for (level = WT_LEVELS - 1; level >= 0; level--) {
+            top = (WT_SIZE / 2) >> level;
+            for (n = previous_top + 1; n <= top; n++) {
+                harmonic((WtShape)shape, n, &sine, &cosine);
+                if (sine == 0.0 && cosine == 0.0) continue;
+                for (j = 0; j < WT_SIZE; j++) {
+                    /* sin and cos of 2 pi n j / WT_SIZE, read from one period of sine*/
+                    sum[j] += sine * sin_base[(n * j) % WT_SIZE] + cosine * sin_base[(n * j + WT_SIZE / 4) % WT_SIZE];
+                }
+            }
+            previous_top = top;
+
+            table = tables[shape][level];
+            for (j = 0; j < WT_SIZE; j++) {
+                table[j + 1] = (float)sum[j];
+            }
+            table[0] = table[WT_SIZE];
+            table[WT_SIZE + 1] = table[1];
+            table[WT_SIZE + 2] = table[2];
+        }
+    }
+}
+
+static void ensure_tables(void) {
+#ifndef _WIN32
+    pthread_once(&tables_once, build_tables);
+#else
+    if (!tables_built) {
+        build_tables();
+        tables_built = 1;
+    }
+#endif
+}
+
+const float *wt_table(WtShape shape, int level) {
+    ensure_tables();
+    return tables[shape][level] + 1;
+}
+
+int wt_level(float frequency, float sample_rate) {
+    double max_harmonic;
+    int level;
+
+    if (frequency <= 0.0f) return 0;
+    max_harmonic = sample_rate / 2.0 / frequency; /* Harmonics must stay below this*/
+    for (level = 0; level < WT_LEVELS - 1; level++) {
+        if ((double)((WT_SIZE / 2) >> level) < max_harmonic) break;
+    }
+    return level;
+}
+
+void wt_oscillator_init(WtOscillator *osc, WtShape shape, float frequency, float sample_rate,
+                        WtInterpolation interpolation) {
+    osc->table = wt_table(shape, wt_level(frequency, sample_rate));
+    osc->phase = 0;
+    osc->increment = (uint32_t)floor((double)frequency / sample_rate * 4294967296.0 + 0.5);
+    osc->interpolation = interpolation;
+}
+
+/* Sample of table at phase*/
+static float table_sample(const float *table, uint32_t phase, WtInterpolation interpolation) {
+    const float *p;
+    float frac;
+
+    p = table + (phase >> (32 - WT_BITS));
+    frac = (float)(phase & ((1u << (32 - WT_BITS)) - 1)) * (1.0f / (float)(1u << (32 - WT_BITS)));
+    if (interpolation == WT_CUBIC) {
+        return p[0] + 0.5f * frac * (p[1] - p[-1] + frac * (2.0f * p[-1] - 5.0f * p[0] + 4.0f * p[1] - p[2] +
+                                                         frac * (3.0f * (p[0] - p[1]) + p[2] - p[-1])));
+    }
+    return p[0] + frac * (p[1] - p[0]);
+}
+
+void wt_oscillator_mix(WtOscillator *osc, float *out, int count, float weight, const float *ratio) {
+    const float *table;
+    uint32_t phase;
+    uint32_t increment;
+    int i;
+
+    table = osc->table;
+    phase = osc->phase;
+    increment = osc->increment;
+    /* One loop per case, so the common ones carry no per-sample test*/
+    if (ratio) {
+        for (i = 0; i < count; i++) {
+            out[i] += weight * table_sample(table, phase, osc->interpolation);
+            phase += (uint32_t)((double)increment * ratio[i]);
+        }
+    } else if (osc->interpolation == WT_CUBIC) {
+        for (i = 0; i < count; i++) {
+            out[i] += weight * table_sample(table, phase, WT_CUBIC);
+            phase += increment;
+        }
+    } else {
+        for (i = 0; i < count; i++) {
+            out[i] += weight * table_sample(table, phase, WT_LINEAR);
+            phase += increment;
+        }
+    }
+    osc->phase = phase;
+}
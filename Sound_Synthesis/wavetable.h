@@ -0,0 +1,54 @@
+#ifndef WAVETABLE_H
+#define WAVETABLE_H
+
+#include <stdint.h>
+
+/* Band-limited wavetable oscillators.
+
+ Every shape is stored as one period of WT_SIZE samples at WT_LEVELS mip levels: level k holds the
+ harmonics 1 .. WT_SIZE / 2 >> k of the shape, summed from its Fourier series. An oscillator picks the
+ lowest level whose top harmonic stays below Nyquist for its frequency, so nothing aliases (at the cost
+ of losing the harmonics between that one and Nyquist, at most an octave's worth). The phase is a 32-bit
+ accumulator: the top WT_BITS bits index the table and the rest are the interpolation fraction, so the
+ pitch never drifts the way a float phase does. The tables are built on first use (about 360 KB in all).*/
+
+#define WT_BITS 11
+#define WT_SIZE (1 << WT_BITS)  /* Samples per period*/
+#define WT_LEVELS (WT_BITS)     /* Level WT_LEVELS - 1 is a pure sine*/
+
+typedef enum {
+    WT_SINE = 0,
+    WT_TRIANGLE, /* Starts at -1, like triangle_wave in soundwaves.c*/
+    WT_SAW,      /* Rises from -1 to 1*/
+    WT_SQUARE,   /* 1 for the first half period, -1 for the second*/
+    WT_NUM_SHAPES
+} WtShape;
+
+typedef enum {
+    WT_LINEAR = 0, /* 2 table reads per sample*/
+    WT_CUBIC       /* 4 table reads per sample (Catmull-Rom), for low tables and slow sweeps*/
+} WtInterpolation;
+
+typedef struct {
+    const float *table;   /* The mip level chosen for the frequency; a swept oscillator needs the one of its highest*/
+    uint32_t phase;       /* Position in the period, as a fraction of 2^32*/
+    uint32_t increment;   /* Phase step per sample*/
+    WtInterpolation interpolation;
+} WtOscillator;
+
+/* Starts an oscillator at phase 0. frequency is in Hz and must be below sample_rate.*/
+void wt_oscillator_init(WtOscillator *osc, WtShape shape, float frequency, float sample_rate,
+                        WtInterpolation interpolation);
+
+/* Adds weight times the next count samples of the oscillator to out[0 .. count). If ratio is not NULL, sample i
+ advances the phase by ratio[i] times the increment (a pitch envelope).*/
+void wt_oscillator_mix(WtOscillator *osc, float *out, int count, float weight, const float *ratio);
+
+/* Mip level used for frequency: the lowest one with no harmonic at or above Nyquist*/
+int wt_level(float frequency, float sample_rate);
+
+/* One period of shape at level (WT_SIZE samples). table[-1], table[WT_SIZE] and table[WT_SIZE + 1] wrap around,
+ so interpolation needs no index masking.*/
+const float *wt_table(WtShape shape, int level);
+
+#endif /* WAVETABLE_H*/